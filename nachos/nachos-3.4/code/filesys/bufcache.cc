@@ -0,0 +1,590 @@
+// bufcache.cc
+//	Routines to cache disk sectors in memory, so that the file
+//	system doesn't pay for a seek and a rotation every time it
+//	touches the same sector (file headers, the directory and the
+//	free map are read and written over and over).
+//
+//	Buffers are replaced least recently used first.  To find the
+//	buffer for a sector quickly, buffers are kept in hash chains
+//	indexed by sector number; the order of use is a doubly linked
+//	list threaded through the buffers themselves.
+//
+//	A semaphore lets one thread at a time into the cache.  A thread
+//	that has to wait for the disk marks the buffer it is using busy
+//	and leaves the cache while it waits, so that other threads can
+//	use the rest of the cache, and have their own requests queued at
+//	the disk, in the meantime.  Anyone who wants a busy buffer waits
+//	for it, then looks again, since anything may have changed.
+//
+//	Read-ahead doesn't wait for the disk at all: the buffer stays
+//	busy until the disk interrupt handler says the read is done.
+//
+//	Logged (metadata) sectors are written to their own places only
+//	after they have been committed to the journal; until then they
+//	are pinned in the cache.  Committed sectors stay dirty in the
+//	cache, like any others, and are written to their places when
+//	they are replaced, at Sync, or at the next commit if that
+//	doesn't change them again.  So a sector changed over and over,
+//	like the free map, is written to the journal each time, next to
+//	the rest of the transaction, rather than to its own place.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "bufcache.h"
+#include "journal.h"
+#include "system.h"
+#ifdef HOST_SPARC
+#include <strings.h>
+#endif
+
+//----------------------------------------------------------------------
+// CacheEntry::Done
+// 	The disk is done with this buffer.  Wake up every thread waiting
+//	for it.  Called with the cache locked, or by the disk interrupt
+//	handler (for a read-ahead).
+//----------------------------------------------------------------------
+
+void
+CacheEntry::Done()
+{
+    busy = FALSE;
+    for (; numWaiting > 0; numWaiting--)
+	ready->V();
+}
+
+//----------------------------------------------------------------------
+// ReadAheadDone
+// 	Called by the disk interrupt handler when a read-ahead is done.
+//	"arg" is the buffer it read into.
+//----------------------------------------------------------------------
+
+static void
+ReadAheadDone(int arg)
+{
+    ((CacheEntry *) arg)->Done();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize an empty cache in front of a disk.
+//
+//	"cachedDisk" -- the disk whose sectors are cached
+//	"size" -- the number of sectors to keep in memory; 0 sends
+//		every request straight to the disk
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache(SynchDisk *cachedDisk, int size)
+{
+    ASSERT(size >= 0);
+    disk = cachedDisk;
+    numEntries = size;
+    lock = new Semaphore("buffer cache", 1);
+    entries = new CacheEntry[numEntries + 1];	// never zero-sized
+    buckets = new int[numEntries + 1];
+    for (int i = 0; i < numEntries; i++) {
+	entries[i].sector = -1;
+	entries[i].dirty = entries[i].busy = FALSE;
+	entries[i].newer = i - 1;
+	entries[i].older = (i + 1 < numEntries) ? i + 1 : -1;
+	entries[i].hashNext = -1;
+	entries[i].ready = new Semaphore("cache buffer", 0);
+	entries[i].numWaiting = 0;
+	entries[i].logged = entries[i].committed = FALSE;
+	buckets[i] = -1;
+    }
+    newest = (numEntries > 0) ? 0 : -1;
+    oldest = numEntries - 1;
+    aheadLimit = (numEntries > 0) ? MaxReadAhead : 0;
+    journal = NULL;
+    journalLimit = 0;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	De-allocate the cache.  Writing back dirty sectors means waiting
+//	for the disk, which can't be done once Nachos is shutting down;
+//	the kernel calls Sync at the points where it wants data safe.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache()
+{
+    for (int i = 0; i < numEntries; i++)
+	delete entries[i].ready;
+    delete [] entries;
+    delete [] buckets;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector/WriteSector
+// 	Read or write a whole sector through the cache.  Writing a
+//	whole sector needn't read the old contents first.
+//
+//	"sector" -- the disk sector to read/write
+//	"into" -- the buffer to hold the contents of the sector
+//	"from" -- the new contents of the sector
+//	"log" -- is the sector metadata? (cf. Write)
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSector(int sector, char *into)
+{
+    Read(sector, into, 0, SectorSize);
+}
+
+void
+BufferCache::WriteSector(int sector, char *from, bool log)
+{
+    Write(sector, from, 0, SectorSize, log);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Read
+// 	Copy part of a sector out of the cache, reading the sector in
+//	if it isn't there.
+//
+//	"sector" -- the disk sector to read from
+//	"into" -- the buffer to hold the bytes
+//	"offset" -- where in the sector the bytes start
+//	"numBytes" -- how many bytes to copy
+//----------------------------------------------------------------------
+
+void
+BufferCache::Read(int sector, char *into, int offset, int numBytes)
+{
+    int e;
+
+    ASSERT(offset >= 0 && numBytes >= 0 && offset + numBytes <= SectorSize);
+    if (numEntries == 0) {
+	char buf[SectorSize];
+
+	disk->ReadSector(sector, buf);
+	bcopy(&buf[offset], into, numBytes);
+	return;
+    }
+    lock->P();
+    e = Get(sector, TRUE);
+    bcopy(&entries[e].data[offset], into, numBytes);
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Write
+// 	Copy bytes into the cached copy of a sector and mark it dirty.
+//	Unless the whole sector is overwritten, the rest of it has to
+//	be read in first, if it isn't cached already.
+//
+//	A logged write pins the sector until the next commit.  If that
+//	makes too many sectors pinned, they are committed at once, even
+//	though the file system may be half way through an operation.
+//
+//	"sector" -- the disk sector to write to
+//	"from" -- the bytes to write
+//	"offset" -- where in the sector the bytes go
+//	"numBytes" -- how many bytes to copy
+//	"log" -- is the sector metadata, to go through the journal?
+//----------------------------------------------------------------------
+
+void
+BufferCache::Write(int sector, char *from, int offset, int numBytes,
+		   bool log)
+{
+    bool whole = (offset == 0 && numBytes == SectorSize);
+    int e;
+
+    ASSERT(offset >= 0 && numBytes >= 0 && offset + numBytes <= SectorSize);
+    if (numEntries == 0) {
+	char buf[SectorSize];
+
+	if (!whole)
+	    disk->ReadSector(sector, buf);
+	bcopy(from, &buf[offset], numBytes);
+	disk->WriteSector(sector, buf);
+	return;
+    }
+    lock->P();
+    e = Get(sector, !whole);
+    bcopy(from, &entries[e].data[offset], numBytes);
+    entries[e].dirty = TRUE;
+    if (log && journal != NULL) {
+	entries[e].logged = TRUE;
+	entries[e].committed = FALSE;
+	if (NumPinned() >= journalLimit) {
+	    DEBUG('f', "Buffer cache: journal full, committing early.\n");
+	    WriteTransaction();
+	}
+    } else
+	entries[e].logged = FALSE;	// no longer metadata
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadAhead
+// 	Start reading sectors into the cache, without waiting for them.
+//	Sectors already cached (or on their way) are skipped.  Each goes
+//	into the least recently used clean buffer, and becomes the most
+//	recently used, since it is expected to be wanted soon.
+//
+//	"sectors" -- the disk sectors to read, in the order to read them
+//	"numSectors" -- how many; only the first MaxReadAhead count
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadAhead(int *sectors, int numSectors)
+{
+    int i, e;
+
+    if (numEntries == 0)
+	return;
+    lock->P();
+    for (i = 0; i < min(numSectors, MaxReadAhead); i++) {
+	if (Find(sectors[i]) != -1)
+	    continue;
+	if ((e = Victim(TRUE)) == -1)
+	    break;			// nothing to spare
+	Assign(e, sectors[i]);
+	Touch(e);
+	entries[e].busy = TRUE;
+	disk->ReadAhead(sectors[i], entries[e].data, ReadAheadDone,
+			(int) &entries[e]);
+	stats->numReadAheads++;
+	DEBUG('f', "Buffer cache: reading ahead sector %d into buffer %d.\n",
+	      sectors[i], e);
+    }
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::SetJournal
+// 	Use "log" for logged sectors from now on, or, if it is NULL,
+//	write them like any others.  Sectors logged already are committed
+//	to the old journal first.
+//
+//	At most half the buffers may be pinned, and no more than fit in
+//	one transaction; with fewer than two buffers, nothing is logged.
+//----------------------------------------------------------------------
+
+void
+BufferCache::SetJournal(Journal *log)
+{
+    Commit();
+    journalLimit = min(JournalBlocks, numEntries / 2);
+    journal = (journalLimit > 0) ? log : NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::CommitDue
+// 	Return TRUE if half as many sectors as may be pinned are.  The
+//	file system commits then, between operations, so that it seldom
+//	has to be done in the middle of one (cf. Write).
+//----------------------------------------------------------------------
+
+bool
+BufferCache::CommitDue()
+{
+    bool due;
+
+    if (journal == NULL)
+	return FALSE;
+    lock->P();
+    due = (NumPinned() >= journalLimit / 2);
+    lock->V();
+    return due;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Commit
+// 	Commit every logged sector to the journal, as one transaction.
+//	The file system should call this when the metadata it has
+//	written is consistent, for that is what a crash will leave.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Commit()
+{
+    if (journal == NULL)
+	return;
+    lock->P();
+    WriteTransaction();
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Sync
+// 	Write every dirty sector back to disk.  The sectors stay cached.
+//	(A busy buffer is never dirty: it is either being read, or being
+//	written back already.)  Sectors logged since the last commit
+//	stay where they are; the file system commits before it syncs.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Sync()
+{
+    lock->P();
+    for (int e = 0; e < numEntries; e++)
+	if (entries[e].dirty && !Pinned(e))
+	    WriteBack(e);
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Invalidate
+// 	Write every dirty sector back to disk, and empty the cache, so
+//	that the next reference to any sector is a miss.  Used to time
+//	the file system with a cold cache.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Invalidate()
+{
+    int e;
+
+    lock->P();
+    for (e = 0; e < numEntries; e++)
+	if (entries[e].busy || entries[e].dirty) {
+	    if (entries[e].busy)
+		WaitFor(e);
+	    else if (Pinned(e))
+		WriteTransaction();
+	    else
+		WriteBack(e);
+	    e = -1;		// others got in meanwhile; look again
+	}
+    for (e = 0; e < numEntries; e++) {
+	entries[e].sector = -1;
+	entries[e].hashNext = -1;
+	buckets[e] = -1;
+    }
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Find
+// 	Return the buffer holding "sector", or -1 if it isn't cached.
+//----------------------------------------------------------------------
+
+int
+BufferCache::Find(int sector)
+{
+    for (int e = buckets[sector % numEntries]; e != -1; e = entries[e].hashNext)
+	if (entries[e].sector == sector)
+	    return e;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Victim
+// 	Return the least recently used buffer that isn't busy or pinned,
+//	or -1 if there is none.
+//
+//	"clean" -- only return a buffer that needn't be written back
+//		(read-ahead doesn't wait for a write)
+//----------------------------------------------------------------------
+
+int
+BufferCache::Victim(bool clean)
+{
+    for (int e = oldest; e != -1; e = entries[e].newer)
+	if (!entries[e].busy && !Pinned(e) && !(clean && entries[e].dirty))
+	    return e;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Get
+// 	Return the buffer for "sector", making it the most recently
+//	used.  On a miss, take over the least recently used buffer
+//	that isn't busy, writing it back first if it is dirty.
+//
+//	Called with the cache locked; returns with it locked, but it
+//	may have been unlocked while waiting for the disk.
+//
+//	"sector" -- the disk sector wanted
+//	"fill" -- on a miss, read the sector's contents from disk?
+//		(not needed if the caller is about to overwrite all of it)
+//----------------------------------------------------------------------
+
+int
+BufferCache::Get(int sector, bool fill)
+{
+    int e;
+
+    for (;;) {
+	if ((e = Find(sector)) != -1) {
+	    if (entries[e].busy) {	// it's on its way
+		WaitFor(e);
+		continue;
+	    }
+	    stats->numCacheHits++;
+	    Touch(e);
+	    return e;
+	}
+	if ((e = Victim(FALSE)) == -1) {	// every buffer is busy
+	    for (e = oldest; !entries[e].busy; e = entries[e].newer)
+		ASSERT(entries[e].newer != -1);	// (or pinned, but not all)
+	    WaitFor(e);
+	} else if (entries[e].dirty)
+	    WriteBack(e);
+	else
+	    break;
+    }
+
+    stats->numCacheMisses++;
+    Assign(e, sector);
+    Touch(e);
+    DEBUG('f', "Buffer cache: sector %d in buffer %d.\n", sector, e);
+    if (fill) {
+	entries[e].busy = TRUE;
+	lock->V();
+	disk->ReadSector(sector, entries[e].data);
+	lock->P();
+	entries[e].Done();
+    }
+    return e;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Assign
+// 	Make buffer "e", which must be clean and not busy, hold "sector"
+//	instead of whatever it held, moving it to the right hash chain.
+//	Its contents are left for the caller to fill in.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Assign(int e, int sector)
+{
+    int *link;
+
+    ASSERT(!entries[e].dirty && !entries[e].busy);
+    if (entries[e].sector != -1) {
+	for (link = &buckets[entries[e].sector % numEntries]; *link != e;
+					link = &entries[*link].hashNext)
+	    ASSERT(*link != -1);
+	*link = entries[e].hashNext;
+    }
+    entries[e].sector = sector;
+    entries[e].hashNext = buckets[sector % numEntries];
+    buckets[sector % numEntries] = e;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Touch
+// 	Move buffer "e" to the front of the list, as the most recently
+//	used.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Touch(int e)
+{
+    if (e == newest)
+	return;
+    // unlink (e isn't the newest, so it has a newer neighbour)
+    entries[entries[e].newer].older = entries[e].older;
+    if (entries[e].older != -1)
+	entries[entries[e].older].newer = entries[e].newer;
+    else
+	oldest = entries[e].newer;
+    // and put it in front
+    entries[e].newer = -1;
+    entries[e].older = newest;
+    entries[newest].newer = e;
+    newest = e;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WaitFor
+// 	Wait until buffer "e" isn't busy any more, letting other threads
+//	into the cache meanwhile.  Called, and returns, with the cache
+//	locked.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WaitFor(int e)
+{
+    entries[e].numWaiting++;
+    lock->V();
+    entries[e].ready->P();
+    lock->P();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteBack
+// 	Write the contents of buffer "e" to its disk sector.  The buffer
+//	is busy while the disk writes it, so nobody changes it; other
+//	threads may use the rest of the cache.  Called, and returns, with
+//	the cache locked.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteBack(int e)
+{
+    ASSERT(!entries[e].busy);
+    DEBUG('f', "Buffer cache: writing back sector %d.\n", entries[e].sector);
+    ASSERT(!Pinned(e));
+    entries[e].busy = TRUE;
+    entries[e].dirty = FALSE;
+    entries[e].logged = FALSE;	// its own place has it now
+    lock->V();
+    disk->WriteSector(entries[e].sector, entries[e].data);
+    lock->P();
+    entries[e].Done();
+    stats->numCacheWritebacks++;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::NumPinned
+// 	Return how many buffers are logged but not yet committed.
+//----------------------------------------------------------------------
+
+int
+BufferCache::NumPinned()
+{
+    int count = 0;
+
+    for (int e = 0; e < numEntries; e++)
+	if (Pinned(e))
+	    count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteTransaction
+// 	Commit the pinned buffers to the journal, as one transaction.
+//
+//	First, the sectors of the last transaction that this one doesn't
+//	change again are written to their own places: once this one is
+//	committed, the last one is never replayed, so they must be there.
+//	Then the pinned sectors go to the journal, and are committed;
+//	they stay dirty, to be written to their own places later.
+//
+//	Called with the cache locked.  It stays locked throughout, even
+//	while waiting for the disk, so nothing changes under the commit.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteTransaction()
+{
+    int e;
+
+    if (journal == NULL || NumPinned() == 0)
+	return;
+    for (e = 0; e < numEntries; e++)
+	if (entries[e].logged && entries[e].committed) {
+	    ASSERT(entries[e].dirty && !entries[e].busy);
+	    disk->WriteSector(entries[e].sector, entries[e].data);
+	    entries[e].dirty = FALSE;
+	    entries[e].logged = FALSE;
+	    stats->numCacheWritebacks++;
+	}
+    journal->Begin();
+    for (e = 0; e < numEntries; e++)
+	if (Pinned(e))
+	    journal->Add(entries[e].sector, entries[e].data);
+    journal->End();
+    for (e = 0; e < numEntries; e++)
+	if (entries[e].logged)
+	    entries[e].committed = TRUE;
+}
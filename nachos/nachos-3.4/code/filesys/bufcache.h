@@ -0,0 +1,136 @@
+// bufcache.h
+//	Data structures for the kernel's buffer cache: a fixed set of
+//	sector-sized buffers that sits between the file system (open
+//	files, file headers, the directory and the free map) and the
+//	synchronous disk.
+//
+//	Reads are served from the cache when the sector is there.
+//	Writes only update the cached copy and mark it dirty; the
+//	sector goes to disk when its buffer is reused for another
+//	sector (least recently used first), or on Sync.  So anything
+//	written since the last Sync is lost if Nachos stops without
+//	one, just as on a real system that crashes.
+//
+//	Open files that are read sequentially ask the cache to read
+//	ahead: the sectors they will want next are read in the
+//	background, while the reader carries on.
+//
+//	Writes of file system metadata are "logged": with a journal
+//	(cf. journal.h), the sector is kept in the cache until it has
+//	been committed to the journal, along with every other metadata
+//	sector changed since the last commit, and only then may go to
+//	its own place on disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef BUFCACHE_H
+#define BUFCACHE_H
+
+#include "disk.h"
+#include "synch.h"
+#include "synchdisk.h"
+
+class Journal;
+
+#define CacheSectors 64		// sectors the cache holds, by default
+#define MaxReadAhead 8		// most sectors a file may read ahead
+
+// One buffer of the cache.  Buffers are linked into a list in order
+// of use (most recent first), and into a hash chain by sector number.
+//
+// While the disk is reading into the buffer or writing from it, the
+// buffer is "busy"; threads that want it wait for it on "ready".
+//
+// A logged buffer that isn't committed yet is "pinned": it mustn't be
+// written to its sector, so it is never chosen for replacement.
+
+class CacheEntry {
+  public:
+    int sector;			// disk sector held here, or -1 if none
+    bool dirty;			// modified since it was read/written?
+    bool busy;			// waiting for the disk?
+    char data[SectorSize];	// the contents of the sector
+    int newer, older;		// neighbours in the list of buffers,
+				// by time of last use (-1 at the ends)
+    int hashNext;		// next buffer in the same hash chain
+    Semaphore *ready;		// V'ed for each waiter once not busy
+    int numWaiting;		// threads waiting on "ready"
+    bool logged;		// metadata, not written to its sector
+				// since it was last changed?
+    bool committed;		// if logged, is it in the journal?
+
+    void Done();		// The disk is done: wake up the waiters
+};
+
+class BufferCache {
+  public:
+    BufferCache(SynchDisk *cachedDisk, int size);
+				// Cache up to "size" sectors of
+				// "cachedDisk"; 0 turns the cache off
+    ~BufferCache();		// De-allocate the cache.  Dirty sectors
+				// are NOT written back; call Sync first.
+
+    void ReadSector(int sector, char *into);
+    void WriteSector(int sector, char *from, bool log = FALSE);
+				// Read/write a whole sector
+    void Read(int sector, char *into, int offset, int numBytes);
+    void Write(int sector, char *from, int offset, int numBytes,
+	       bool log = FALSE);
+				// Read/write part of a sector; a partial
+				// write reads the sector in first, if
+				// it isn't cached.  "log": the sector
+				// is metadata, to go through the journal
+    void ReadAhead(int *sectors, int numSectors);
+				// Start reading these sectors in the
+				// background, if they aren't cached
+    void SetReadAheadLimit(int limit) { aheadLimit = limit; }
+    int ReadAheadLimit() { return aheadLimit; }
+				// Most sectors an open file should ask
+				// to read ahead (0: no read-ahead)
+
+    void SetJournal(Journal *log);
+    Journal *GetJournal() { return journal; }
+				// Journal for logged sectors (NULL: they
+				// are written like any others)
+    bool CommitDue();		// Are enough logged sectors waiting that
+				// the file system should commit them?
+    void Commit();		// Commit every logged sector to the journal
+
+    void Sync();		// Write every dirty sector back to disk
+				// (except logged ones not yet committed)
+    void Invalidate();		// Commit and Sync, then forget every sector
+
+  private:
+    SynchDisk *disk;		// where the sectors really live
+    int numEntries;		// number of buffers
+    CacheEntry *entries;	// the buffers
+    int *buckets;		// first buffer of each hash chain
+    int newest, oldest;		// ends of the list of buffers
+    Semaphore *lock;		// one thread in the cache at a time
+				// (but not while it waits for the disk)
+    int aheadLimit;		// see ReadAheadLimit
+    Journal *journal;		// see SetJournal
+    int journalLimit;		// most sectors pinned at once
+
+    int Find(int sector);	// buffer holding "sector", or -1
+    int Victim(bool clean);	// least recently used buffer that isn't
+				// busy or pinned (and is clean, if
+				// "clean"), or -1
+    int Get(int sector, bool fill);
+				// buffer for "sector", reading it from
+				// disk on a miss if "fill"
+    void Assign(int e, int sector);
+				// make clean buffer "e" hold "sector"
+    void Touch(int e);		// make "e" the most recently used
+    void WaitFor(int e);	// wait until "e" isn't busy
+    void WriteBack(int e);	// write buffer "e" to disk
+    bool Pinned(int e) { return entries[e].logged && !entries[e].committed; }
+    int NumPinned();		// buffers logged but not committed
+    void WriteTransaction();	// commit them (cf. Commit)
+};
+
+#endif // BUFCACHE_H
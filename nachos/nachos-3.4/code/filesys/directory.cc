@@ -2,19 +2,24 @@
 //	Routines to manage a directory of file names.
 //
 //	The directory is a table of fixed length entries; each
-//	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	entry represents a single file (or directory), and contains the
+//	file name, and the location of the file header on disk.  The
+//	fixed size of each directory entry means that we have the
+//	restriction of a fixed maximum size for file names.
 //
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
+//	When every entry is in use, the table doubles in size; the file
+//	holding it grows when it is written back.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	Names are found through hash chains, and free entries through a
+//	free list, so neither needs a search of the whole table.  The
+//	chains are only kept in memory, and rebuilt when the directory
+//	is read in.
+//
+//	Also here is the name cache, which remembers recent lookups (and
+//	failed lookups) across all the directories.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,6 +27,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "system.h"
 #include "filehdr.h"
 #include "directory.h"
 
@@ -37,10 +43,12 @@
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    tableSize = 0;
+    table = NULL;
+    buckets = chain = NULL;
+    Resize(max(size, 1));
+    firstDirty = 0;			// all of it is new
+    lastDirty = tableSize - 1;
 }
 
 //----------------------------------------------------------------------
@@ -51,11 +59,84 @@ Directory::Directory(int size)
 Directory::~Directory()
 { 
     delete [] table;
+    delete [] buckets;
+    delete [] chain;
 } 
 
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Make the table hold "size" entries (at least as many as it has),
+//	keeping the ones it has; the new ones are unused.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    DirectoryEntry *old = table;
+
+    ASSERT(size >= tableSize);
+    table = new DirectoryEntry[size];
+    for (int i = 0; i < size; i++)
+	if (i < tableSize)
+	    table[i] = old[i];
+	else
+	    table[i].inUse = FALSE;
+    delete [] old;
+    tableSize = size;
+
+    delete [] buckets;
+    delete [] chain;
+    buckets = new int[tableSize];
+    chain = new int[tableSize];
+    Rehash();
+}
+
+//----------------------------------------------------------------------
+// Directory::Rehash
+// 	Rebuild the hash chains (one bucket per entry) from the entries
+//	in use, and the free list from the rest.
+//----------------------------------------------------------------------
+
+void
+Directory::Rehash()
+{
+    int i, b;
+
+    for (i = 0; i < tableSize; i++)
+	buckets[i] = -1;
+    freeList = -1;
+    for (i = tableSize - 1; i >= 0; i--)	// so the free list is in order
+	if (table[i].inUse) {
+	    b = Hash(table[i].name) % tableSize;
+	    chain[i] = buckets[b];
+	    buckets[b] = i;
+	} else {
+	    chain[i] = freeList;
+	    freeList = i;
+	}
+}
+
+//----------------------------------------------------------------------
+// Directory::Hash
+// 	Return a hash of a file name (FNV-1a), looking at no more than
+//	FileNameMaxLen characters, as a directory does.
+//----------------------------------------------------------------------
+
+unsigned int
+Directory::Hash(char *name)
+{
+    unsigned int h = 2166136261u;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	h = (h ^ (unsigned char) name[i]) * 16777619u;
+    return h;
+}
+
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table grows
+//	to the size of the file, if that is bigger.  Entries past the
+//	end of the file are unused.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -63,12 +144,21 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    int size = file->Length() / sizeof(DirectoryEntry);
+
+    if (size > tableSize)
+	Resize(size);
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    Rehash();
+    firstDirty = lastDirty = -1;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk: the
+//	entries from the first changed one to the last.  The file only
+//	grows as far as the last entry written; entries beyond it read
+//	back as unused.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -76,7 +166,26 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    if (firstDirty == -1)
+	return;
+    (void) file->WriteAt((char *)&table[firstDirty],
+			 (lastDirty - firstDirty + 1) * sizeof(DirectoryEntry),
+			 firstDirty * sizeof(DirectoryEntry));
+    firstDirty = lastDirty = -1;
+}
+
+//----------------------------------------------------------------------
+// Directory::Changed
+// 	Note that entry "i" has to be written back.
+//----------------------------------------------------------------------
+
+void
+Directory::Changed(int i)
+{
+    if (firstDirty == -1 || i < firstDirty)
+	firstDirty = i;
+    if (i > lastDirty)
+	lastDirty = i;
 }
 
 //----------------------------------------------------------------------
@@ -90,8 +199,8 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    for (int i = buckets[Hash(name) % tableSize]; i != -1; i = chain[i])
+        if (!strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
     return -1;		// name not in directory
 }
@@ -103,43 +212,53 @@ Directory::FindIndex(char *name)
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDir" -- if not NULL, set to whether the name is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
     int i = FindIndex(name);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (i == -1)
+	return -1;
+    if (isDir != NULL)
+	*isDir = table[i].isDir;
+    return table[i].sector;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, or is
+//	too long.  If the directory is full, it doubles in size.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDir)
 { 
-    if (FindIndex(name) != -1)
+    int i, b;
+
+    if (strlen(name) > FileNameMaxLen || FindIndex(name) != -1)
 	return FALSE;
+    if (freeList == -1)
+	Resize(2 * tableSize);		// no space: grow
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    i = freeList;
+    freeList = chain[i];
+    table[i].inUse = TRUE;
+    table[i].isDir = isDir;
+    strncpy(table[i].name, name, FileNameMaxLen + 1);
+    table[i].sector = newSector;
+    b = Hash(name) % tableSize;
+    chain[i] = buckets[b];
+    buckets[b] = i;
+    Changed(i);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -154,16 +273,51 @@ bool
 Directory::Remove(char *name)
 { 
     int i = FindIndex(name);
+    int *link;
 
     if (i == -1)
 	return FALSE; 		// name not in directory
+    for (link = &buckets[Hash(name) % tableSize]; *link != i;
+	 link = &chain[*link])
+	;
+    *link = chain[i];		// unlink it from its hash chain
     table[i].inUse = FALSE;
+    chain[i] = freeList;
+    freeList = i;
+    Changed(i);
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if no entry of the directory is in use.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Entry
+// 	Return entry "i" of the table (in use or not), or NULL if the
+//	table has no entry "i".  For walking through the directory.
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::Entry(int i)
+{
+    return (i < tableSize) ? &table[i] : NULL;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory; directories get a
+//	trailing '/'.
 //----------------------------------------------------------------------
 
 void
@@ -171,7 +325,29 @@ Directory::List()
 {
    for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+	    printf("%s%s\n", table[i].name, table[i].isDir ? "/" : "");
+}
+
+//----------------------------------------------------------------------
+// Directory::PrintExtents
+// 	For each file in the directory, print how many sectors it has,
+//	and how many extents (runs of consecutive sectors) they are in.
+//----------------------------------------------------------------------
+
+void
+Directory::PrintExtents()
+{
+    FileHeader *hdr = new FileHeader;
+
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse) {
+	    hdr->FetchFrom(table[i].sector);
+	    printf("  %-*s %5d sectors, %4d extents\n", FileNameMaxLen,
+		   table[i].name,
+		   divRoundUp(hdr->MaxLength(), SectorSize),
+		   hdr->NumExtents());
+	}
+    delete hdr;
 }
 
 //----------------------------------------------------------------------
@@ -195,3 +371,88 @@ Directory::Print()
     printf("\n");
     delete hdr;
 }
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Initialize an empty name cache.
+//----------------------------------------------------------------------
+
+NameCache::NameCache()
+{
+    entries = new NameCacheEntry[NameCacheSize];
+    for (int i = 0; i < NameCacheSize; i++)
+	entries[i].dir = -1;
+}
+
+NameCache::~NameCache()
+{
+    delete [] entries;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Slot
+// 	Return the entry where "name" in "dir" is cached, if it is.  The
+//	cache is direct mapped: each name can only be in one entry.
+//----------------------------------------------------------------------
+
+NameCacheEntry *
+NameCache::Slot(int dir, char *name)
+{
+    return &entries[(Directory::Hash(name) ^ (unsigned int) dir)
+		    % NameCacheSize];
+}
+
+//----------------------------------------------------------------------
+// NameCache::Lookup
+// 	If the cache knows what "name" in directory "dir" refers to,
+//	return TRUE, and the sector of its header (-1 if there is no
+//	such file) and whether it is a directory.
+//----------------------------------------------------------------------
+
+bool
+NameCache::Lookup(int dir, char *name, int *sector, bool *isDir)
+{
+    NameCacheEntry *e = Slot(dir, name);
+
+    if (e->dir != dir || strncmp(e->name, name, FileNameMaxLen)) {
+	stats->numNameMisses++;
+	return FALSE;
+    }
+    stats->numNameHits++;
+    *sector = e->sector;
+    *isDir = e->isDir;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Enter
+// 	Remember that "name" in directory "dir" refers to the file whose
+//	header is at "sector" (or, if -1, to no file), replacing whatever
+//	was cached in its entry.
+//----------------------------------------------------------------------
+
+void
+NameCache::Enter(int dir, char *name, int sector, bool isDir)
+{
+    NameCacheEntry *e = Slot(dir, name);
+
+    e->dir = dir;
+    strncpy(e->name, name, FileNameMaxLen);
+    e->name[FileNameMaxLen] = '\0';
+    e->sector = sector;
+    e->isDir = isDir;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Purge
+// 	Forget every name cached for directory "dir" -- when it is
+//	removed, since its sector may be reused for another directory.
+//----------------------------------------------------------------------
+
+void
+NameCache::Purge(int dir)
+{
+    for (int i = 0; i < NameCacheSize; i++)
+	if (entries[i].dir == dir)
+	    entries[i].dir = -1;
+}
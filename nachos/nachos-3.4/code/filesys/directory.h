@@ -1,15 +1,21 @@
-// directory.h 
+// directory.h
 //	Data structures to manage a UNIX-like directory of file names.
-// 
+//
 //      A directory is a table of pairs: <file name, sector #>,
-//	giving the name of each file in the directory, and 
+//	giving the name of each file in the directory, and
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry can
+//	also name another directory, so directories form a tree.
+//
+//	In memory, the entries are also linked into hash chains by
+//	name, so a name is found without looking at the rest of the
+//	directory; and the table grows when it is full.  Only the
+//	entries that have changed are written back.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -19,8 +25,9 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		27	// for simplicity, we assume
+					// file names are <= 27 characters long
+#define NameCacheSize		1024	// names the lookup cache holds
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,9 +39,10 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
-    int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
+    bool isDir;				// Does it name a directory?
+    int sector;				// Location on disk to find the
+					//   FileHeader for this file
+    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for
 					// the trailing '\0'
 };
 
@@ -42,11 +50,12 @@ class DirectoryEntry {
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, which
+// grows along with the table.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.
 
 class Directory {
   public:
@@ -55,29 +64,84 @@ class Directory {
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
+    void WriteBack(OpenFile *file);	// Write modifications to
 					// directory contents back to disk
 
-    int Find(char *name);		// Find the sector number of the 
-					// FileHeader for file: "name"
+    int Find(char *name, bool *isDir = NULL);
+					// Find the sector number of the
+					// FileHeader for file: "name", and
+					// whether it is a directory
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir = FALSE);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool IsEmpty();			// No entries in use?
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
+    void PrintExtents();		// Print how fragmented each file is
+
+    DirectoryEntry *Entry(int i);	// Entry "i" of the table, or NULL
+					// past the end
+
+    static unsigned int Hash(char *name); // Hash of a file name
 
   private:
     int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
-
-    int FindIndex(char *name);		// Find the index into the directory 
+    DirectoryEntry *table;		// Table of pairs:
+					// <file name, file header location>
+    int *buckets;			// First entry of each hash chain
+    int *chain;				// Next entry in the same hash chain,
+					// or, if unused, on the free list
+    int freeList;			// First unused entry, or -1
+    int firstDirty, lastDirty;		// Entries changed since the last
+					// FetchFrom/WriteBack (-1: none)
+
+    int FindIndex(char *name);		// Find the index into the directory
 					//  table corresponding to "name"
+    void Resize(int size);		// Make the table "size" entries
+    void Rehash();			// Rebuild the hash chains and the
+					// free list
+    void Changed(int i);		// Note that entry "i" has changed
+};
+
+// A cache of recent name lookups, in front of the directories: which
+// file a name in a directory (known by its header sector) refers to,
+// or that there is no such file -- so resolving a path the second
+// time doesn't search the directories along it.  Entries must be
+// updated whenever a name is added to or removed from a directory.
+
+class NameCacheEntry {
+  public:
+    int dir;				// Header sector of the directory,
+					// or -1 if the entry is unused
+    char name[FileNameMaxLen + 1];	// The name looked up
+    int sector;				// What it refers to, or -1 if
+					// there is no such file
+    bool isDir;				// Is it a directory?
+};
+
+class NameCache {
+  public:
+    NameCache();			// Initialize an empty cache
+    ~NameCache();
+
+    bool Lookup(int dir, char *name, int *sector, bool *isDir);
+					// If the cache knows about "name" in
+					// "dir", return TRUE and what it is
+    void Enter(int dir, char *name, int sector, bool isDir);
+					// Remember what "name" in "dir" is
+    void Purge(int dir);		// Forget every name in "dir"
+
+  private:
+    NameCacheEntry *entries;		// Indexed by hash of <dir, name>
+
+    NameCacheEntry *Slot(int dir, char *name);
 };
 
 #endif // DIRECTORY_H
@@ -5,10 +5,19 @@
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	disk sector containing that portion of the file data -- plus
+//	a single indirect and a doubly indirect block, for files too
+//	big for the table.  The table size is chosen so that the file
+//	header will be just big enough to fit in one disk sector.
+//
+//	Index blocks are read and written through the buffer cache,
+//	an entry at a time.
+//
+//	Sectors are allocated in extents -- runs of free sectors -- so
+//	that a file's sectors are contiguous on disk as far as possible,
+//	and reading it sequentially doesn't seek (cf. AllocateRun).  An
+//	index block is allocated in the same run as the data sectors it
+//	points to, just ahead of them.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,6 +36,119 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// IndexBlocks
+// 	Return how many index blocks a file with "n" data sectors needs.
+//----------------------------------------------------------------------
+
+static int
+IndexBlocks(int n)
+{
+    int blocks = 0;
+
+    if (n > NumDirect)
+	blocks++;				// single indirect
+    if (n > NumDirect + NumIndirect)	// double indirect, and the
+	blocks += 1 + divRoundUp(n - NumDirect - NumIndirect, NumIndirect);
+    return blocks;			//  blocks it points to
+}
+
+//----------------------------------------------------------------------
+// AllocateNear
+// 	Allocate the first free sector at or after "hint" (wrapping
+//	around to the start of the disk), so that the sectors of a file
+//	tend to be contiguous.  There must be a free sector.
+//----------------------------------------------------------------------
+
+static int
+AllocateNear(BitMap *freeMap, int hint)
+{
+    for (int i = 0; i < NumSectors; i++) {
+	int sector = (hint + i) % NumSectors;
+
+	if (!freeMap->Test(sector)) {
+	    freeMap->Mark(sector);
+	    return sector;
+	}
+    }
+    ASSERT(FALSE);			// caller checked there was room
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AllocateRun
+// 	Allocate a run of up to "want" free sectors in a row, for a file
+//	that will be "room" sectors long once it has them.  Return the
+//	first sector, and the number allocated in "*length".  There must
+//	be a free sector.
+//
+//	If the sector at "hint" (right after the file's last one) is
+//	free, the run starts there (next fit), so the file stays
+//	contiguous.  Otherwise, we take the free run that best fits the
+//	whole file -- not just "want", since a file that is growing will
+//	likely keep growing -- aligned to a track if that means crossing
+//	fewer tracks.
+//
+//	With extent allocation off (-fa sector), this just allocates one
+//	sector, the first free one at or after "hint".
+//----------------------------------------------------------------------
+
+static int
+AllocateRun(BitMap *freeMap, int hint, int want, int room, int *length)
+{
+    int start;
+
+    if (!extentAllocation) {
+	*length = 1;
+	return AllocateNear(freeMap, hint);
+    }
+    if (hint < NumSectors && !freeMap->Test(hint)) {
+	start = hint;
+	*length = freeMap->RunLength(hint, want);
+    } else {
+	start = freeMap->FindRun(room, SectorsPerTrack, length);
+	*length = min(*length, want);
+    }
+    ASSERT(start != -1);		// caller checked there was room
+    for (int i = 0; i < *length; i++)
+	freeMap->Mark(start + i);
+    return start;
+}
+
+//----------------------------------------------------------------------
+// GetEntry/PutEntry/NewIndexBlock
+// 	Read or write entry "i" of index block "block", or initialize
+//	a newly allocated index block, with every entry -1.  Index blocks
+//	are metadata, so writes to them are logged.
+//----------------------------------------------------------------------
+
+static int
+GetEntry(int block, int i)
+{
+    int sector;
+
+    bufferCache->Read(block, (char *) &sector, i * sizeof(int), sizeof(int));
+    return sector;
+}
+
+static void
+PutEntry(int block, int i, int sector)
+{
+    bufferCache->Write(block, (char *) &sector, i * sizeof(int), sizeof(int),
+		       TRUE);
+}
+
+static int
+NewIndexBlock(int block)
+{
+    int entries[NumIndirect];
+
+    for (int i = 0; i < NumIndirect; i++)
+	entries[i] = -1;
+    bufferCache->WriteSector(block, (char *) entries, TRUE);
+    return block;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -35,22 +157,143 @@
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the initial size of the file, in bytes
 //----------------------------------------------------------------------
 
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    numBytes = numSectors = 0;
+    singleIndirect = doubleIndirect = -1;
+    if (!Grow(freeMap, divRoundUp(fileSize, SectorSize)))
 	return FALSE;		// not enough space
+    numBytes = fileSize;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Make the file "newSize" bytes long.  If it doesn't have enough
+//	sectors for that, allocate them out of the map of free disk
+//	blocks -- ExtendBatch at a time at least, if there is room, so
+//	that a file written a little at a time doesn't need the free map
+//	on every write, and gets contiguous sectors.  With extent
+//	allocation, a file gets as many more sectors as it has, up to a
+//	track's worth, so files growing side by side don't end up
+//	interleaved a few sectors at a time.
+//	Return FALSE (leaving the file as it was) if there isn't enough
+//	room on the disk.  Files never shrink.
+//
+//	"freeMap" is the bit map of free disk sectors (only used if
+//	  more sectors are needed; cf. MaxLength)
+//	"newSize" is the new length of the file, in bytes
+//----------------------------------------------------------------------
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+bool
+FileHeader::Extend(BitMap *freeMap, int newSize)
+{
+    int needed = divRoundUp(newSize, SectorSize);
+    int batch = ExtendBatch;
+
+    if (extentAllocation)		// bigger files, bigger extents
+	batch = max(batch, min(numSectors, SectorsPerTrack));
+    if (needed > numSectors
+	&& !Grow(freeMap, min(max(needed, numSectors + batch),
+			      MaxFileSectors))
+	&& !Grow(freeMap, needed))
+	return FALSE;
+    numBytes = max(numBytes, newSize);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Grow
+// 	Allocate data sectors (and the index blocks to find them) until
+//	the file has "newSectors" of them.  They are allocated in runs,
+//	starting right after the file's last sector if possible; each
+//	index block goes just before the first data sector it points to.
+//	Return FALSE, allocating nothing, if there isn't enough room.
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Grow(BitMap *freeMap, int newSectors)
+{
+    int left, hint, runStart = 0, runLength = 0;
+    int blocks[3], k, n;		// new index blocks, then data sector
+
+    if (newSectors <= numSectors)
+	return TRUE;
+    left = newSectors - numSectors
+	   + IndexBlocks(newSectors) - IndexBlocks(numSectors);
+    if (newSectors > MaxFileSectors || freeMap->NumClear() < left)
+	return FALSE;
+
+    hint = (numSectors > 0) ? SectorOf(numSectors - 1) + 1
+			    : NumSectors;	// anywhere
+    for (; numSectors < newSectors; numSectors++) {
+	n = IndexBlocks(numSectors + 1) - IndexBlocks(numSectors);
+	for (k = 0; k <= n; k++, left--) {
+	    if (runLength == 0)
+		runStart = AllocateRun(freeMap, hint, left, numSectors + left,
+				       &runLength);
+	    blocks[k] = runStart++;
+	    runLength--;
+	    hint = runStart;
+	}
+	SetSector(numSectors, blocks[n], blocks);
+    }
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::SectorOf
+// 	Return the disk sector holding data sector "i" of the file,
+//	looking in the index blocks if need be.
+//----------------------------------------------------------------------
+
+int
+FileHeader::SectorOf(int i)
+{
+    ASSERT(i >= 0 && i < numSectors);
+    if (i < NumDirect)
+	return dataSectors[i];
+    i -= NumDirect;
+    if (i < NumIndirect)
+	return GetEntry(singleIndirect, i);
+    i -= NumIndirect;
+    return GetEntry(GetEntry(doubleIndirect, i / NumIndirect), i % NumIndirect);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SetSector
+// 	Record that data sector "i" of the file is disk sector "sector".
+//	If that takes new index blocks, "newBlocks" are the (already
+//	allocated) sectors to put them in.
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetSector(int i, int sector, int *newBlocks)
+{
+    if (i < NumDirect) {
+	dataSectors[i] = sector;
+	return;
+    }
+    i -= NumDirect;
+    if (i < NumIndirect) {
+	if (singleIndirect == -1)
+	    singleIndirect = NewIndexBlock(*newBlocks);
+	PutEntry(singleIndirect, i, sector);
+	return;
+    }
+    i -= NumIndirect;
+    if (doubleIndirect == -1)
+	doubleIndirect = NewIndexBlock(*newBlocks++);
+    if (i % NumIndirect == 0)
+	PutEntry(doubleIndirect, i / NumIndirect, NewIndexBlock(*newBlocks));
+    PutEntry(GetEntry(doubleIndirect, i / NumIndirect), i % NumIndirect,
+	     sector);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
 // 	De-allocate all the space allocated for data blocks for this file.
@@ -61,9 +304,19 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int i, sector;
+
+    for (i = 0; i < numSectors; i++) {
+	sector = SectorOf(i);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (singleIndirect != -1)
+	freeMap->Clear(singleIndirect);
+    if (doubleIndirect != -1) {
+	for (i = 0; i < IndexBlocks(numSectors) - 2; i++)
+	    freeMap->Clear(GetEntry(doubleIndirect, i));
+	freeMap->Clear(doubleIndirect);
     }
 }
 
@@ -77,12 +330,13 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    bufferCache->ReadSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	through the journal.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +344,7 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    synchDisk->WriteSector(sector, (char *)this); 
+    bufferCache->WriteSector(sector, (char *)this, TRUE);
 }
 
 //----------------------------------------------------------------------
@@ -106,7 +360,7 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    return SectorOf(offset / SectorSize);
 }
 
 //----------------------------------------------------------------------
@@ -120,6 +374,37 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::MaxLength
+// 	Return how long the file can get without allocating more sectors.
+//----------------------------------------------------------------------
+
+int
+FileHeader::MaxLength()
+{
+    return numSectors * SectorSize;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NumExtents
+// 	Return the number of extents (runs of consecutive sectors) the
+//	file's data is in -- 1 if the file is contiguous on disk.
+//----------------------------------------------------------------------
+
+int
+FileHeader::NumExtents()
+{
+    int count = 0, sector, last = -1;
+
+    for (int i = 0; i < numSectors; i++) {
+	sector = SectorOf(i);
+	if (i == 0 || sector != last + 1)
+	    count++;
+	last = sector;
+    }
+    return count;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -133,11 +418,18 @@ FileHeader::Print()
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+    for (i = 0; i < numSectors; i = k) {	// one extent at a time
+	for (k = i + 1; k < numSectors && SectorOf(k) == SectorOf(i) + k - i;
+	     k++)
+	    ;
+	if (k - i == 1)
+	    printf("%d ", SectorOf(i));
+	else
+	    printf("%d-%d ", SectorOf(i), SectorOf(k - 1));
+    }
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+	bufferCache->ReadSector(SectorOf(i), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,8 +17,13 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumDirect 	((int) ((SectorSize - 4 * sizeof(int)) / sizeof(int)))
+#define NumIndirect 	((int) (SectorSize / sizeof(int)))
+					// sector numbers in an index block
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
+#define ExtendBatch	8		// sectors to add at a time, at least,
+					// when a write grows a file
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
@@ -28,8 +33,19 @@
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.  So the header only has room for the first
+// NumDirect data sectors; the next NumIndirect are listed in an index
+// block (the single indirect block), and the rest in index blocks that
+// are themselves listed in the double indirect block.  That is more
+// than the whole disk.
+//
+// Files can grow: a write past the end allocates more sectors.  The
+// header may hold more sectors than the file's length needs, since
+// growing files are given ExtendBatch sectors at a time.
+//
+// Sectors are allocated a run at a time, preferably right after the
+// file's last sector, so a file is usually a few extents -- runs of
+// consecutive sectors -- even though the header lists every sector.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -40,8 +56,11 @@ class FileHeader {
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
+    bool Extend(BitMap *bitMap, int newSize);	// Make the file "newSize"
+						//  bytes long, allocating
+						//  more space if need be
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
-						//  data blocks
+						//  data (and index) blocks
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
     void WriteBack(int sectorNumber); 	// Write modifications to file header
@@ -53,6 +72,10 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    int MaxLength();			// Length the file can grow to
+					// without allocating more sectors
+    int NumExtents();			// Number of runs of consecutive
+					// sectors the data is in
 
     void Print();			// Print the contents of the file.
 
@@ -61,6 +84,19 @@ class FileHeader {
     int numSectors;			// Number of data sectors in the file
     int dataSectors[NumDirect];		// Disk sector numbers for each data 
 					// block in the file
+    int singleIndirect;			// Index block for the data sectors
+					// after those, or -1
+    int doubleIndirect;			// Index block of index blocks for
+					// the rest, or -1
+
+    int SectorOf(int i);		// Disk sector of data sector "i"
+    void SetSector(int i, int sector, int *newBlocks);
+					// Make data sector "i" be "sector",
+					// using "newBlocks" for any index
+					// blocks that takes
+    bool Grow(BitMap *freeMap, int newSectors);
+					// Allocate sectors until there are
+					// "newSectors"; FALSE if no room
 };
 
 #endif // FILEHDR_H
@@ -7,37 +7,54 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in a directory
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers, starting
+//	     at the root directory
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them
-//	on bootup.
+//      Both the bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and the root directory
+//	are located in specific sectors (sector 0 and sector 1), so that
+//	the file system can find them on bootup.  Files are named by
+//	paths such as "/a/b/c" (the leading '/' is optional), each
+//	component naming a directory in the one before.
 //
-//	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	The headers of open files are kept in memory, one copy per file
+//	however many times it is open (cf. Inode in filesys.h), and are
+//	written back when the file is last closed, or at Sync.  A file
+//	removed while it is open keeps its sectors until then.
 //
-//	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	The file system assumes that the bitmap and root directory files
+//	are kept "open" continuously while Nachos is running.  The bitmap
+//	and the root directory themselves are read into memory when the
+//	file system starts, and stay there; other directories are read
+//	in the first time a path goes through them, and stay too.  Names
+//	looked up in the directories are remembered in a name cache, both
+//	those that were found and those that were not.
+//
+//	Operations (such as Create, Remove) that modify a directory
+//	and/or the bitmap change the copies in memory, and note that they
+//	are dirty; they are written back to their files at the next
+//	commit, not on every operation.  If an operation fails part way,
+//	it undoes the changes it has made to them.
+//
+//	Every write of metadata (the bitmap, directories, file headers
+//	and index blocks) goes through a journal (cf. journal.h), placed
+//	after the bitmap and root directory headers.  Changes are
+//	committed together, between operations: at Sync, or when enough
+//	are waiting.  So if Nachos stops, the disk holds the metadata as
+//	of the last commit, once the journal is replayed on mount.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   there is no synchronization for concurrent accesses to a file
+//	     (Create, Remove and Extend are done one at a time, though)
+//	   file data isn't journaled: after a crash, a file may have
+//	     sectors that were never written (cf. BufferCache::Write)
+//	   an operation that changes more metadata than the journal
+//	     holds at once is committed in parts
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -50,16 +67,22 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "journal.h"
+#include "synch.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known
+// and the root directory.  These file headers are placed in well-known
 // sectors, so that they can be located on boot-up.
 #define FreeMapSector 0
 #define DirectorySector 1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number
-// of files that can be loaded onto the disk.
+// The metadata journal comes right after them, also in a well-known
+// place: the file system replays it before it reads anything else.
+#define JournalSector 2
+
+// Initial file sizes for the bitmap and the root directory; directories
+// grow as files are added to them.
 #define FreeMapFileSize (NumSectors / BitsInByte)
 #define NumDirEntries 10
 #define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
@@ -80,10 +103,29 @@
 FileSystem::FileSystem(bool format)
 {
     DEBUG('f', "Initializing the file system.\n");
+    fileSystem = this; // opening the files below needs the inode table
+    lock = new Semaphore("file system", 1);
+    lockHolder = NULL;
+    lockDepth = 0;
+    freeMap = new BitMap(NumSectors);
+    freeMapDirty = FALSE;
+    names = new NameCache;
+    inodes = new Inode *[InodeBuckets];
+    for (int i = 0; i < InodeBuckets; i++)
+        inodes[i] = NULL;
+    dirs = new OpenDirectory;
+    dirs->sector = DirectorySector;
+    dirs->directory = new Directory(NumDirEntries);
+    dirs->dirty = FALSE;
+    dirs->next = NULL;
+    journal = new Journal(synchDisk, JournalSector);
+    if (format)
+        journal->Format();
+    else
+        journal->Recover(); // finish what was last committed
+    bufferCache->SetJournal(journal);
     if (format)
     {
-        BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
         FileHeader *mapHdr = new FileHeader;
         FileHeader *dirHdr = new FileHeader;
 
@@ -93,6 +135,8 @@ FileSystem::FileSystem(bool format)
         // (make sure no one else grabs these!)
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
+        for (int i = 0; i < JournalSectors; i++)
+            freeMap->Mark(JournalSector + i);
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
@@ -114,7 +158,9 @@ FileSystem::FileSystem(bool format)
         // while Nachos is running.
 
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
+        dirs->file = new OpenFile(DirectorySector);
+        freeMapFile->SetMetadata();
+        dirs->file->SetMetadata();
 
         // Once we have the files "open", we can write the initial version
         // of each file back to disk.  The directory at this point is completely
@@ -124,236 +170,628 @@ FileSystem::FileSystem(bool format)
 
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
         freeMap->WriteBack(freeMapFile); // flush changes to disk
-        directory->WriteBack(directoryFile);
+        dirs->directory->WriteBack(dirs->file);
 
         if (DebugIsEnabled('f'))
         {
             freeMap->Print();
-            directory->Print();
-
-            delete freeMap;
-            delete directory;
-            delete mapHdr;
-            delete dirHdr;
+            dirs->directory->Print();
         }
+        delete mapHdr;
+        delete dirHdr;
     }
     else
     {
         // if we are not formatting the disk, just open the files representing
-        // the bitmap and directory; these are left open while Nachos is running
+        // the bitmap and directory; these are left open while Nachos is
+        // running, and what they hold is kept in memory
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
+        dirs->file = new OpenFile(DirectorySector);
+        freeMapFile->SetMetadata();
+        dirs->file->SetMetadata();
+        freeMap->FetchFrom(freeMapFile);
+        dirs->directory->FetchFrom(dirs->file);
+    }
+}
+
+
+//----------------------------------------------------------------------
+// FileSystem::Acquire
+// 	Take the file system lock.  The thread holding it may take it
+//	again: writing a directory back at Sync can make its file grow,
+//	which comes back in through Extend.
+//----------------------------------------------------------------------
+
+void FileSystem::Acquire()
+{
+    if (lockHolder == currentThread)
+    {
+        lockDepth++;
+        return;
     }
+    lock->P();
+    lockHolder = currentThread;
+    lockDepth = 1;
+}
 
-    // Cai dat
-    file_table = new OpenFile *[MAX_FILE];
-    index = 0;
-    for (int i = 0; i < MAX_FILE; ++i)
+//----------------------------------------------------------------------
+// FileSystem::Release
+// 	Let go of the file system lock, once for each Acquire.  At the
+//	end of an operation, commit the metadata changes made so far, if
+//	the journal is filling up.
+//----------------------------------------------------------------------
+
+void FileSystem::Release()
+{
+    ASSERT(lockHolder == currentThread);
+    if (lockDepth == 1 && bufferCache->CommitDue())
+        Commit();
+    if (--lockDepth == 0)
     {
-        file_table[i] = NULL;
+        lockHolder = NULL;
+        lock->V();
     }
-    file_table[index++] = this->Open("stdin", STDIN);
-    file_table[index++] = this->Open("stdout", STDOUT);
-    this->Create("stdin", 0);
-    this->Create("stdout", 0);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::GetDirectory
+// 	Return the directory whose header is at "sector", reading it into
+//	memory if it isn't there yet.  Must hold the lock.
+//
+//	"sector" -- where the directory's header is
+//----------------------------------------------------------------------
+
+OpenDirectory *FileSystem::GetDirectory(int sector)
+{
+    OpenDirectory *dir;
+
+    for (dir = dirs; dir != NULL; dir = dir->next)
+        if (dir->sector == sector)
+            return dir;
+
+    DEBUG('f', "Reading directory at sector %d\n", sector);
+    dir = new OpenDirectory;
+    dir->sector = sector;
+    dir->file = new OpenFile(sector);
+    dir->file->SetMetadata();
+    dir->directory = new Directory(NumDirEntries);
+    dir->directory->FetchFrom(dir->file);
+    dir->dirty = FALSE;
+    dir->next = dirs->next; // the root stays first
+    dirs->next = dir;
+    return dir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Return the header sector of the file called "leaf" in directory
+//	"dir", or -1 if there is none, asking the name cache first.  What
+//	the directory says is entered in the cache, even if the name
+//	isn't there.  Must hold the lock.
+//
+//	"dir" -- the directory to look in
+//	"leaf" -- a name in it (not a path)
+//	"isDir" -- set to whether the file is a directory
+//----------------------------------------------------------------------
+
+int FileSystem::Lookup(OpenDirectory *dir, char *leaf, bool *isDir)
+{
+    int sector;
+
+    if (names->Lookup(dir->sector, leaf, &sector, isDir))
+        return sector;
+    *isDir = FALSE;
+    sector = dir->directory->Find(leaf, isDir);
+    names->Enter(dir->sector, leaf, sector, *isDir);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Resolve
+// 	Walk path "name" down from the root directory, and return the
+//	directory its last component should be in; the component itself
+//	is copied into "leaf".  Return NULL if a directory along the
+//	path is missing (or is a file), or if a component is too long,
+//	or if the path has no components at all.  Must hold the lock.
+//
+//	"name" -- the path, components separated by '/'
+//	"leaf" -- room for FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+OpenDirectory *FileSystem::Resolve(char *name, char *leaf)
+{
+    OpenDirectory *dir = dirs;
+    char *end;
+    int sector, len;
+    bool isDir;
+
+    for (;;)
+    {
+        while (*name == '/')
+            name++;
+        for (end = name; *end != '\0' && *end != '/'; end++)
+            ;
+        len = end - name;
+        if (len == 0 || len > FileNameMaxLen)
+            return NULL;
+        strncpy(leaf, name, len);
+        leaf[len] = '\0';
+
+        for (name = end; *name == '/'; name++)
+            ;
+        if (*name == '\0')
+            return dir; // "leaf" was the last component
+
+        sector = Lookup(dir, leaf, &isDir);
+        if (sector == -1 || !isDir)
+            return NULL;
+        dir = GetDirectory(sector);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindFile
+// 	Return the header sector of the file (or directory) at path
+//	"name", or -1 if there is none.
+//----------------------------------------------------------------------
+
+int FileSystem::FindFile(char *name)
+{
+    char leaf[FileNameMaxLen + 1];
+    OpenDirectory *dir;
+    int sector = -1;
+    bool isDir;
+
+    Acquire();
+    dir = Resolve(name, leaf);
+    if (dir != NULL)
+        sector = Lookup(dir, leaf, &isDir);
+    Release();
+    return sector;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	The file starts out "initialSize" bytes long; writing past the
+//	end makes it longer (cf. Extend).
+//
+//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::Create(char *name, int initialSize)
+{
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return Make(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeDirectory
+// 	Create an empty directory (similar to UNIX mkdir).  Its file
+//	starts out empty, and grows as files are added to it.
+//
+//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//
+//	"name" -- path of the directory to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::MakeDirectory(char *name)
+{
+    DEBUG('f', "Making directory %s\n", name);
+    return Make(name, 0, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Make
+// 	Create a file or a directory.
 //
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
 //	  Add the name to the directory
 //	  Store the new file header on disk
-//	  Flush the changes to the bitmap and the directory back to disk
-//
-//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//	  Note that the bitmap and the directory have to be written back
+//	A new directory is also put in memory, dirty, so that its (empty)
+//	table is written to its file at the next Sync.
 //
-// 	Create fails if:
+// 	Make fails if:
+//		a directory along the path is missing, or a name is too long
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
+//	 	no room to grow the directory
 //	 	no free space for data blocks for the file
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDir" -- is it a directory?
 //----------------------------------------------------------------------
 
-bool FileSystem::Create(char *name, int initialSize)
+bool FileSystem::Make(char *name, int initialSize, bool isDir)
 {
-    Directory *directory;
-    BitMap *freeMap;
+    char leaf[FileNameMaxLen + 1];
+    OpenDirectory *dir, *sub;
     FileHeader *hdr;
     int sector;
-    bool success;
-
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    bool success, found;
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
-        success = FALSE; // file is already in directory
+    Acquire();
+    dir = Resolve(name, leaf);
+    if (dir == NULL || Lookup(dir, leaf, &found) != -1)
+        success = FALSE; // no such directory, or file is already there
     else
     {
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
         sector = freeMap->Find(); // find a sector to hold the file header
         if (sector == -1)
             success = FALSE; // no free block for file header
-        else if (!directory->Add(name, sector))
+        else if (!dir->directory->Add(leaf, sector, isDir))
+        {
+            freeMap->Clear(sector);
             success = FALSE; // no space in directory
+        }
         else
         {
             hdr = new FileHeader;
             if (!hdr->Allocate(freeMap, initialSize))
+            {
+                dir->directory->Remove(leaf);
+                freeMap->Clear(sector);
                 success = FALSE; // no space on disk for data
+            }
             else
             {
                 success = TRUE;
-                // everthing worked, flush all changes back to disk
+                // everthing worked; the header goes to disk now, the
+                // directory and bitmap at the next Sync
                 hdr->WriteBack(sector);
-                directory->WriteBack(directoryFile);
-                freeMap->WriteBack(freeMapFile);
+                freeMapDirty = dir->dirty = TRUE;
+                names->Enter(dir->sector, leaf, sector, isDir);
+                if (isDir)
+                {
+                    sub = GetDirectory(sector);
+                    sub->dirty = TRUE;
+                }
             }
             delete hdr;
         }
-        delete freeMap;
     }
-    delete directory;
+    Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Make an open file longer, allocating more data sectors for it if
+//	it needs them.  Called by OpenFile::WriteAt, for writes past the
+//	end of the file.
+//
+//	Return TRUE if everything goes ok; FALSE, changing nothing, if
+//	there is no room on the disk.
+//
+//	"hdr" -- the file's header (in memory)
+//	"sector" -- where the header lives on disk
+//	"newSize" -- the new length of the file
+//----------------------------------------------------------------------
+
+bool FileSystem::Extend(Inode *inode, int newSize)
+{
+    bool success;
+
+    DEBUG('f', "Extending file at sector %d to %d bytes\n", inode->sector,
+          newSize);
+
+    Acquire();
+    if (newSize > inode->hdr->MaxLength())
+        freeMapDirty = TRUE; // new sectors needed
+    success = inode->hdr->Extend(freeMap, newSize);
+    if (success)
+        inode->dirty = TRUE; // written back at close, or the next Sync
+    Release();
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::OpenInode
+// 	Return the inode of the file whose header is at "sector", with one
+//	more reference to it.  If the file isn't open yet, its header is
+//	read in; otherwise the copy already in memory is shared.
+//
+//	"sector" -- where the file's header is on disk
+//----------------------------------------------------------------------
+
+Inode *FileSystem::OpenInode(int sector)
+{
+    Inode *inode;
+
+    Acquire();
+    for (inode = inodes[sector % InodeBuckets]; inode != NULL;
+         inode = inode->next)
+        if (inode->sector == sector)
+            break;
+    if (inode == NULL)
+    {
+        inode = new Inode;
+        inode->sector = sector;
+        inode->hdr = new FileHeader;
+        inode->hdr->FetchFrom(sector);
+        inode->refCount = 0;
+        inode->dirty = inode->removed = FALSE;
+        inode->next = inodes[sector % InodeBuckets];
+        inodes[sector % InodeBuckets] = inode;
+    }
+    inode->refCount++;
+    Release();
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CloseInode
+// 	Drop a reference to an inode.  When the last one goes, the header
+//	is written back if it changed -- or, if the file was removed while
+//	it was open, the file's sectors are freed -- and the inode is
+//	dropped from memory.
+//
+//	"inode" -- the inode, from OpenInode
+//----------------------------------------------------------------------
+
+void FileSystem::CloseInode(Inode *inode)
+{
+    Inode **prev;
+
+    Acquire();
+    ASSERT(inode->refCount > 0);
+    if (--inode->refCount == 0)
+    {
+        for (prev = &inodes[inode->sector % InodeBuckets]; *prev != inode;
+             prev = &(*prev)->next)
+            ;
+        *prev = inode->next;
+        if (inode->removed)
+            FreeFile(inode);
+        else if (inode->dirty)
+            inode->hdr->WriteBack(inode->sector);
+        delete inode->hdr;
+        delete inode;
+    }
+    Release();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FreeFile
+// 	Give back the data sectors and the header sector of a removed
+//	file.  Must hold the lock.
+//----------------------------------------------------------------------
+
+void FileSystem::FreeFile(Inode *inode)
+{
+    DEBUG('f', "Freeing file at sector %d\n", inode->sector);
+    inode->hdr->Deallocate(freeMap); // remove data blocks
+    freeMap->Clear(inode->sector);   // remove header block
+    freeMapDirty = TRUE;             // written back at the next Sync
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WriteInodes
+// 	Write back the header of every open file that has changed.  Must
+//	hold the lock.
+//----------------------------------------------------------------------
+
+void FileSystem::WriteInodes()
+{
+    Inode *inode;
+
+    for (int i = 0; i < InodeBuckets; i++)
+        for (inode = inodes[i]; inode != NULL; inode = inode->next)
+            if (inode->dirty && !inode->removed)
+            {
+                inode->hdr->WriteBack(inode->sector);
+                inode->dirty = FALSE;
+            }
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.
 //	To open a file:
-//	  Find the location of the file's header, using the directory
+//	  Find the location of the file's header, using the directories
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 OpenFile *FileSystem::Open(char *name)
 {
-    // int freeSlot = this->GetAllocatedSlot();
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    sector = FindFile(name);
     if (sector >= 0)
         openFile = new OpenFile(sector); // name was found in directory
-    delete directory;
 
-    index++;
-    return file_table[index - 1]; // return NULL if not found
+    return openFile; // return NULL if not found
 }
 
 OpenFile *FileSystem::Open(char *name, int type)
 {
-    printf("Open file %s\n", name);
-    int freeSlot = this->GetAllocatedSlot();
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    sector = FindFile(name);
     if (sector >= 0)
-        file_table[freeSlot] = new OpenFile(sector, type); // name was found in directory
-    delete directory;
+        openFile = new OpenFile(sector, type); // name was found in directory
 
-    return file_table[freeSlot]; // return NULL if not found
-}
-
-int FileSystem::GetAllocatedSlot()
-{
-    for (int i = 2; i < 15; i++)
-    {
-        if (file_table[i] == NULL)
-            return i;
-    }
-    return -1;
+    return openFile; // return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
-//	    Write changes to directory, bitmap back to disk
+//	    Note that the directory and bitmap have to be written back
+//	If the file is open, its space is only deleted when it is last
+//	closed (as in UNIX); until then, it can still be read and written.
+//	A directory can only be removed once it is empty; it is dropped
+//	from memory, and the name cache forgets the names in it.
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system (or is a directory with files in it).
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool FileSystem::Remove(char *name)
 {
-    Directory *directory;
-    BitMap *freeMap;
-    FileHeader *fileHdr;
-    int sector;
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    char leaf[FileNameMaxLen + 1];
+    OpenDirectory *dir, *sub, **prev;
+    Inode *inode;
+    int sector = -1;
+    bool isDir;
+
+    Acquire();
+    dir = Resolve(name, leaf);
+    if (dir != NULL)
+        sector = Lookup(dir, leaf, &isDir);
     if (sector == -1)
     {
-        delete directory;
+        Release();
         return FALSE; // file not found
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
+    if (isDir)
+    {
+        sub = GetDirectory(sector);
+        if (!sub->directory->IsEmpty())
+        {
+            Release();
+            return FALSE; // directory not empty
+        }
+        for (prev = &dirs; *prev != sub; prev = &(*prev)->next)
+            ;
+        *prev = sub->next;
+        delete sub->file;
+        delete sub->directory;
+        delete sub;
+        names->Purge(sector);
+    }
+    dir->directory->Remove(leaf);
+    names->Enter(dir->sector, leaf, -1, FALSE);
+    dir->dirty = TRUE; // written back at the next Sync
+
+    inode = OpenInode(sector);
+    inode->removed = TRUE;
+    CloseInode(inode); // frees the file, unless someone has it open
+    Release();
+    return TRUE;
+}
 
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
+//----------------------------------------------------------------------
+// FileSystem::Commit
+// 	Write the directories, the headers of open files, and the bitmap
+//	into the buffer cache, if they have changed since they were last
+//	written, and commit them to the journal, with the file headers
+//	and index blocks written since the last commit, as one
+//	transaction.  Every operation done since then is in it, whichever
+//	thread did it (group commit).  Must hold the lock, between
+//	operations, so that the transaction leaves the file system
+//	consistent.
+//
+//	The directories go first: writing one back can make its file
+//	grow, which changes its header and the bitmap.
+//----------------------------------------------------------------------
 
-    fileHdr->Deallocate(freeMap); // remove data blocks
-    freeMap->Clear(sector);       // remove header block
-    directory->Remove(name);
+void FileSystem::Commit()
+{
+    OpenDirectory *dir;
 
-    freeMap->WriteBack(freeMapFile);     // flush to disk
-    directory->WriteBack(directoryFile); // flush to disk
-    delete fileHdr;
-    delete directory;
-    delete freeMap;
-    return TRUE;
+    for (dir = dirs; dir != NULL; dir = dir->next)
+        if (dir->dirty)
+        {
+            dir->directory->WriteBack(dir->file);
+            dir->dirty = FALSE;
+        }
+    WriteInodes();
+    if (freeMapDirty)
+        freeMap->WriteBack(freeMapFile);
+    freeMapDirty = FALSE;
+    bufferCache->Commit();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Commit the metadata changed since the last commit, and then
+//	write every dirty sector in the buffer cache back to disk.  Until
+//	this is called, files created or removed since the last commit
+//	are not on the disk.
+//----------------------------------------------------------------------
+
+void FileSystem::Sync()
+{
+    Acquire();
+    Commit();
+    Release();
+    bufferCache->Sync();
 }
 
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, starting at the root;
+//	the files in each directory are listed, indented, under it.
 //----------------------------------------------------------------------
 
 void FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
+    Acquire();
+    List(dirs, 0);
+    Release();
+}
 
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+void FileSystem::List(OpenDirectory *dir, int depth)
+{
+    DirectoryEntry *entry;
+
+    for (int i = 0; (entry = dir->directory->Entry(i)) != NULL; i++)
+    {
+        if (!entry->inUse)
+            continue;
+        printf("%*s%s%s\n", 2 * depth, "", entry->name,
+               entry->isDir ? "/" : "");
+        if (entry->isDir)
+            List(GetDirectory(entry->sector), depth + 1);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::PrintFragmentation
+// 	Print how fragmented the disk is: how many runs the free sectors
+//	are in, and the longest, and then how many extents each file in
+//	the root directory is in.
+//----------------------------------------------------------------------
+
+void FileSystem::PrintFragmentation()
+{
+    int runs, longest;
+
+    Acquire();
+    WriteInodes(); // the headers PrintExtents reads
+    runs = freeMap->NumClearRuns(&longest);
+    printf("Free space: %d sectors in %d runs, longest %d\n",
+           freeMap->NumClear(), runs, longest);
+    dirs->directory->PrintExtents();
+    Release();
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Print
 // 	Print everything about the file system:
 //	  the contents of the bitmap
-//	  the contents of the directory
-//	  for each file in the directory,
+//	  the contents of the root directory
+//	  for each file in the root directory,
 //	      the contents of the file header
 //	      the data in the file
 //----------------------------------------------------------------------
@@ -362,9 +800,9 @@ void FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
+    Acquire();
+    WriteInodes();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -373,14 +811,10 @@ void FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
-
-    directory->FetchFrom(directoryFile);
-    directory->Print();
+    dirs->directory->Print();
+    Release();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
 }
@@ -20,10 +20,10 @@
 //	file system (in a file named "DISK").
 //
 //	In the "real" implementation, there are two key data structures used
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.
-//	In addition, there is a bitmap for allocating
+//	in the file system.  There is a "root" directory, listing the
+//	files at the top of the file system; as in UNIX, an entry may
+//	name another directory, and files are named by '/'-separated
+//	paths through them.  In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
 //	bootstrap problem when the simulated disk is initialized.
@@ -38,8 +38,6 @@
 #include "copyright.h"
 #include "openfile.h"
 
-#define MAX_FILE 15
-
 typedef int OpenFileID;
 #ifdef FILESYS_STUB // Temporarily implement file system calls as
 // calls to UNIX, until the real file system
@@ -48,35 +46,9 @@ typedef int OpenFileID;
 class FileSystem
 {
 public:
-	OpenFile **file_table; // A table to store all the file
-	int index;			   // Index of the file table
-
 	/// @brief Default constructor
 	/// @param format Format the file system
-	FileSystem(bool format)
-	{
-		file_table = new OpenFile *[MAX_FILE];
-		index = 0;
-		for (int i = 0; i < MAX_FILE; ++i)
-		{
-			file_table[i] = NULL;
-		}
-		this->Create("stdin", 0);							// Create stdin with initial size 0
-		this->Create("stdout", 0);							// Create stdout with initial size 0
-		file_table[index++] = this->Open("stdin", STDIN);	// Open stdin with type STDIN at slot 0
-		file_table[index++] = this->Open("stdout", STDOUT); // Open stdout with type STDOUT at slot 1
-	}
-
-	/// @brief Destructor
-	~FileSystem()
-	{
-		for (int i = 0; i < MAX_FILE; ++i)
-		{
-			if (file_table[i] != NULL)
-				delete file_table[i];
-		}
-		delete[] file_table;
-	}
+	FileSystem(bool format) {}
 
 	/// @brief Create a new file with the given name and initial size
 	/// @param name Name of the file in ./code directory
@@ -120,18 +92,6 @@ public:
 		return new OpenFile(fileDescriptor, type);
 	}
 
-	/// @brief Get the allocated slot in the file table
-	/// @return Allocated slot in the file table
-	int GetAllocatedSlot()
-	{
-		for (int i = 2; i < 15; i++)
-		{
-			if (file_table[i] == NULL)
-				return i;
-		}
-		return -1;
-	}
-
 	/// @brief Delete a file (UNIX unlink)
 	bool Remove(char *name)
 	{
@@ -140,12 +100,51 @@ public:
 };
 
 #else // FILESYS
-class FileSystem
+class Semaphore;
+class Thread;
+class BitMap;
+class Directory;
+class NameCache;
+class Journal;
+
+#define InodeBuckets 31 // hash chains in the table of open files
+
+// The in-memory copy of the header of an open file (its "inode"),
+// shared by every OpenFile for that file.  So opening a file that is
+// already open doesn't read its header again, and a file grown through
+// one OpenFile is seen to have grown through the others.  Changes to
+// the header are written back when the last OpenFile for it is closed,
+// or at Sync.
+
+class Inode
+{
+public:
+	int sector;		   // Where the header is on disk
+	FileHeader *hdr;   // The header itself
+	int refCount;	   // How many OpenFiles share it
+	bool dirty;		   // Changed since it was last written back?
+	bool removed;	   // Removed while open?  Then its sectors are
+					   // freed once the last OpenFile is closed
+	Inode *next;	   // Next inode in the same hash chain
+};
+
+// A directory the file system has read into memory, with the file it
+// lives in.  The root directory is always there; the others are read
+// in when a path goes through them, and stay.
+
+class OpenDirectory
 {
 public:
-	OpenFile **file_table; // A table to store all the file
-	int index;			   // Index of the file table
+	int sector;			  // Where the directory's header is
+	OpenFile *file;		  // The file holding its entries
+	Directory *directory; // The entries themselves
+	bool dirty;			  // Changed since they were last written back?
+	OpenDirectory *next;  // Next directory in memory
+};
 
+class FileSystem
+{
+public:
 	FileSystem(bool format); // Initialize the file system.
 							 // Must be called *after* "synchDisk"
 							 // has been initialized.
@@ -153,9 +152,31 @@ public:
 							 // the disk, so initialize the directory
 							 // and the bitmap of free blocks.
 
-	/// @brief Create a new file with the given name and initial size
+	/// @brief Create a new file with the given path and initial size
 	bool Create(char *name, int initialSize);
 
+	/// @brief Create a new, empty directory
+	/// @param name Path of the directory, whose parent must exist
+	/// @return True if the directory is created, otherwise false
+	bool MakeDirectory(char *name);
+
+	/// @brief Make an open file longer, allocating sectors if need be
+	/// @param inode Inode of the file
+	/// @param newSize New length of the file, in bytes
+	/// @return True if the file was extended, false if the disk is full
+	bool Extend(Inode *inode, int newSize);
+
+	/// @brief Get the inode of the file whose header is at a sector,
+	/// reading the header in if the file isn't open yet
+	/// @param sector Sector holding the header on disk
+	/// @return The inode, with one more reference
+	Inode *OpenInode(int sector);
+
+	/// @brief Drop a reference to an inode; the last one writes the
+	/// header back (or frees the file, if it was removed)
+	/// @param inode The inode
+	void CloseInode(Inode *inode);
+
 	/// @brief Open the file with the given name
 	/// @param name Name of the file in ./code directory
 	/// @return OpenFile pointer of the opened file
@@ -167,26 +188,64 @@ public:
 	/// @return OpenFile pointer of the opened file
 	OpenFile *Open(char *name, int type);
 
-	/// @brief Get the allocated slot in the file table
-	/// @return Allocated slot in the file table
-	int GetAllocatedSlot();
-
-	/// @brief Delete a file (UNIX unlink)
-	/// @param name Name of the file in ./code directory
+	/// @brief Delete a file, or an empty directory (UNIX unlink); an
+	/// open file goes on until it is closed
+	/// @param name Path of the file
 	/// @return True if the file is deleted successfully, otherwise false
 	bool Remove(char *name); // Delete a file (UNIX unlink)
 
-	/// @brief List all the files in the file system
+	/// @brief List all the files in the file system, directory by directory
 	void List(); // List all the files in the file system
 
 	/// @brief Print all the files and their contents
 	void Print(); // List all the files and their contents
 
+	/// @brief Print how fragmented the free space and each file are
+	void PrintFragmentation();
+
+	/// @brief Commit the directories, headers of open files and bitmap,
+	/// if changed, to the journal, and then write the buffer cache back
+	/// to disk
+	void Sync();
+
 private:
-	OpenFile *freeMapFile;	 // Bit map of free disk blocks,
-							 // represented as a file
-	OpenFile *directoryFile; // "Root" directory -- list of
-							 // file names, represented as a file
+	OpenFile *freeMapFile; // Bit map of free disk blocks,
+						   // represented as a file
+	BitMap *freeMap;	   // The bitmap, kept in memory while
+						   // Nachos is running
+	bool freeMapDirty;	   // Changed since it was last written back?
+	OpenDirectory *dirs;   // Directories in memory, the root first
+	NameCache *names;	   // Recent lookups of names in directories
+	Inode **inodes;		   // Open files, hashed by header sector
+	Journal *journal;	   // Where metadata changes are committed
+	Semaphore *lock;	   // Guards the bitmap and directories;
+						   // Create, Remove and Extend one
+						   // at a time
+	Thread *lockHolder;	   // Who holds "lock", and how many times
+	int lockDepth;		   // (a write back can extend a file)
+
+	void Acquire(); // Take the lock (again)
+	void Release(); // Let go of it, once per Acquire
+
+	bool Make(char *name, int initialSize, bool isDir);
+	// Create a file or a directory
+	OpenDirectory *GetDirectory(int sector);
+	// The directory whose header is at "sector", read in if need be
+	OpenDirectory *Resolve(char *name, char *leaf);
+	// The directory holding the last component of path "name",
+	// which is copied into "leaf"; NULL if there is no such directory
+	int Lookup(OpenDirectory *dir, char *leaf, bool *isDir);
+	// Header sector of "leaf" in "dir", through the name cache
+	int FindFile(char *name);
+	// Header sector of the file at path "name", or -1
+	void List(OpenDirectory *dir, int depth);
+	// List "dir" and the directories below it
+	void FreeFile(Inode *inode);
+	// Give back the sectors of a removed file
+	void WriteInodes();
+	// Write back the headers of open files that have changed
+	void Commit();
+	// Commit every metadata change so far to the journal
 };
 
 #endif // FILESYS
@@ -7,6 +7,10 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   ReadAheadTest -- time sequential reads with and without
+//		read-ahead
+//	   DiskSchedulingTest -- time several threads reading files
+//		far apart on disk at once
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +24,8 @@
 #include "thread.h"
 #include "disk.h"
 #include "stats.h"
+#include "filehdr.h"
+#include "directory.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -183,3 +189,493 @@ PerformanceTest()
     stats->Print();
 }
 
+
+//----------------------------------------------------------------------
+// ReadAheadTest
+// 	Compare how long (in simulated ticks) it takes to read a file
+//	sequentially, a byte at a time and a sector at a time, with
+//	read-ahead turned off and then on.  The cache is emptied before
+//	each pass, so that every sector has to come from the disk.
+//
+//	Implemented as two routines:
+//	  TimedRead -- read the file once, and return the ticks taken
+//	  ReadAheadTest -- create the file, and time each kind of read
+//----------------------------------------------------------------------
+
+#define AheadFileName	"AheadFile"
+#define AheadFileSize	(128 * SectorSize)
+
+static int
+TimedRead(OpenFile *openFile, int chunkSize)
+{
+    char *buffer = new char[chunkSize];
+    int start, i;
+
+    bufferCache->Invalidate();
+    start = stats->totalTicks;
+    openFile->Seek(0);
+    for (i = 0; i < AheadFileSize; i += chunkSize)
+	if (openFile->Read(buffer, chunkSize) != chunkSize) {
+	    printf("Read-ahead test: unable to read %s\n", AheadFileName);
+	    break;
+	}
+    delete [] buffer;
+    return stats->totalTicks - start;
+}
+
+void
+ReadAheadTest()
+{
+    OpenFile *openFile;
+    char *contents = new char[AheadFileSize];
+    int chunks[2] = { 1, SectorSize };
+    int limit = bufferCache->ReadAheadLimit();
+    int i, j, ahead, reads, ticks;
+
+    if (!fileSystem->Create(AheadFileName, AheadFileSize)) {
+	printf("Read-ahead test: can't create %s\n", AheadFileName);
+	delete [] contents;
+	return;
+    }
+    openFile = fileSystem->Open(AheadFileName);
+    for (i = 0; i < AheadFileSize; i++)
+	contents[i] = 'a' + i % 26;
+    openFile->Write(contents, AheadFileSize);
+
+    printf("Sequential read of %d byte file, %d sectors read ahead:\n",
+	AheadFileSize, limit);
+    for (i = 0; i < 2; i++)
+	for (j = 0; j < 2; j++) {
+	    ahead = (j == 0) ? 0 : limit;
+	    bufferCache->SetReadAheadLimit(ahead);
+	    reads = stats->numDiskReads;
+	    ticks = TimedRead(openFile, chunks[i]);
+	    printf("  %3d byte reads, read-ahead %s: %8d ticks, "
+		"%d disk reads\n", chunks[i], (ahead > 0) ? "on " : "off",
+		ticks, stats->numDiskReads - reads);
+	}
+    bufferCache->SetReadAheadLimit(limit);
+
+    delete openFile;
+    delete [] contents;
+    if (!fileSystem->Remove(AheadFileName))
+	printf("Read-ahead test: unable to remove %s\n", AheadFileName);
+}
+
+//----------------------------------------------------------------------
+// DiskSchedulingTest
+// 	Have several threads read, at the same time, files that lie far
+//	apart on the disk (with padding files in between), so that the
+//	disk has several requests waiting at once and the scheduling
+//	policy (-ds) decides how far the head travels.  Each thread reads
+//	its file a sector at a time, in a scrambled order, so that read-
+//	ahead doesn't kick in.  The cache is emptied first, so that every
+//	read goes to the disk.
+//
+//	Implemented as two routines:
+//	  ScatterReader -- one of the threads reading
+//	  DiskSchedulingTest -- overall control, and print out the results
+//----------------------------------------------------------------------
+
+#define NumScatterFiles	4
+#define ScatterSectors	(2 * SectorsPerTrack)	// size of each file
+#define PadSectors	(3 * SectorsPerTrack)	// and the space between
+#define ScatterStride	7			// coprime to ScatterSectors
+
+static Semaphore *readersDone;
+
+static void
+ScatterReader(int which)
+{
+    char name[16], buffer[SectorSize];
+    OpenFile *openFile;
+    int i;
+
+    sprintf(name, "Scatter%d", which);
+    if ((openFile = fileSystem->Open(name)) == NULL)
+	printf("Disk scheduling test: unable to open %s\n", name);
+    else {
+	for (i = 0; i < ScatterSectors; i++)
+	    openFile->ReadAt(buffer, SectorSize,
+			     (i * ScatterStride % ScatterSectors) * SectorSize);
+	delete openFile;
+    }
+    readersDone->V();
+}
+
+void
+DiskSchedulingTest()
+{
+    char name[16];
+    int i, start, requests, tracks, waited;
+
+    for (i = 0; i < NumScatterFiles; i++) {
+	sprintf(name, "Scatter%d", i);
+	if (!fileSystem->Create(name, ScatterSectors * SectorSize))
+	    printf("Disk scheduling test: can't create %s\n", name);
+	sprintf(name, "Pad%d", i);
+	if (i < NumScatterFiles - 1 &&
+	    !fileSystem->Create(name, PadSectors * SectorSize))
+	    printf("Disk scheduling test: can't create %s\n", name);
+    }
+
+    bufferCache->Invalidate();
+    readersDone = new Semaphore("readers done", 0);
+    start = stats->totalTicks;
+    requests = stats->numDiskRequests;
+    tracks = stats->diskSeekTracks;
+    waited = stats->diskWaitTicks;
+    for (i = 0; i < NumScatterFiles; i++) {
+	Thread *t = new Thread("scatter reader");
+	t->Fork(ScatterReader, i);
+    }
+    for (i = 0; i < NumScatterFiles; i++)
+	readersDone->P();
+    requests = max(stats->numDiskRequests - requests, 1);
+    printf("%d threads reading %d sectors each, %s disk scheduling:\n",
+	NumScatterFiles, ScatterSectors, stats->diskPolicy);
+    printf("  %d ticks, %d requests, average seek %.2f tracks, "
+	"average latency %.1f ticks\n", stats->totalTicks - start, requests,
+	(double) (stats->diskSeekTracks - tracks) / requests,
+	(double) (stats->diskWaitTicks - waited) / requests);
+    delete readersDone;
+
+    for (i = 0; i < NumScatterFiles; i++) {
+	sprintf(name, "Scatter%d", i);
+	fileSystem->Remove(name);
+	sprintf(name, "Pad%d", i);
+	if (i < NumScatterFiles - 1)
+	    fileSystem->Remove(name);
+    }
+}
+
+//----------------------------------------------------------------------
+// LargeFileTest
+// 	Write a file much bigger than a file header can map by itself,
+//	starting from an empty file and growing it a chunk at a time,
+//	then read it back (from the disk, not the cache) and check it.
+//	Print the time each takes, and the throughput, in bytes per
+//	thousand ticks.
+//----------------------------------------------------------------------
+
+#define LargeFileName	"LargeFile"
+#define LargeFileSize	(512 * SectorSize)
+#define LargeChunkSize	(8 * SectorSize)
+
+void
+LargeFileTest()
+{
+    OpenFile *openFile;
+    char *buffer = new char[LargeChunkSize];
+    int i, j, start, writeTicks, readTicks;
+
+    if (!fileSystem->Create(LargeFileName, 0)
+	|| (openFile = fileSystem->Open(LargeFileName)) == NULL) {
+	printf("Large file test: can't create %s\n", LargeFileName);
+	delete [] buffer;
+	return;
+    }
+
+    start = stats->totalTicks;
+    for (i = 0; i < LargeFileSize; i += LargeChunkSize) {
+	for (j = 0; j < LargeChunkSize; j++)
+	    buffer[j] = 'a' + (i + j) % 26;
+	if (openFile->Write(buffer, LargeChunkSize) != LargeChunkSize) {
+	    printf("Large file test: unable to write %s\n", LargeFileName);
+	    break;
+	}
+    }
+    bufferCache->Sync();
+    writeTicks = max(stats->totalTicks - start, 1);
+
+    bufferCache->Invalidate();
+    start = stats->totalTicks;
+    openFile->Seek(0);
+    for (i = 0; i < openFile->Length(); i += LargeChunkSize) {
+	if (openFile->Read(buffer, LargeChunkSize) != LargeChunkSize) {
+	    printf("Large file test: unable to read %s\n", LargeFileName);
+	    break;
+	}
+	for (j = 0; j < LargeChunkSize; j++)
+	    if (buffer[j] != 'a' + (i + j) % 26) {
+		printf("Large file test: bad data at byte %d\n", i + j);
+		i = LargeFileSize;
+		break;
+	    }
+    }
+    readTicks = max(stats->totalTicks - start, 1);
+
+    printf("Sequential write/read of %d byte file (%d byte maximum), "
+	"in %d byte chunks:\n", openFile->Length(), MaxFileSize,
+	LargeChunkSize);
+    printf("  write: %8d ticks, %6.1f bytes per 1000 ticks\n", writeTicks,
+	1000.0 * LargeFileSize / writeTicks);
+    printf("  read:  %8d ticks, %6.1f bytes per 1000 ticks\n", readTicks,
+	1000.0 * LargeFileSize / readTicks);
+
+    delete openFile;
+    delete [] buffer;
+    if (!fileSystem->Remove(LargeFileName))
+	printf("Large file test: unable to remove %s\n", LargeFileName);
+}
+
+//----------------------------------------------------------------------
+// AllocationTest
+// 	Grow two files side by side, a little at a time, as two programs
+//	writing logs would; then read one back sequentially (from the
+//	disk, not the cache).  Do it with sectors allocated one at a
+//	time (-fa sector) and then in extents (-fa extent), and print
+//	how fragmented the files end up, and how long the read takes
+//	and how far the disk head moves.
+//----------------------------------------------------------------------
+
+#define GrowFileSize	(192 * SectorSize)
+#define GrowChunkSize	(2 * SectorSize)
+
+void
+AllocationTest()
+{
+    char *names[2] = { "GrowA", "GrowB" };
+    bool saved = extentAllocation;
+    char buffer[GrowChunkSize];
+    OpenFile *files[2];
+    int pass, i, j, start, tracks;
+
+    for (i = 0; i < GrowChunkSize; i++)
+	buffer[i] = 'a' + i % 26;
+    for (pass = 0; pass < 2; pass++) {
+	extentAllocation = (pass == 1);
+	for (j = 0; j < 2; j++)
+	    if (!fileSystem->Create(names[j], 0)
+		|| (files[j] = fileSystem->Open(names[j])) == NULL) {
+		printf("Allocation test: can't create %s\n", names[j]);
+		extentAllocation = saved;
+		return;
+	    }
+	for (i = 0; i < GrowFileSize; i += GrowChunkSize)
+	    for (j = 0; j < 2; j++)
+		if (files[j]->Write(buffer, GrowChunkSize) != GrowChunkSize)
+		    printf("Allocation test: unable to write %s\n", names[j]);
+
+	printf("%s allocation, two %d byte files grown %d bytes at a "
+	    "time:\n", extentAllocation ? "Extent" : "Sector", GrowFileSize,
+	    GrowChunkSize);
+	fileSystem->PrintFragmentation();
+
+	bufferCache->Invalidate();
+	start = stats->totalTicks;
+	tracks = stats->diskSeekTracks;
+	files[0]->Seek(0);
+	for (i = 0; i < GrowFileSize; i += GrowChunkSize)
+	    if (files[0]->Read(buffer, GrowChunkSize) != GrowChunkSize)
+		printf("Allocation test: unable to read %s\n", names[0]);
+	printf("  sequential read of %s: %8d ticks, %d tracks seeked\n",
+	    names[0], stats->totalTicks - start,
+	    stats->diskSeekTracks - tracks);
+
+	for (j = 0; j < 2; j++) {
+	    delete files[j];
+	    fileSystem->Remove(names[j]);
+	}
+    }
+    extentAllocation = saved;
+}
+
+//----------------------------------------------------------------------
+// MetadataTest
+// 	Time a metadata-heavy loop, like the one test/passenger.c runs:
+//	create a small file, open it, write a line, close it, and remove
+//	it, over and over.  Print the ticks and disk requests per round.
+//
+//	Then time opening a file that is already open, which shares the
+//	header in memory, and check that what is written through one
+//	open is seen through the other.
+//
+//	Last, create and remove many files, with the metadata journal
+//	and without it, and compare the disk writes and how far the head
+//	moved for them.
+//----------------------------------------------------------------------
+
+#define MetadataRounds	200
+#define MetadataFiles	64
+
+static void
+MetadataBatch(bool journaled)
+{
+    Journal *journal = bufferCache->GetJournal();
+    char name[16];
+    OpenFile *openFile;
+    int i, writes, tracks, commits;
+
+    fileSystem->Sync();		// nothing left to commit
+    if (!journaled)
+	bufferCache->SetJournal(NULL);
+    writes = stats->numDiskWrites;
+    tracks = stats->diskSeekTracks;
+    commits = stats->numJournalCommits;
+    for (i = 0; i < MetadataFiles; i++) {
+	sprintf(name, "Meta%d", i);
+	if (!fileSystem->Create(name, 0)
+	    || (openFile = fileSystem->Open(name)) == NULL)
+	    break;
+	openFile->Write(Contents, ContentSize);
+	delete openFile;
+    }
+    while (--i >= 0) {
+	sprintf(name, "Meta%d", i);
+	fileSystem->Remove(name);
+    }
+    fileSystem->Sync();
+    writes = stats->numDiskWrites - writes;
+    printf("%d files created and removed, %s journal: %d disk writes, "
+	"%.2f tracks seeked per write, %d commits\n", MetadataFiles,
+	journaled ? "with" : "without", writes,
+	(double) (stats->diskSeekTracks - tracks) / max(writes, 1),
+	stats->numJournalCommits - commits);
+    bufferCache->SetJournal(journal);
+}
+
+void
+MetadataTest()
+{
+    OpenFile *openFile, *other;
+    int i, start, reads, writes;
+    double hostStart;
+
+    fileSystem->Sync();
+    start = stats->totalTicks;
+    reads = stats->numDiskReads;
+    writes = stats->numDiskWrites;
+    for (i = 0; i < MetadataRounds; i++) {
+	if (!fileSystem->Create("Meta", 0)
+	    || (openFile = fileSystem->Open("Meta")) == NULL) {
+	    printf("Metadata test: can't create Meta\n");
+	    return;
+	}
+	openFile->Write(Contents, ContentSize);
+	delete openFile;
+	fileSystem->Remove("Meta");
+    }
+    fileSystem->Sync();
+    printf("Create/open/write/close/remove, %d rounds: %.1f ticks, "
+	"%.2f disk reads, %.2f disk writes per round\n", MetadataRounds,
+	(double) (stats->totalTicks - start) / MetadataRounds,
+	(double) (stats->numDiskReads - reads) / MetadataRounds,
+	(double) (stats->numDiskWrites - writes) / MetadataRounds);
+
+    if (!fileSystem->Create("Meta", 0)
+	|| (openFile = fileSystem->Open("Meta")) == NULL) {
+	printf("Metadata test: can't create Meta\n");
+	return;
+    }
+    hostStart = HostTime();
+    reads = stats->numDiskReads;
+    for (i = 0; i < MetadataRounds; i++) {
+	other = fileSystem->Open("Meta");
+	delete other;
+    }
+    printf("Open/close of an open file, %d rounds: %.2f us, "
+	"%.2f disk reads per round\n", MetadataRounds,
+	(HostTime() - hostStart) * 1e6 / MetadataRounds,
+	(double) (stats->numDiskReads - reads) / MetadataRounds);
+
+    other = fileSystem->Open("Meta");
+    openFile->Write(Contents, ContentSize);
+    if (other->Length() != (int) ContentSize)
+	printf("Metadata test: second open sees length %d, not %d\n",
+	    other->Length(), (int) ContentSize);
+    fileSystem->Remove("Meta");		// freed once both are closed
+    if (other->Write(Contents, ContentSize) != (int) ContentSize)
+	printf("Metadata test: can't write Meta once removed\n");
+    delete other;
+    delete openFile;
+
+    MetadataBatch(TRUE);
+    MetadataBatch(FALSE);
+}
+
+//----------------------------------------------------------------------
+// DirectoryTest
+// 	Create, look up and remove many files in one directory, and
+//	print the host time per operation of each phase, with how the
+//	name cache did.  Names are looked up twice: the second time,
+//	the cache knows those it still holds.  Files are created until
+//	there are DirTestFiles of them, or the disk is full.
+//----------------------------------------------------------------------
+
+#define DirTestName	"DirTest"
+#define DirTestFiles	10000
+
+static void
+DirectoryPhase(const char *what, int numFiles, double start, int hits,
+	       int misses)
+{
+    printf("  %-16s %6d ops, %8.2f us/op, name cache hits %d, misses %d\n",
+	what, numFiles, (HostTime() - start) * 1e6 / numFiles,
+	stats->numNameHits - hits, stats->numNameMisses - misses);
+}
+
+void
+DirectoryTest()
+{
+    char name[FileNameMaxLen + 16];
+    OpenFile *openFile;
+    int i, numFiles, hits, misses;
+    double start;
+
+    if (!fileSystem->MakeDirectory(DirTestName)) {
+	printf("Directory test: can't make %s\n", DirTestName);
+	return;
+    }
+    printf("Directory test, files in /%s:\n", DirTestName);
+
+#define PHASE_START	start = HostTime(); hits = stats->numNameHits; \
+			misses = stats->numNameMisses
+
+    PHASE_START;
+    for (numFiles = 0; numFiles < DirTestFiles; numFiles++) {
+	sprintf(name, "%s/File%d", DirTestName, numFiles);
+	if (!fileSystem->Create(name, 0))
+	    break;			// the disk is full
+    }
+    if (numFiles == 0) {
+	printf("Directory test: can't create any files\n");
+	fileSystem->Remove(DirTestName);
+	return;
+    }
+    DirectoryPhase("create", numFiles, start, hits, misses);
+
+    for (int pass = 0; pass < 2; pass++) {
+	PHASE_START;
+	for (i = 0; i < numFiles; i++) {
+	    sprintf(name, "%s/File%d", DirTestName, i);
+	    if ((openFile = fileSystem->Open(name)) == NULL)
+		printf("Directory test: can't find %s\n", name);
+	    delete openFile;
+	}
+	DirectoryPhase(pass == 0 ? "lookup" : "lookup again", numFiles,
+	    start, hits, misses);
+    }
+
+    PHASE_START;
+    for (i = 0; i < numFiles; i++) {
+	sprintf(name, "%s/Missing%d", DirTestName, i);
+	if (fileSystem->Open(name) != NULL)
+	    printf("Directory test: found %s\n", name);
+    }
+    DirectoryPhase("failed lookup", numFiles, start, hits, misses);
+
+    PHASE_START;
+    for (i = 0; i < numFiles; i++) {
+	sprintf(name, "%s/File%d", DirTestName, i);
+	if (!fileSystem->Remove(name))
+	    printf("Directory test: can't remove %s\n", name);
+    }
+    DirectoryPhase("remove", numFiles, start, hits, misses);
+
+#undef PHASE_START
+
+    if (!fileSystem->Remove(DirTestName))
+	printf("Directory test: can't remove %s\n", DirTestName);
+    fileSystem->Sync();
+}
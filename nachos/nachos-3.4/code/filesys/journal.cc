@@ -0,0 +1,153 @@
+// journal.cc
+//	Routines to write transactions of metadata changes into the
+//	journal, and to replay the last one after Nachos stops.
+//
+//	A transaction's sectors are written one after another into the
+//	half of the journal the last transaction isn't in, so the head
+//	hardly moves; then the header, which commits it.  Only the last
+//	committed transaction is ever replayed: before it is committed,
+//	the buffer cache writes every sector of the one before that it
+//	doesn't change again to its own place (cf. BufferCache::Commit).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "system.h"
+#ifdef HOST_SPARC
+#include <strings.h>
+#endif
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal, in memory.  Call Format for a new disk,
+//	or Recover for one that has a journal already, before using it.
+//
+//	"logDisk" -- the disk the journal is on
+//	"start" -- the first of its JournalSectors sectors
+//----------------------------------------------------------------------
+
+Journal::Journal(SynchDisk *logDisk, int start)
+{
+    ASSERT(sizeof(JournalHeader) <= SectorSize);
+    disk = logDisk;
+    firstSector = start;
+    sequence = 0;
+    half = 1;			// so the first transaction goes in half 0
+    header = new JournalHeader;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Write empty headers into both halves of the journal.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    char buf[SectorSize];
+
+    bzero(buf, SectorSize);
+    header->magic = JournalMagic;
+    header->sequence = 0;
+    header->numSectors = 0;
+    bcopy((char *) header, buf, sizeof(JournalHeader));
+    for (int h = 0; h < 2; h++)
+	disk->WriteSector(HeaderSector(h), buf);
+    sequence = 0;
+    half = 1;
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Find the last committed transaction -- the half whose header has
+//	the higher sequence number -- and copy each of its sectors to its
+//	own place on disk.  The changes may be there already; copying
+//	them again does no harm.  New transactions carry on numbering
+//	from it, in the other half.
+//----------------------------------------------------------------------
+
+void
+Journal::Recover()
+{
+    char buf[SectorSize];
+    JournalHeader *h[2];
+    int last = -1;
+
+    for (int i = 0; i < 2; i++) {
+	h[i] = new JournalHeader;
+	disk->ReadSector(HeaderSector(i), buf);
+	bcopy(buf, (char *) h[i], sizeof(JournalHeader));
+	if (h[i]->magic == JournalMagic && h[i]->sequence > 0
+	    && (last == -1 || h[i]->sequence > h[last]->sequence))
+	    last = i;
+    }
+    if (last != -1) {
+	DEBUG('f', "Journal: replaying transaction %d, %d sectors\n",
+	      h[last]->sequence, h[last]->numSectors);
+	for (int i = 0; i < h[last]->numSectors; i++) {
+	    disk->ReadSector(HeaderSector(last) + 1 + i, buf);
+	    disk->WriteSector(h[last]->sectors[i], buf);
+	}
+	sequence = h[last]->sequence;
+	half = last;
+    }
+    delete h[0];
+    delete h[1];
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a new transaction, in the half the last one isn't in.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    header->magic = JournalMagic;
+    header->sequence = sequence + 1;
+    header->numSectors = 0;
+}
+
+//----------------------------------------------------------------------
+// Journal::Add
+// 	Write the new contents of a sector into the transaction.
+//
+//	"sector" -- where the contents belong, on disk
+//	"data" -- the contents
+//----------------------------------------------------------------------
+
+void
+Journal::Add(int sector, char *data)
+{
+    int n = header->numSectors;
+
+    ASSERT(n < JournalBlocks);
+    header->sectors[n] = sector;
+    disk->WriteSector(HeaderSector(1 - half) + 1 + n, data);
+    header->numSectors = n + 1;
+    stats->numJournalSectors++;
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Commit the transaction, by writing its header.  From here on,
+//	Recover would replay it rather than the one before.
+//----------------------------------------------------------------------
+
+void
+Journal::End()
+{
+    char buf[SectorSize];
+
+    bzero(buf, SectorSize);
+    bcopy((char *) header, buf, sizeof(JournalHeader));
+    half = 1 - half;
+    sequence = header->sequence;
+    disk->WriteSector(HeaderSector(half), buf);
+    stats->numJournalCommits++;
+    DEBUG('f', "Journal: committed transaction %d, %d sectors\n",
+	  sequence, header->numSectors);
+}
@@ -0,0 +1,75 @@
+// journal.h
+//	Data structures for the metadata journal: a fixed area of the
+//	disk where changes to file system metadata (file headers, index
+//	blocks, directories and the free map) are written, all together
+//	and in order, before any of them is written to its own place on
+//	disk.  If Nachos stops part way, the file system still finds
+//	its metadata as it was at the end of some transaction: the
+//	changes of the last one committed are copied to their places
+//	when the disk is next mounted (cf. Recover).
+//
+//	The area is two halves, used in turn; each is a header sector,
+//	naming the sectors of one transaction, followed by their new
+//	contents.  The header is written last, so a transaction is only
+//	committed once all of it is in the journal.  The half not being
+//	written still holds the transaction before, in case this one
+//	never gets there.
+//
+//	The buffer cache decides what goes into a transaction, and when
+//	(cf. BufferCache::Commit); the journal only knows how to write
+//	one down, and how to find the last one again.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synchdisk.h"
+
+#define JournalBlocks	32		// most sectors in one transaction
+#define JournalHalf	(1 + JournalBlocks)	// header, then the blocks
+#define JournalSectors	(2 * JournalHalf)	// size of the journal area
+#define JournalMagic	0x4a524e4c	// marks a journal header
+
+// The header of one half of the journal.  It fits in a sector.
+
+class JournalHeader {
+  public:
+    int magic;			// JournalMagic, if the half was ever used
+    int sequence;		// number of the transaction (0: none)
+    int numSectors;		// how many sectors it changed
+    int sectors[JournalBlocks];	// which; their contents follow, in order
+};
+
+class Journal {
+  public:
+    Journal(SynchDisk *logDisk, int start);
+				// The journal occupies JournalSectors
+				// sectors of "logDisk", from "start"
+
+    void Format();		// Start an empty journal
+    void Recover();		// Copy the changes of the last committed
+				// transaction to their places on disk
+
+    void Begin();		// Start writing a transaction
+    void Add(int sector, char *data);
+				// Add the new contents of "sector"; at
+				// most JournalBlocks per transaction
+    void End();			// Commit it, by writing its header
+
+  private:
+    SynchDisk *disk;		// where the journal is
+    int firstSector;		// where on it
+    int sequence;		// number of the last transaction
+    int half;			// half holding it (0 or 1)
+    JournalHeader *header;	// of the transaction being written
+
+    int HeaderSector(int h) { return firstSector + h * JournalHalf; }
+};
+
+#endif // JOURNAL_H
@@ -5,7 +5,9 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  There is one copy of it however
+//	many times the file is open, kept by the file system (cf. Inode
+//	in filesys.h); each OpenFile has its own position in the file.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -22,34 +24,43 @@
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is open already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 {
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = fileSystem->OpenInode(sector);
+    hdr = inode->hdr;
     seekPosition = 0;
+    nextSequential = 0;
+    lastSector = -1;
+    readAhead = 0;
+    metadata = FALSE;
 }
 
 OpenFile::OpenFile(int sector, int _type)
 {
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = fileSystem->OpenInode(sector);
+    hdr = inode->hdr;
     seekPosition = 0;
+    nextSequential = 0;
+    lastSector = -1;
+    readAhead = 0;
+    metadata = FALSE;
     type = _type;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
-// 	Close a Nachos file, de-allocating any in-memory data structures.
+// 	Close a Nachos file, de-allocating any in-memory data structures
+//	(the header, if no one else has the file open).
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    fileSystem->CloseInode(inode);
 }
 
 //----------------------------------------------------------------------
@@ -99,17 +110,16 @@ int OpenFile::Write(char *into, int numBytes)
 //	no side effects (except that Write modifies the file, of course).
 //
 //	There is no guarantee the request starts or ends on an even disk sector
-//	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	boundary.  Sectors go through the buffer cache, which copies just the
+//	part of each sector we are interested in.  For a sector that is only
+//	partially written, the cache reads in the rest of it, if it doesn't
+//	have it already; a sector that is entirely overwritten is never read.
 //
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	A write that goes past the end of the file makes the file longer
+//	(cf. FileSystem::Extend); if the disk is too full for that, only
+//	the part that fits in the file as it is gets written.  Writing
+//	beyond the end leaves a hole, which reads back as zeroes.
+//	Writes to metadata files go through the journal.
 //
 //	"into" -- the buffer to contain the data to be read from disk
 //	"from" -- the buffer containing the data to be written to disk
@@ -121,8 +131,7 @@ int OpenFile::Write(char *into, int numBytes)
 int OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int done, offset, chunk;
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0; // check request
@@ -131,61 +140,97 @@ int OpenFile::ReadAt(char *into, int numBytes, int position)
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-                              &buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete[] buf;
+    // copy what we want out of each full or partial sector
+    for (done = 0; done < numBytes; done += chunk)
+    {
+        offset = (position + done) % SectorSize;
+        chunk = min(SectorSize - offset, numBytes - done);
+        bufferCache->Read(hdr->ByteToSector(position + done), &into[done],
+                          offset, chunk);
+    }
+    ReadAhead(position, numBytes);
     return numBytes;
 }
 
 int OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int done, offset, chunk;
+    char zeroes[SectorSize];
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position < 0))
         return 0; // check request
     if ((position + numBytes) > fileLength)
-        numBytes = fileLength - position;
+    {
+        if (fileSystem->Extend(inode, position + numBytes))
+        {
+            // fill the hole, if any, between the old end and "position"
+            bzero(zeroes, SectorSize);
+            for (done = fileLength; done < position; done += chunk)
+            {
+                offset = done % SectorSize;
+                chunk = min(SectorSize - offset, position - done);
+                bufferCache->Write(hdr->ByteToSector(done), zeroes,
+                                   offset, chunk, metadata);
+            }
+        }
+        else if (position >= fileLength)
+            return 0; // no room to grow
+        else
+            numBytes = fileLength - position;
+    }
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
-
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
-
-    // read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize],
-               SectorSize, lastSector * SectorSize);
+    // copy the bytes we want to change into each full or partial sector
+    for (done = 0; done < numBytes; done += chunk)
+    {
+        offset = (position + done) % SectorSize;
+        chunk = min(SectorSize - offset, numBytes - done);
+        bufferCache->Write(hdr->ByteToSector(position + done), &from[done],
+                           offset, chunk, metadata);
+    }
+    return numBytes;
+}
 
-    // copy in the bytes we want to change
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called after each read, to detect sequential access.  A read that
+//	starts where the last one ended is sequential; each time such
+//	reads move on to a new sector, the number of sectors to read
+//	ahead doubles (up to the buffer cache's limit), and the cache is
+//	asked to fetch that many sectors past the one just read.  Any
+//	other read stops the read-ahead, until the file is again read
+//	sequentially.
+//
+//	Reads within the sector already read don't ask again, so a file
+//	read a byte at a time costs one request per sector.
+//
+//	"position" -- the offset within the file of the first byte read
+//	"numBytes" -- the number of bytes read
+//----------------------------------------------------------------------
 
-    // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-                               &buf[(i - firstSector) * SectorSize]);
-    delete[] buf;
-    return numBytes;
+void OpenFile::ReadAhead(int position, int numBytes)
+{
+    int sector = divRoundDown(position + numBytes - 1, SectorSize);
+    int numSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int sectors[MaxReadAhead];
+    int i, count;
+
+    if (position != nextSequential)
+        readAhead = 0; // random access
+    else if (sector != lastSector)
+        readAhead = min(max(2 * readAhead, 1), bufferCache->ReadAheadLimit());
+    nextSequential = position + numBytes;
+    if (sector == lastSector)
+        return;
+    lastSector = sector;
+
+    for (count = 0, i = sector + 1; count < readAhead && i < numSectors;
+         count++, i++)
+        sectors[count] = hdr->ByteToSector(i * SectorSize);
+    if (count > 0)
+        bufferCache->ReadAhead(sectors, count);
 }
 
 //----------------------------------------------------------------------
@@ -110,6 +110,7 @@ private:
 
 #else // FILESYS
 class FileHeader;
+class Inode;
 
 class OpenFile
 {
@@ -149,9 +150,23 @@ public:
 		return seekPosition;
 	}
 
+	/// @brief Mark the file as file system metadata (the bitmap or a
+	/// directory), so that writes to it go through the journal
+	void SetMetadata() { metadata = TRUE; }
+
 private:
-	FileHeader *hdr;  // Header for this file
+	Inode *inode;	  // Shared with other opens of the file
+	FileHeader *hdr;  // Header for this file (in the inode)
 	int seekPosition; // Current position within the file
+	bool metadata;	  // Log writes (cf. SetMetadata)?
+
+	int nextSequential; // Where a sequential read would start next
+	int lastSector;		// Sector of the file that was read last
+	int readAhead;		// How many sectors to read ahead of it;
+						// doubles while reads stay sequential
+
+	void ReadAhead(int position, int numBytes); // Note a read, and
+												// read ahead if sequential
 };
 
 #endif // FILESYS
@@ -1,25 +1,33 @@
-// synchdisk.cc 
-//	Routines to synchronously access the disk.  The physical disk 
+// synchdisk.cc
+//	Routines to synchronously access the disk.  The physical disk
 //	is an asynchronous device (disk requests return immediately, and
 //	an interrupt happens later on).  This is a layer on top of
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request carries a semaphore, to synchronize the interrupt
+//	handler with the thread waiting for it.  Because the physical
+//	disk can only handle one operation at a time, requests that
+//	arrive while it is busy are queued; each time the disk finishes
+//	one, the interrupt handler sends it the next, chosen by the disk
+//	scheduling policy.  The queue is only touched with interrupts
+//	off.
+//
+//	A read can also be queued without waiting for it (read-ahead,
+//	for the buffer cache); the interrupt handler calls back when it
+//	is done.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
-// 	Disk interrupt handler.  Need this to be a C routine, because 
+// 	Disk interrupt handler.  Need this to be a C routine, because
 //	C++ can't handle pointers to member functions.
 //----------------------------------------------------------------------
 
@@ -38,12 +46,14 @@ DiskRequestDone (int arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"whichPolicy" -- the order to serve waiting requests in
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, DiskPolicy whichPolicy)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    policy = whichPolicy;
+    active = waiting = NULL;
+    sweepingUp = TRUE;
     disk = new Disk(name, DiskRequestDone, (int) this);
 }
 
@@ -56,8 +66,6 @@ SynchDisk::SynchDisk(char* name)
 SynchDisk::~SynchDisk()
 {
     delete disk;
-    delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +80,15 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskRequest request;
+
+    request.sector = sectorNumber;
+    request.data = data;
+    request.writing = FALSE;
+    request.done = new Semaphore("disk read", 0);
+    Queue(&request);
+    request.done->P();			// wait for interrupt
+    delete request.done;
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +103,195 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskRequest request;
+
+    request.sector = sectorNumber;
+    request.data = data;
+    request.writing = TRUE;
+    request.done = new Semaphore("disk write", 0);
+    Queue(&request);
+    request.done->P();			// wait for interrupt
+    delete request.done;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Queue a read of a sector into a buffer, and return without
+//	waiting.  The buffer mustn't be used until the read is done,
+//	which the interrupt handler signals by calling
+//	(*callWhenDone)(callArg).
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//	"callWhenDone", "callArg" -- what to call once it is read
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber, char* data,
+		     VoidFunctionPtr callWhenDone, int callArg)
+{
+    DiskRequest *request = new DiskRequest;	// deleted once done
+
+    request->sector = sectorNumber;
+    request->data = data;
+    request->writing = FALSE;
+    request->done = NULL;
+    request->callWhenDone = callWhenDone;
+    request->callArg = callArg;
+    Queue(request);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Send the disk the next request, if any
+//	is waiting, and wake up the thread waiting for the one that
+//	finished (or, for a read-ahead, tell whoever asked for it).
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
-{ 
-    semaphore->V();
+{
+    DiskRequest *request = active;
+
+    stats->diskWaitTicks += stats->totalTicks - request->startTime;
+    active = NULL;
+    if (waiting != NULL)
+	Start(Next());
+
+    if (request->done != NULL)
+	request->done->V();
+    else {
+	(*request->callWhenDone)(request->callArg);
+	delete request;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PolicyName
+// 	Return the name of a disk scheduling policy, as given on the
+//	command line (cf. -ds in main.cc).
+//----------------------------------------------------------------------
+
+const char *
+SynchDisk::PolicyName(DiskPolicy policy)
+{
+    switch (policy) {
+      case FCFSDisk:	return "fcfs";
+      case SSTFDisk:	return "sstf";
+      case SCANDisk:	return "scan";
+      case CLOOKDisk:	return "clook";
+    }
+    return "unknown";
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Queue
+// 	Send a request to the disk if it is idle; otherwise add it to
+//	the end of the queue.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Queue(DiskRequest *request)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    DiskRequest **last;
+
+    request->startTime = stats->totalTicks;
+    request->next = NULL;
+    stats->numDiskRequests++;
+    if (active == NULL)
+	Start(request);
+    else {
+	for (last = &waiting; *last != NULL; last = &(*last)->next)
+	    ;
+	*last = request;
+	DEBUG('d', "Queueing request for sector %d behind sector %d\n",
+	      request->sector, active->sector);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Next
+// 	Take the request to serve next off the queue, which must not
+//	be empty.  Distances are measured in sectors from the one the
+//	head is at; ties go to the request that has waited longest.
+//
+//	FCFS takes the oldest request.
+//	SSTF takes the nearest request, in either direction.
+//	SCAN takes the nearest request in the direction the head is
+//	    moving, turning around when there are none left that way.
+//	C-LOOK takes the nearest request at or above the head; when
+//	    there are none, it goes back to the lowest request.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::Next()
+{
+    int head = disk->HeadPosition();
+    DiskRequest **best = &waiting, **r;
+    DiskRequest *request;
+    int dist, bestDist;
+
+    switch (policy) {
+      case FCFSDisk:
+	break;
+      case SSTFDisk:
+	bestDist = NumSectors;
+	for (r = &waiting; *r != NULL; r = &(*r)->next) {
+	    dist = (*r)->sector - head;
+	    if (dist < 0)
+		dist = -dist;
+	    if (dist < bestDist) {
+		best = r;
+		bestDist = dist;
+	    }
+	}
+	break;
+      case SCANDisk:
+      case CLOOKDisk:
+	for (int pass = 0; pass < 2; pass++) {
+	    best = NULL;
+	    bestDist = NumSectors;
+	    for (r = &waiting; *r != NULL; r = &(*r)->next) {
+		dist = sweepingUp ? (*r)->sector - head : head - (*r)->sector;
+		if (dist >= 0 && dist < bestDist) {
+		    best = r;
+		    bestDist = dist;
+		}
+	    }
+	    if (best != NULL)
+		break;
+	    if (policy == SCANDisk)
+		sweepingUp = !sweepingUp;	// turn around
+	    else
+		head = -1;		// start again from the bottom
+	}
+	break;
+    }
+    ASSERT(best != NULL && *best != NULL);
+    request = *best;
+    *best = request->next;
+    return request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Start
+// 	Send a request to the (idle) disk, accounting for how far the
+//	head has to move.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Start(DiskRequest *request)
+{
+    int tracks = request->sector / SectorsPerTrack
+		 - disk->HeadPosition() / SectorsPerTrack;
+
+    ASSERT(active == NULL);
+    active = request;
+    stats->diskSeekTracks += (tracks < 0) ? -tracks : tracks;
+    if (request->writing)
+	disk->WriteRequest(request->sector, request->data);
+    else
+	disk->ReadRequest(request->sector, request->data);
 }
@@ -1,9 +1,9 @@
-// synchdisk.h 
-// 	Data structures to export a synchronous interface to the raw 
+// synchdisk.h
+// 	Data structures to export a synchronous interface to the raw
 //	disk device.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -14,6 +14,27 @@
 #include "disk.h"
 #include "synch.h"
 
+// The order in which requests waiting for the disk are sent to it:
+// first come first served, shortest seek (from the current head
+// position) first, the elevator (SCAN: sweep up, then down), or the
+// circular elevator (C-LOOK: sweep up, then jump back to the lowest).
+
+enum DiskPolicy { FCFSDisk, SSTFDisk, SCANDisk, CLOOKDisk };
+
+// A request waiting for, or being served by, the disk.
+
+class DiskRequest {
+  public:
+    int sector;			// the disk sector to read/write
+    char *data;			// where the data comes from/goes
+    bool writing;		// write (rather than read)?
+    Semaphore *done;		// V'ed when the request is done, or NULL
+    VoidFunctionPtr callWhenDone; // otherwise, called when it is done
+    int callArg;		// with this argument
+    int startTime;		// when the request was made
+    DiskRequest *next;		// the next request waiting
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -23,31 +44,51 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Any number of threads can be waiting at once; their
+// requests are queued, and sent to the disk one at a time, in the
+// order the disk scheduling policy chooses.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
+    SynchDisk(char* name, DiskPolicy whichPolicy = FCFSDisk);
+    					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
-    
+
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
-    					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+    					// only once the data is actually read
+					// or written.  These queue a request
+					// for Disk::ReadRequest/WriteRequest
+					// and then wait until it is done.
     void WriteSector(int sectorNumber, char* data);
-    
+
+    void ReadAhead(int sectorNumber, char* data,
+		   VoidFunctionPtr callWhenDone, int callArg);
+					// Queue a read without waiting for
+					// it; (*callWhenDone)(callArg) is
+					// invoked, by the interrupt handler,
+					// once it is done
+
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
+    static const char *PolicyName(DiskPolicy policy);
+					// "fcfs", "sstf", "scan" or "clook"
+
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskPolicy policy;			// How to order waiting requests
+    DiskRequest *active;		// Request the disk is working on
+    DiskRequest *waiting;		// Requests waiting for the disk,
+					// in the order they were made
+    bool sweepingUp;			// For SCAN: which way the head moves
+
+    void Queue(DiskRequest *request);	// Send a request to the disk, or
+					// queue it if the disk is busy
+    DiskRequest *Next();		// Take the next request to serve
+					// off the queue
+    void Start(DiskRequest *request);	// Send a request to the disk
 };
 
 #endif // SYNCHDISK_H
@@ -76,6 +76,10 @@ public:
   // newSector will take:
   // (seek + rotational delay + transfer)
 
+  int HeadPosition() { return lastSector; }
+  // Sector of the previous request,
+  // where the head is now
+
 private:
   int fileno;              // UNIX file number for simulated disk
   VoidFunctionPtr handler; // Interrupt handler, to be invoked
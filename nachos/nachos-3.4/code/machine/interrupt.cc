@@ -48,6 +48,157 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
     arg = param;
     when = time;
     type = kind;
+    order = 0; // set by PendingQueue::Insert
+}
+
+//----------------------------------------------------------------------
+// Due
+// 	Is interrupt "a" to be fired before interrupt "b"?  The earlier
+//	one is, or if both are due at the same time, the one scheduled
+//	first.
+//----------------------------------------------------------------------
+
+static inline bool
+Due(PendingInterrupt *a, PendingInterrupt *b)
+{
+    if (a->when != b->when)
+        return a->when < b->when;
+    return (int)(a->order - b->order) < 0; // correct across wraparound
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::PendingQueue
+// 	Initialize an empty queue of pending interrupts.  The heap array
+//	grows as needed.
+//----------------------------------------------------------------------
+
+PendingQueue::PendingQueue()
+{
+    capacity = 16;
+    heap = new PendingInterrupt *[capacity];
+    numPending = 0;
+    nextOrder = 0;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::~PendingQueue
+// 	De-allocate the queue, along with the interrupts that never
+//	got to fire.
+//----------------------------------------------------------------------
+
+PendingQueue::~PendingQueue()
+{
+    for (int i = 0; i < numPending; i++)
+        delete heap[i];
+    delete[] heap;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::SiftUp
+// 	Move heap[i] up towards the root until its parent is due before
+//	it.
+//----------------------------------------------------------------------
+
+void PendingQueue::SiftUp(int i)
+{
+    PendingInterrupt *item = heap[i];
+
+    while (i > 0 && Due(item, heap[(i - 1) / 2]))
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = item;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::SiftDown
+// 	Move heap[i] down towards the leaves until it is due before both
+//	its children.
+//----------------------------------------------------------------------
+
+void PendingQueue::SiftDown(int i)
+{
+    PendingInterrupt *item = heap[i];
+    int child;
+
+    while ((child = 2 * i + 1) < numPending)
+    {
+        if (child + 1 < numPending && Due(heap[child + 1], heap[child]))
+            child++; // the right child is due first
+        if (!Due(heap[child], item))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = item;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Insert
+// 	Add "toOccur" to the queue, after any interrupt already in it
+//	that is due at the same time.
+//----------------------------------------------------------------------
+
+void PendingQueue::Insert(PendingInterrupt *toOccur)
+{
+    if (numPending == capacity)
+    { // out of room: double the array
+        PendingInterrupt **bigger = new PendingInterrupt *[2 * capacity];
+        for (int i = 0; i < numPending; i++)
+            bigger[i] = heap[i];
+        delete[] heap;
+        heap = bigger;
+        capacity *= 2;
+    }
+    toOccur->order = nextOrder++;
+    heap[numPending] = toOccur;
+    SiftUp(numPending++);
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::RemoveFront
+// 	Remove and return the interrupt that is due first, or NULL if
+//	there are none.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+PendingQueue::RemoveFront()
+{
+    PendingInterrupt *front;
+
+    if (numPending == 0)
+        return NULL;
+    front = heap[0];
+    heap[0] = heap[--numPending];
+    if (numPending > 0)
+        SiftDown(0);
+    return front;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Print
+// 	Print every pending interrupt, in the order they will fire.
+//	The heap is only partially ordered, so this sorts a copy of it;
+//	it is only used for debugging.
+//----------------------------------------------------------------------
+
+static void PrintPending(int arg);
+
+void PendingQueue::Print()
+{
+    PendingInterrupt **sorted = new PendingInterrupt *[numPending + 1];
+    int i, j;
+
+    for (i = 0; i < numPending; i++)
+    { // insertion sort
+        for (j = i; j > 0 && Due(heap[i], sorted[j - 1]); j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = heap[i];
+    }
+    for (i = 0; i < numPending; i++)
+        PrintPending((int)sorted[i]);
+    delete[] sorted;
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +211,7 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new PendingQueue();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,9 +224,7 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-        delete (PendingInterrupt *)pending->Remove();
-    delete pending;
+    delete pending; // along with any interrupts still pending
 }
 
 //----------------------------------------------------------------------
@@ -146,19 +295,32 @@ void Interrupt::Enable()
 //		a user instruction is executed
 //----------------------------------------------------------------------
 void Interrupt::OneTick()
+{
+    Ticks(1);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Ticks
+// 	Advance simulated time as "count" calls to OneTick would,
+//	but check for pending interrupts only once at the end.
+//	Used by the simulator to charge a whole basic block of user
+//	instructions in one go; any interrupt that came due in the middle
+//	of the block is delivered at its end.
+//----------------------------------------------------------------------
+void Interrupt::Ticks(int count)
 {
     MachineStatus old = status;
 
     // advance simulated time
     if (status == SystemMode)
     {
-        stats->totalTicks += SystemTick;
-        stats->systemTicks += SystemTick;
+        stats->totalTicks += SystemTick * count;
+        stats->systemTicks += SystemTick * count;
     }
     else
     { // USER_PROGRAM
-        stats->totalTicks += UserTick;
-        stats->userTicks += UserTick;
+        stats->totalTicks += UserTick * count;
+        stats->userTicks += UserTick * count;
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
@@ -249,7 +411,7 @@ void Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on the pending queue (a heap).
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -269,7 +431,7 @@ void Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType
           intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    pending->Insert(toOccur);
 }
 
 //----------------------------------------------------------------------
@@ -294,11 +456,11 @@ bool Interrupt::CheckIfDue(bool advanceClock)
                              // to invoke an interrupt handler
     if (DebugIsEnabled('i'))
         DumpState();
-    PendingInterrupt *toOccur =
-        (PendingInterrupt *)pending->SortedRemove(&when);
+    PendingInterrupt *toOccur = pending->Front();
 
     if (toOccur == NULL) // no pending interrupts
         return FALSE;
+    when = toOccur->when;
 
     if (advanceClock && when > stats->totalTicks)
     { // advance the clock
@@ -306,17 +468,13 @@ bool Interrupt::CheckIfDue(bool advanceClock)
         stats->totalTicks = when;
     }
     else if (when > stats->totalTicks)
-    { // not time yet, put it back
-        pending->SortedInsert(toOccur, when);
-        return FALSE;
-    }
+        return FALSE; // not time yet, leave it be
 
     // Check if there is nothing more to do, and if so, quit
-    if ((status == IdleMode) && (toOccur->type == TimerInt) && pending->IsEmpty())
-    {
-        pending->SortedInsert(toOccur, when);
+    if ((status == IdleMode) && (toOccur->type == TimerInt) &&
+        pending->NumPending() == 1)
         return FALSE;
-    }
+    pending->RemoveFront();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n",
           intTypeNames[toOccur->type], toOccur->when);
@@ -362,7 +520,7 @@ void Interrupt::DumpState()
            intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Mapcar(PrintPending);
+    pending->Print();
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
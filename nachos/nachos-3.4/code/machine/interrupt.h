@@ -84,6 +84,41 @@ public:
   int arg;                 // The argument to the function.
   int when;                // When the interrupt is supposed to fire
   IntType type;            // for debugging
+  unsigned int order;      // When it was scheduled, relative to the
+                           // others; breaks ties between equal "when"s
+};
+
+// The interrupts scheduled to occur, in the order they will: by "when",
+// and those due at the same time in the order they were scheduled.
+// Kept in a binary heap, so that scheduling an interrupt and taking
+// the next one due each take O(log n) time.
+
+class PendingQueue
+{
+public:
+  PendingQueue();  // initialize an empty queue
+  ~PendingQueue(); // de-allocate it, and any interrupts still in it
+
+  void Insert(PendingInterrupt *toOccur); // schedule an interrupt
+  PendingInterrupt *Front()               // the next one due, or NULL
+  {
+    return (numPending > 0) ? heap[0] : NULL;
+  }
+  PendingInterrupt *RemoveFront();        // take the next one due off
+  bool IsEmpty() { return numPending == 0; }
+  int NumPending() { return numPending; }
+
+  void Print(); // print them all, in the order they will occur
+
+private:
+  PendingInterrupt **heap; // heap[i] is due no later than its children,
+                           // heap[2i+1] and heap[2i+2]
+  int numPending;          // number of interrupts in the heap
+  int capacity;            // size of the "heap" array
+  unsigned int nextOrder;  // "order" of the next interrupt inserted
+
+  void SiftUp(int i);   // restore the heap order after heap[i]
+  void SiftDown(int i); // moved up or down
 };
 
 // The following class defines the data structures for the simulation
@@ -127,12 +162,14 @@ public:
                 int arg, int when, IntType type); // at time ``when''.  This is called
                                                   // by the hardware device simulators.
 
-  void OneTick(); // Advance simulated time
+  void OneTick();             // Advance simulated time
+  void Ticks(int count);      // Advance simulated time by several
+                             // user instructions at once
 
 private:
   IntStatus level;      // are interrupts enabled or disabled?
-  List *pending;        // the list of interrupts scheduled
-                        // to occur in the future
+  PendingQueue *pending; // the interrupts scheduled
+                         // to occur in the future
   bool inHandler;       // TRUE if we are running an interrupt handler
   bool yieldOnReturn;   // TRUE if we are to context switch
                         // on return from the interrupt handler
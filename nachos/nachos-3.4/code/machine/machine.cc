@@ -50,9 +50,15 @@ static void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"predecode" -- if TRUE, keep a cache of decoded instructions for
+//		every physical page, instead of decoding on every fetch.
+//	"blocks" -- if TRUE, run user code a basic block at a time (see
+//		Machine::RunBlock) whenever not single-stepping.
+//	"tlbEntries" -- if not 0, translate through a software-loaded TLB
+//		of this many entries, instead of a linear page table.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool predecode, bool blocks, int tlbEntries)
 {
     int i;
 
@@ -61,15 +67,63 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
         mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-        tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else // use linear page table
-    tlb = NULL;
+    tlbSize = tlbEntries;
+    tlbAsid = 0;
+    llAddress = -1;
+    if (tlbSize > 0)
+    {
+        tlb = new TranslationEntry[tlbSize];
+        tlbLastUse = new int[tlbSize];
+        for (i = 0; i < tlbSize; i++)
+        {
+            tlb[i].valid = FALSE;
+            tlbLastUse[i] = 0;
+        }
+    }
+    else
+    { // use linear page table
+        tlb = NULL;
+        tlbLastUse = NULL;
+    }
     pageTable = NULL;
-#endif
+
+    if (predecode)
+    {
+        decodeCache = new Instruction[NumPhysPages * InstrsPerPage];
+        decodeValid = new bool[NumPhysPages * InstrsPerPage];
+        for (i = 0; i < NumPhysPages * InstrsPerPage; i++)
+            decodeValid[i] = FALSE;
+    }
+    else
+    {
+        decodeCache = NULL;
+        decodeValid = NULL;
+    }
+
+    if (blocks)
+    {
+        blockTable = new TranslatedBlock *[NumPhysPages * InstrsPerPage];
+        for (i = 0; i < NumPhysPages * InstrsPerPage; i++)
+            blockTable[i] = NULL;
+        pageEpoch = new unsigned int[NumPhysPages];
+        for (i = 0; i < NumPhysPages; i++)
+            pageEpoch[i] = 0;
+    }
+    else
+    {
+        blockTable = NULL;
+        pageEpoch = NULL;
+    }
+
+    if (DebugIsEnabled('a') || tlb != NULL)
+        xlateCache = NULL; // so that every access gets traced, or
+                           // is counted and timed by the TLB
+    else
+    {
+        xlateCache = new CachedTranslation[TranslationCacheSize];
+        for (i = 0; i < TranslationCacheSize; i++)
+            xlateCache[i].vpn = NoCachedPage;
+    }
 
     singleStep = debug;
     CheckEndian();
@@ -84,7 +138,46 @@ Machine::~Machine()
 {
     delete[] mainMemory;
     if (tlb != NULL)
+    {
         delete[] tlb;
+        delete[] tlbLastUse;
+    }
+    if (decodeCache != NULL)
+    {
+        delete[] decodeCache;
+        delete[] decodeValid;
+    }
+    if (xlateCache != NULL)
+        delete[] xlateCache;
+    if (blockTable != NULL)
+    {
+        for (int i = 0; i < NumPhysPages * InstrsPerPage; i++)
+            delete blockTable[i];
+        delete[] blockTable;
+        delete[] pageEpoch;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecoded
+// 	Throw away the predecoded instructions and translated blocks
+//	of one physical page.
+//	Stores made by the user program are caught in WriteMem, but the
+//	kernel writes "mainMemory" directly when it loads a program, so
+//	it must call this for every frame it (re)fills.
+//
+//	"physPage" -- the physical page whose contents are changing
+//----------------------------------------------------------------------
+
+void Machine::InvalidateDecoded(int physPage)
+{
+    ASSERT((physPage >= 0) && (physPage < NumPhysPages));
+    if (pageEpoch != NULL)
+        pageEpoch[physPage]++;
+    if (decodeValid == NULL)
+        return;
+    for (int i = 0; i < InstrsPerPage; i++)
+        decodeValid[physPage * InstrsPerPage + i] = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -104,6 +197,7 @@ void Machine::RaiseException(ExceptionType which, int badVAddr)
     //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0); // finish anything in progress
+    llAddress = -1;    // the kernel may touch memory: an SC must fail
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which); // interrupts are enabled at this point
     interrupt->setStatus(UserMode);
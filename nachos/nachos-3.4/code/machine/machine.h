@@ -34,7 +34,13 @@
 
 #define NumPhysPages 128
 #define MemorySize (NumPhysPages * PageSize)
-#define TLBSize 4 // if there is a TLB, make it small
+#define TLBSize 4 // if there is a TLB, make it small (default size)
+
+#define InstrsPerPage (PageSize / 4) // instruction words in one page
+
+#define TranslationCacheSize 64		// recent translations remembered
+										// by the simulator (see below)
+#define NoCachedPage ((unsigned int)-1) // marks an unused cache entry
 
 enum ExceptionType
 {
@@ -85,6 +91,61 @@ public:
 					 // Immediates are sign-extended.
 };
 
+class Machine;
+
+// Execution of a single decoded instruction.  Each opcode has a handler
+// (see mipssim.cc) shared by OneInstruction and the basic block engine.
+// Besides the machine registers, a handler reads and updates an OpContext:
+// the address of the next instruction (for branch targets and links),
+// the PC to install after that one, and any delayed load to start.
+// A handler returns FALSE if the instruction raised an exception.
+
+struct OpContext
+{
+	int nextPC;	  // registers[NextPCReg] while executing
+	int pcAfter;  // becomes NextPCReg once the instruction is done
+	int loadReg;  // delayed load started by this instruction, if any
+	int loadValue;
+};
+
+typedef bool (*OpHandler)(Machine *m, Instruction *instr, OpContext *ctx);
+
+// A straight-line run of instructions within one physical page, ending
+// with a branch or jump and its delay slot, a syscall, or the end of the
+// page.  Translated once into a chain of handlers and then re-executed
+// without fetching, decoding or ticking the clock per instruction.
+
+struct BlockOp
+{
+	OpHandler handler; // handler for instr.opCode
+	bool mayTrap;	   // can raise an exception (the kernel may look at PC)
+	bool isStore;	   // writes memory (may overwrite the block itself)
+	Instruction instr;
+};
+
+class TranslatedBlock
+{
+public:
+	TranslatedBlock(int length, unsigned int epoch);
+	~TranslatedBlock();
+
+	int length;			// number of instructions
+	unsigned int epoch; // Machine::pageEpoch of the page when built
+	BlockOp *ops;
+};
+
+// A translation remembered by the simulator, so that Translate can be
+// skipped for recently used pages.  This is not the MIPS TLB: it is
+// invisible to user programs, and the kernel only has to flush it (see
+// Machine::FlushTranslationCache) when it changes a translation.
+
+struct CachedTranslation
+{
+	unsigned int vpn; // virtual page, or NoCachedPage
+	char *page;		  // where that page lives in mainMemory
+	bool writable;	  // stores may skip Translate (dirty bit already set)
+};
+
 // The following class defines the simulated host workstation hardware, as
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our
@@ -101,8 +162,9 @@ public:
 class Machine
 {
 public:
-	Machine(bool debug); // Initialize the simulation of the hardware
-						 // for running user programs
+	Machine(bool debug, bool predecode, bool blocks, int tlbEntries);
+	// Initialize the simulation of the
+	// hardware for running user programs
 	~Machine();			 // De-allocate the data structures
 
 	// Routines callable by the Nachos kernel
@@ -113,6 +175,19 @@ public:
 	void WriteRegister(int num, int value);
 	// store a value into a CPU register
 
+	int CopyIn(int virtAddr, char *buffer, int size);
+	int CopyOut(int virtAddr, char *buffer, int size);
+	// Copy "size" bytes between user virtual
+	// memory and a kernel buffer, a page at
+	// a time; return the number copied
+	int CopyInString(int virtAddr, char *buffer, int maxLen);
+	// Copy in a string of at most "maxLen"
+	// chars; return its length
+	int UserWordAddress(int virtAddr);
+	// Physical address of the user word at
+	// "virtAddr", loading its page if need
+	// be; -1 if it can't be translated
+
 	// Routines internal to the machine simulation -- DO NOT call these
 
 	void OneInstruction(Instruction *instr);
@@ -120,6 +195,23 @@ public:
 	void DelayedLoad(int nextReg, int nextVal);
 	// Do a pending delayed load (modifying a reg)
 
+	Instruction *FetchDecoded(int virtAddr);
+	// Return the predecoded instruction at
+	// "virtAddr", decoding it on a miss.
+	// Returns NULL if the fetch trapped.
+	void InvalidateDecoded(int physPage);
+	// Forget every predecoded instruction and
+	// translated block of a frame whose
+	// contents the kernel is about to replace
+	// behind WriteMem's back
+
+	int RunBlock();
+	// Run the basic block at the PC; return
+	// the number of instructions executed,
+	// or 0 if OneInstruction must be used
+	TranslatedBlock *TranslateBlock(int physAddr);
+	// Build the block starting at "physAddr"
+
 	bool ReadMem(int addr, int size, int *value);
 	bool WriteMem(int addr, int size, int value);
 	// Read or write 1, 2, or 4 bytes of virtual
@@ -133,6 +225,12 @@ public:
 	// and return an exception code if the
 	// translation couldn't be completed.
 
+	void FlushTranslationCache();
+	// Forget all cached translations.  The
+	// kernel must call this whenever it
+	// switches, edits or clears the use/dirty
+	// bits of the page table or TLB.
+
 	void RaiseException(ExceptionType which, int badVAddr);
 	// Trap to the Nachos kernel, because of a
 	// system call or other exception.
@@ -170,11 +268,34 @@ public:
 
 	TranslationEntry *tlb; // this pointer should be considered
 						   // "read-only" to Nachos kernel code
+	int tlbSize;		   // number of entries in "tlb"
+	int tlbAsid;		   // address space ID of the running program;
+						   // only TLB entries tagged with it match
+	int *tlbLastUse;	   // time (totalTicks) each TLB entry last
+						   // matched, for the kernel's refill policy
+	int llAddress;		   // physical address reserved by the last LL,
+						   // for SC to store to; -1 if none.  The
+						   // kernel clears it on a context switch
 
 	TranslationEntry *pageTable;
 	unsigned int pageTableSize;
 
 private:
+	Instruction *decodeCache; // predecoded instructions, InstrsPerPage
+							  // per physical page, NULL if disabled
+	bool *decodeValid;		  // is the matching decodeCache entry current?
+							  // Cleared by WriteMem on every store
+	TranslatedBlock **blockTable; // translated block starting at each
+								  // physical word, NULL if disabled
+	unsigned int *pageEpoch;	  // bumped on every store to a frame;
+								  // blocks built at an older epoch are stale
+	CachedTranslation *xlateCache; // direct-mapped by virtual page,
+								   // NULL if disabled
+	char *CachedAddress(int virtAddr, int size, bool writing);
+	// Host address of "virtAddr" if the
+	// translation cache can provide it
+	char *UserSpan(int virtAddr, int size, bool writing, int *spanLen);
+	// Translate for the copy routines
 	bool singleStep;  // drop back into the debugger after each
 					  // simulated instruction
 	int runUntilTime; // drop back into the debugger when simulated
@@ -23,6 +23,10 @@ static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 // 	Simulate the execution of a user-level program on Nachos.
 //	Called by the kernel when the program starts up; never returns.
 //
+//	If the block engine is enabled (-bb), whole basic blocks are run
+//	at a time by RunBlock, and one instruction at a time by
+//	OneInstruction only where no block can be used.
+//
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
 //----------------------------------------------------------------------
@@ -30,6 +34,8 @@ static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 void Machine::Run()
 {
 	Instruction *instr = new Instruction; // storage for decoded instruction
+	bool useBlocks = (blockTable != NULL) && !singleStep &&
+					 !DebugIsEnabled('m');
 
 	if (DebugIsEnabled('m'))
 		printf("Starting thread \"%s\" at time %d\n",
@@ -37,6 +43,15 @@ void Machine::Run()
 	interrupt->setStatus(UserMode);
 	for (;;)
 	{
+		if (useBlocks)
+		{
+			int numInstrs = RunBlock();
+			if (numInstrs > 0)
+			{
+				interrupt->Ticks(numInstrs);
+				continue;
+			}
+		}
 		OneInstruction(instr);
 		interrupt->OneTick();
 		if (singleStep && (runUntilTime <= stats->totalTicks))
@@ -68,512 +83,1058 @@ TypeToReg(RegType reg, Instruction *instr)
 }
 
 //----------------------------------------------------------------------
-// Machine::OneInstruction
-// 	Execute one instruction from a user-level program
-//
-// 	If there is any kind of exception or interrupt, we invoke the
-//	exception handler, and when it returns, we return to Run(), which
-//	will re-invoke us in a loop.  This allows us to
-//	re-start the instruction execution from the beginning, in
-//	case any of our state has changed.  On a syscall,
-// 	the OS software must increment the PC so execution begins
-// 	at the instruction immediately after the syscall.
+// Instruction handlers
+// 	One routine per opcode, indexed by opCode in opHandlers below.
+//	Each executes its instruction against m->registers and memory
+//	(cf. Kane's book), records any branch target or delayed load in
+//	"ctx", and returns FALSE if it raised an exception.
 //
-//	This routine is re-entrant, in that it can be called multiple
-//	times concurrently -- one for each thread executing user code.
-//	We get re-entrancy by never caching any data -- we always re-start the
-//	simulation from scratch each time we are called (or after trapping
-//	back to the Nachos kernel on an exception or interrupt), and we always
-//	store all data back to the machine registers and memory before
-//	leaving.  This allows the Nachos kernel to control our behavior
-//	by controlling the contents of memory, the translation table,
-//	and the register set.
+//	After raising an exception a handler must return at once without
+//	touching "instr" again: the kernel may have switched threads and
+//	thrown away the translated block "instr" lives in.
 //----------------------------------------------------------------------
 
-void Machine::OneInstruction(Instruction *instr)
+static bool
+ExecADD(Machine *m, Instruction *instr, OpContext *ctx)
 {
-	int raw;
-	int nextLoadReg = 0;
-	int nextLoadValue = 0; // record delayed load operation, to apply
-						   // in the future
-
-	// Fetch instruction
-	if (!machine->ReadMem(registers[PCReg], 4, &raw))
-		return; // exception occurred
-	instr->value = raw;
-	instr->Decode();
-
-	if (DebugIsEnabled('m'))
+	int *registers = m->registers;
+	int sum = registers[instr->rs] + registers[instr->rt];
+	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+		((registers[instr->rs] ^ sum) & SIGN_BIT))
 	{
-		struct OpString *str = &opStrings[instr->opCode];
+		m->RaiseException(OverflowException, 0);
+		return FALSE;
+	}
+	registers[instr->rd] = sum;
+	return TRUE;
+}
 
-		ASSERT(instr->opCode <= MaxOpcode);
-		printf("At PC = 0x%x: ", registers[PCReg]);
-		printf(str->string, TypeToReg(str->args[0], instr),
-			   TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
-		printf("\n");
+static bool
+ExecADDI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	int sum = registers[instr->rs] + instr->extra;
+	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+		((instr->extra ^ sum) & SIGN_BIT))
+	{
+		m->RaiseException(OverflowException, 0);
+		return FALSE;
 	}
+	registers[instr->rt] = sum;
+	return TRUE;
+}
 
-	// Compute next pc, but don't install in case there's an error or branch.
-	int pcAfter = registers[NextPCReg] + 4;
-	int sum, diff, tmp, value;
-	unsigned int rs, rt, imm;
+static bool
+ExecADDIU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rt] = m->registers[instr->rs] + instr->extra;
+	return TRUE;
+}
 
-	// Execute the instruction (cf. Kane's book)
-	switch (instr->opCode)
-	{
+static bool
+ExecADDU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rs] + m->registers[instr->rt];
+	return TRUE;
+}
 
-	case OP_ADD:
-		sum = registers[instr->rs] + registers[instr->rt];
-		if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-			((registers[instr->rs] ^ sum) & SIGN_BIT))
-		{
-			RaiseException(OverflowException, 0);
-			return;
-		}
-		registers[instr->rd] = sum;
-		break;
+static bool
+ExecAND(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rs] & m->registers[instr->rt];
+	return TRUE;
+}
 
-	case OP_ADDI:
-		sum = registers[instr->rs] + instr->extra;
-		if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
-			((instr->extra ^ sum) & SIGN_BIT))
-		{
-			RaiseException(OverflowException, 0);
-			return;
-		}
-		registers[instr->rt] = sum;
-		break;
+static bool
+ExecANDI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rt] = m->registers[instr->rs] & (instr->extra & 0xffff);
+	return TRUE;
+}
 
-	case OP_ADDIU:
-		registers[instr->rt] = registers[instr->rs] + instr->extra;
-		break;
+static bool
+ExecBEQ(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] == m->registers[instr->rt])
+		ctx->pcAfter = ctx->nextPC + IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_ADDU:
-		registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
-		break;
+static bool
+ExecBGEZ(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (!(m->registers[instr->rs] & SIGN_BIT))
+		ctx->pcAfter = ctx->nextPC + IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_AND:
-		registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
-		break;
+static bool
+ExecBGEZAL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[R31] = ctx->nextPC + 4;
+	return ExecBGEZ(m, instr, ctx);
+}
 
-	case OP_ANDI:
-		registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
-		break;
+static bool
+ExecBGTZ(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] > 0)
+		ctx->pcAfter = ctx->nextPC + IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_BEQ:
-		if (registers[instr->rs] == registers[instr->rt])
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
+static bool
+ExecBLEZ(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] <= 0)
+		ctx->pcAfter = ctx->nextPC + IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_BGEZAL:
-		registers[R31] = registers[NextPCReg] + 4;
-	case OP_BGEZ:
-		if (!(registers[instr->rs] & SIGN_BIT))
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
+static bool
+ExecBLTZ(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] & SIGN_BIT)
+		ctx->pcAfter = ctx->nextPC + IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_BGTZ:
-		if (registers[instr->rs] > 0)
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
+static bool
+ExecBLTZAL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[R31] = ctx->nextPC + 4;
+	return ExecBLTZ(m, instr, ctx);
+}
 
-	case OP_BLEZ:
-		if (registers[instr->rs] <= 0)
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
+static bool
+ExecBNE(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] != m->registers[instr->rt])
+		ctx->pcAfter = ctx->nextPC + IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_BLTZAL:
-		registers[R31] = registers[NextPCReg] + 4;
-	case OP_BLTZ:
-		if (registers[instr->rs] & SIGN_BIT)
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
+static bool
+ExecDIV(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	if (registers[instr->rt] == 0)
+	{
+		registers[LoReg] = 0;
+		registers[HiReg] = 0;
+	}
+	else
+	{
+		registers[LoReg] = registers[instr->rs] / registers[instr->rt];
+		registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+	}
+	return TRUE;
+}
 
-	case OP_BNE:
-		if (registers[instr->rs] != registers[instr->rt])
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
+static bool
+ExecDIVU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	unsigned int rs = (unsigned int)registers[instr->rs];
+	unsigned int rt = (unsigned int)registers[instr->rt];
+	int tmp;
+	if (rt == 0)
+	{
+		registers[LoReg] = 0;
+		registers[HiReg] = 0;
+	}
+	else
+	{
+		tmp = rs / rt;
+		registers[LoReg] = (int)tmp;
+		tmp = rs % rt;
+		registers[HiReg] = (int)tmp;
+	}
+	return TRUE;
+}
 
-	case OP_DIV:
-		if (registers[instr->rt] == 0)
-		{
-			registers[LoReg] = 0;
-			registers[HiReg] = 0;
-		}
-		else
-		{
-			registers[LoReg] = registers[instr->rs] / registers[instr->rt];
-			registers[HiReg] = registers[instr->rs] % registers[instr->rt];
-		}
-		break;
+static bool
+ExecJ(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	ctx->pcAfter = (ctx->pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+	return TRUE;
+}
 
-	case OP_DIVU:
-		rs = (unsigned int)registers[instr->rs];
-		rt = (unsigned int)registers[instr->rt];
-		if (rt == 0)
-		{
-			registers[LoReg] = 0;
-			registers[HiReg] = 0;
-		}
-		else
-		{
-			tmp = rs / rt;
-			registers[LoReg] = (int)tmp;
-			tmp = rs % rt;
-			registers[HiReg] = (int)tmp;
-		}
-		break;
+static bool
+ExecJAL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[R31] = ctx->nextPC + 4;
+	return ExecJ(m, instr, ctx);
+}
 
-	case OP_JAL:
-		registers[R31] = registers[NextPCReg] + 4;
-	case OP_J:
-		pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
-		break;
+static bool
+ExecJR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	ctx->pcAfter = m->registers[instr->rs];
+	return TRUE;
+}
 
-	case OP_JALR:
-		registers[instr->rd] = registers[NextPCReg] + 4;
-	case OP_JR:
-		pcAfter = registers[instr->rs];
-		break;
+static bool
+ExecJALR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = ctx->nextPC + 4;
+	return ExecJR(m, instr, ctx);
+}
 
-	case OP_LB:
-	case OP_LBU:
-		tmp = registers[instr->rs] + instr->extra;
-		if (!machine->ReadMem(tmp, 1, &value))
-			return;
+static bool
+ExecLB(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rs] + instr->extra;
+	int value;
+	if (!m->ReadMem(tmp, 1, &value))
+		return FALSE;
 
-		if ((value & 0x80) && (instr->opCode == OP_LB))
-			value |= 0xffffff00;
-		else
-			value &= 0xff;
-		nextLoadReg = instr->rt;
-		nextLoadValue = value;
-		break;
+	if ((value & 0x80) && (instr->opCode == OP_LB))
+		value |= 0xffffff00;
+	else
+		value &= 0xff;
+	ctx->loadReg = instr->rt;
+	ctx->loadValue = value;
+	return TRUE;
+}
 
-	case OP_LH:
-	case OP_LHU:
-		tmp = registers[instr->rs] + instr->extra;
-		if (tmp & 0x1)
-		{
-			RaiseException(AddressErrorException, tmp);
-			return;
-		}
-		if (!machine->ReadMem(tmp, 2, &value))
-			return;
+static bool
+ExecLH(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rs] + instr->extra;
+	int value;
+	if (tmp & 0x1)
+	{
+		m->RaiseException(AddressErrorException, tmp);
+		return FALSE;
+	}
+	if (!m->ReadMem(tmp, 2, &value))
+		return FALSE;
 
-		if ((value & 0x8000) && (instr->opCode == OP_LH))
-			value |= 0xffff0000;
-		else
-			value &= 0xffff;
-		nextLoadReg = instr->rt;
+	if ((value & 0x8000) && (instr->opCode == OP_LH))
+		value |= 0xffff0000;
+	else
+		value &= 0xffff;
+	ctx->loadReg = instr->rt;
+	ctx->loadValue = value;
+	return TRUE;
+}
+
+// LL and SC (from MIPS II) make read-modify-write sequences atomic
+// without a system call.  LL loads a word and reserves its physical
+// address; the SC that follows stores to it only if the reservation
+// still holds, and sets rt to 1 if it stored, 0 if not.  The
+// reservation is lost on any exception, and on a context switch (see
+// Scheduler::Run), so an SC fails if anything else could have run
+// in between.  MIPS II has no load delay, so LL sets rt at once.
+
+static bool
+ExecLL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rs] + instr->extra;
+	int physAddr;
+	ExceptionType exception = m->Translate(tmp, &physAddr, 4, FALSE);
+	if (exception != NoException)
+	{
+		m->RaiseException(exception, tmp);
+		return FALSE;
+	}
+	m->registers[instr->rt] =
+		WordToHost(*(unsigned int *)&m->mainMemory[physAddr]);
+	m->llAddress = physAddr;
+	return TRUE;
+}
+
+static bool
+ExecLUI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+	m->registers[instr->rt] = instr->extra << 16;
+	return TRUE;
+}
+
+static bool
+ExecLW(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rs] + instr->extra;
+	int value;
+	if (tmp & 0x3)
+	{
+		m->RaiseException(AddressErrorException, tmp);
+		return FALSE;
+	}
+	if (!m->ReadMem(tmp, 4, &value))
+		return FALSE;
+	ctx->loadReg = instr->rt;
+	ctx->loadValue = value;
+	return TRUE;
+}
+
+static bool
+ExecLWL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value, nextLoadValue;
+
+	// ReadMem assumes all 4 byte requests are aligned on an even
+	// word boundary.  Also, the little endian/big endian swap code would
+	// fail (I think) if the other cases are ever exercised.
+	ASSERT((tmp & 0x3) == 0);
+
+	if (!m->ReadMem(tmp, 4, &value))
+		return FALSE;
+	if (registers[LoadReg] == instr->rt)
+		nextLoadValue = registers[LoadValueReg];
+	else
+		nextLoadValue = registers[instr->rt];
+	switch (tmp & 0x3)
+	{
+	case 0:
 		nextLoadValue = value;
 		break;
-
-	case OP_LUI:
-		DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
-		registers[instr->rt] = instr->extra << 16;
+	case 1:
+		nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
+		break;
+	case 2:
+		nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
 		break;
+	case 3:
+		nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
+		break;
+	}
+	ctx->loadReg = instr->rt;
+	ctx->loadValue = nextLoadValue;
+	return TRUE;
+}
 
-	case OP_LW:
-		tmp = registers[instr->rs] + instr->extra;
-		if (tmp & 0x3)
-		{
-			RaiseException(AddressErrorException, tmp);
-			return;
-		}
-		if (!machine->ReadMem(tmp, 4, &value))
-			return;
-		nextLoadReg = instr->rt;
+static bool
+ExecLWR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value, nextLoadValue;
+
+	// ReadMem assumes all 4 byte requests are aligned on an even
+	// word boundary.  Also, the little endian/big endian swap code would
+	// fail (I think) if the other cases are ever exercised.
+	ASSERT((tmp & 0x3) == 0);
+
+	if (!m->ReadMem(tmp, 4, &value))
+		return FALSE;
+	if (registers[LoadReg] == instr->rt)
+		nextLoadValue = registers[LoadValueReg];
+	else
+		nextLoadValue = registers[instr->rt];
+	switch (tmp & 0x3)
+	{
+	case 0:
+		nextLoadValue = (nextLoadValue & 0xffffff00) |
+						((value >> 24) & 0xff);
+		break;
+	case 1:
+		nextLoadValue = (nextLoadValue & 0xffff0000) |
+						((value >> 16) & 0xffff);
+		break;
+	case 2:
+		nextLoadValue = (nextLoadValue & 0xff000000) | ((value >> 8) & 0xffffff);
+		break;
+	case 3:
 		nextLoadValue = value;
 		break;
+	}
+	ctx->loadReg = instr->rt;
+	ctx->loadValue = nextLoadValue;
+	return TRUE;
+}
 
-	case OP_LWL:
-		tmp = registers[instr->rs] + instr->extra;
+static bool
+ExecMFHI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[HiReg];
+	return TRUE;
+}
 
-		// ReadMem assumes all 4 byte requests are aligned on an even
-		// word boundary.  Also, the little endian/big endian swap code would
-		// fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);
+static bool
+ExecMFLO(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[LoReg];
+	return TRUE;
+}
 
-		if (!machine->ReadMem(tmp, 4, &value))
-			return;
-		if (registers[LoadReg] == instr->rt)
-			nextLoadValue = registers[LoadValueReg];
-		else
-			nextLoadValue = registers[instr->rt];
-		switch (tmp & 0x3)
-		{
-		case 0:
-			nextLoadValue = value;
-			break;
-		case 1:
-			nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
-			break;
-		case 2:
-			nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
-			break;
-		case 3:
-			nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
-			break;
-		}
-		nextLoadReg = instr->rt;
-		break;
+static bool
+ExecMTHI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[HiReg] = m->registers[instr->rs];
+	return TRUE;
+}
 
-	case OP_LWR:
-		tmp = registers[instr->rs] + instr->extra;
+static bool
+ExecMTLO(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[LoReg] = m->registers[instr->rs];
+	return TRUE;
+}
 
-		// ReadMem assumes all 4 byte requests are aligned on an even
-		// word boundary.  Also, the little endian/big endian swap code would
-		// fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);
+static bool
+ExecMULT(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	Mult(registers[instr->rs], registers[instr->rt], TRUE,
+		 &registers[HiReg], &registers[LoReg]);
+	return TRUE;
+}
 
-		if (!machine->ReadMem(tmp, 4, &value))
-			return;
-		if (registers[LoadReg] == instr->rt)
-			nextLoadValue = registers[LoadValueReg];
-		else
-			nextLoadValue = registers[instr->rt];
-		switch (tmp & 0x3)
-		{
-		case 0:
-			nextLoadValue = (nextLoadValue & 0xffffff00) |
-							((value >> 24) & 0xff);
-			break;
-		case 1:
-			nextLoadValue = (nextLoadValue & 0xffff0000) |
-							((value >> 16) & 0xffff);
-			break;
-		case 2:
-			nextLoadValue = (nextLoadValue & 0xff000000) | ((value >> 8) & 0xffffff);
-			break;
-		case 3:
-			nextLoadValue = value;
-			break;
-		}
-		nextLoadReg = instr->rt;
-		break;
+static bool
+ExecMULTU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	Mult(registers[instr->rs], registers[instr->rt], FALSE,
+		 &registers[HiReg], &registers[LoReg]);
+	return TRUE;
+}
 
-	case OP_MFHI:
-		registers[instr->rd] = registers[HiReg];
-		break;
+static bool
+ExecNOR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = ~(m->registers[instr->rs] | m->registers[instr->rt]);
+	return TRUE;
+}
 
-	case OP_MFLO:
-		registers[instr->rd] = registers[LoReg];
-		break;
+static bool
+ExecOR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rs] | m->registers[instr->rs];
+	return TRUE;
+}
 
-	case OP_MTHI:
-		registers[HiReg] = registers[instr->rs];
-		break;
+static bool
+ExecORI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rt] = m->registers[instr->rs] | (instr->extra & 0xffff);
+	return TRUE;
+}
 
-	case OP_MTLO:
-		registers[LoReg] = registers[instr->rs];
-		break;
+static bool
+ExecSB(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	return m->WriteMem((unsigned)(m->registers[instr->rs] + instr->extra), 1,
+					   m->registers[instr->rt]);
+}
 
-	case OP_MULT:
-		Mult(registers[instr->rs], registers[instr->rt], TRUE,
-			 &registers[HiReg], &registers[LoReg]);
-		break;
+static bool
+ExecSC(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rs] + instr->extra;
+	int physAddr;
+	ExceptionType exception = m->Translate(tmp, &physAddr, 4, FALSE);
+	if (exception != NoException)
+	{
+		m->RaiseException(exception, tmp);
+		return FALSE;
+	}
+	if (physAddr != m->llAddress)
+	{ // lost the reservation: don't store
+		m->registers[instr->rt] = 0;
+		return TRUE;
+	}
+	if (!m->WriteMem(tmp, 4, m->registers[instr->rt]))
+		return FALSE; // read-only; the reservation is gone on retry
+	m->llAddress = -1;
+	m->registers[instr->rt] = 1;
+	return TRUE;
+}
 
-	case OP_MULTU:
-		Mult(registers[instr->rs], registers[instr->rt], FALSE,
-			 &registers[HiReg], &registers[LoReg]);
-		break;
+static bool
+ExecSH(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	return m->WriteMem((unsigned)(m->registers[instr->rs] + instr->extra), 2,
+					   m->registers[instr->rt]);
+}
 
-	case OP_NOR:
-		registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
-		break;
+static bool
+ExecSLL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rt] << instr->extra;
+	return TRUE;
+}
 
-	case OP_OR:
-		registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
-		break;
+static bool
+ExecSLLV(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rt] << (m->registers[instr->rs] & 0x1f);
+	return TRUE;
+}
 
-	case OP_ORI:
-		registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
-		break;
+static bool
+ExecSLT(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] < m->registers[instr->rt])
+		m->registers[instr->rd] = 1;
+	else
+		m->registers[instr->rd] = 0;
+	return TRUE;
+}
 
-	case OP_SB:
-		if (!machine->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-			return;
-		break;
+static bool
+ExecSLTI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	if (m->registers[instr->rs] < instr->extra)
+		m->registers[instr->rt] = 1;
+	else
+		m->registers[instr->rt] = 0;
+	return TRUE;
+}
 
-	case OP_SH:
-		if (!machine->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-			return;
-		break;
+static bool
+ExecSLTIU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	unsigned int rs = m->registers[instr->rs];
+	unsigned int imm = instr->extra;
+	if (rs < imm)
+		m->registers[instr->rt] = 1;
+	else
+		m->registers[instr->rt] = 0;
+	return TRUE;
+}
 
-	case OP_SLL:
-		registers[instr->rd] = registers[instr->rt] << instr->extra;
-		break;
+static bool
+ExecSLTU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	unsigned int rs = m->registers[instr->rs];
+	unsigned int rt = m->registers[instr->rt];
+	if (rs < rt)
+		m->registers[instr->rd] = 1;
+	else
+		m->registers[instr->rd] = 0;
+	return TRUE;
+}
 
-	case OP_SLLV:
-		registers[instr->rd] = registers[instr->rt] << (registers[instr->rs] & 0x1f);
-		break;
+static bool
+ExecSRA(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rt] >> instr->extra;
+	return TRUE;
+}
 
-	case OP_SLT:
-		if (registers[instr->rs] < registers[instr->rt])
-			registers[instr->rd] = 1;
-		else
-			registers[instr->rd] = 0;
-		break;
+static bool
+ExecSRAV(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rt] >>
+							  (m->registers[instr->rs] & 0x1f);
+	return TRUE;
+}
 
-	case OP_SLTI:
-		if (registers[instr->rs] < instr->extra)
-			registers[instr->rt] = 1;
-		else
-			registers[instr->rt] = 0;
-		break;
+static bool
+ExecSRL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rt];
+	tmp >>= instr->extra;
+	m->registers[instr->rd] = tmp;
+	return TRUE;
+}
 
-	case OP_SLTIU:
-		rs = registers[instr->rs];
-		imm = instr->extra;
-		if (rs < imm)
-			registers[instr->rt] = 1;
-		else
-			registers[instr->rt] = 0;
-		break;
+static bool
+ExecSRLV(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int tmp = m->registers[instr->rt];
+	tmp >>= (m->registers[instr->rs] & 0x1f);
+	m->registers[instr->rd] = tmp;
+	return TRUE;
+}
 
-	case OP_SLTU:
-		rs = registers[instr->rs];
-		rt = registers[instr->rt];
-		if (rs < rt)
-			registers[instr->rd] = 1;
-		else
-			registers[instr->rd] = 0;
-		break;
+static bool
+ExecSUB(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	int diff = registers[instr->rs] - registers[instr->rt];
+	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+		((registers[instr->rs] ^ diff) & SIGN_BIT))
+	{
+		m->RaiseException(OverflowException, 0);
+		return FALSE;
+	}
+	registers[instr->rd] = diff;
+	return TRUE;
+}
 
-	case OP_SRA:
-		registers[instr->rd] = registers[instr->rt] >> instr->extra;
-		break;
+static bool
+ExecSUBU(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rs] - m->registers[instr->rt];
+	return TRUE;
+}
 
-	case OP_SRAV:
-		registers[instr->rd] = registers[instr->rt] >>
-							   (registers[instr->rs] & 0x1f);
-		break;
+static bool
+ExecSW(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	return m->WriteMem((unsigned)(m->registers[instr->rs] + instr->extra), 4,
+					   m->registers[instr->rt]);
+}
 
-	case OP_SRL:
-		tmp = registers[instr->rt];
-		tmp >>= instr->extra;
-		registers[instr->rd] = tmp;
-		break;
+static bool
+ExecSWL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
 
-	case OP_SRLV:
-		tmp = registers[instr->rt];
-		tmp >>= (registers[instr->rs] & 0x1f);
-		registers[instr->rd] = tmp;
-		break;
+	// The little endian/big endian swap code would
+	// fail (I think) if the other cases are ever exercised.
+	ASSERT((tmp & 0x3) == 0);
 
-	case OP_SUB:
-		diff = registers[instr->rs] - registers[instr->rt];
-		if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-			((registers[instr->rs] ^ diff) & SIGN_BIT))
-		{
-			RaiseException(OverflowException, 0);
-			return;
-		}
-		registers[instr->rd] = diff;
+	if (!m->ReadMem((tmp & ~0x3), 4, &value))
+		return FALSE;
+	switch (tmp & 0x3)
+	{
+	case 0:
+		value = registers[instr->rt];
 		break;
-
-	case OP_SUBU:
-		registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+	case 1:
+		value = (value & 0xff000000) | ((registers[instr->rt] >> 8) &
+										0xffffff);
 		break;
-
-	case OP_SW:
-		if (!machine->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-			return;
+	case 2:
+		value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) &
+										0xffff);
 		break;
+	case 3:
+		value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) &
+										0xff);
+		break;
+	}
+	return m->WriteMem((tmp & ~0x3), 4, value);
+}
 
-	case OP_SWL:
-		tmp = registers[instr->rs] + instr->extra;
+static bool
+ExecSWR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
 
-		// The little endian/big endian swap code would
-		// fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);
+	// The little endian/big endian swap code would
+	// fail (I think) if the other cases are ever exercised.
+	ASSERT((tmp & 0x3) == 0);
 
-		if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-			return;
-		switch (tmp & 0x3)
-		{
-		case 0:
-			value = registers[instr->rt];
-			break;
-		case 1:
-			value = (value & 0xff000000) | ((registers[instr->rt] >> 8) &
-											0xffffff);
-			break;
-		case 2:
-			value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) &
-											0xffff);
-			break;
-		case 3:
-			value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) &
-											0xff);
-			break;
-		}
-		if (!machine->WriteMem((tmp & ~0x3), 4, value))
-			return;
+	if (!m->ReadMem((tmp & ~0x3), 4, &value))
+		return FALSE;
+	switch (tmp & 0x3)
+	{
+	case 0:
+		value = (value & 0xffffff) | (registers[instr->rt] << 24);
+		break;
+	case 1:
+		value = (value & 0xffff) | (registers[instr->rt] << 16);
 		break;
+	case 2:
+		value = (value & 0xff) | (registers[instr->rt] << 8);
+		break;
+	case 3:
+		value = registers[instr->rt];
+		break;
+	}
+	return m->WriteMem((tmp & ~0x3), 4, value);
+}
 
-	case OP_SWR:
-		tmp = registers[instr->rs] + instr->extra;
+static bool
+ExecSYSCALL(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->RaiseException(SyscallException, 0);
+	return FALSE;
+}
 
-		// The little endian/big endian swap code would
-		// fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);
+static bool
+ExecXOR(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rd] = m->registers[instr->rs] ^ m->registers[instr->rt];
+	return TRUE;
+}
 
-		if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-			return;
-		switch (tmp & 0x3)
-		{
-		case 0:
-			value = (value & 0xffffff) | (registers[instr->rt] << 24);
-			break;
-		case 1:
-			value = (value & 0xffff) | (registers[instr->rt] << 16);
-			break;
-		case 2:
-			value = (value & 0xff) | (registers[instr->rt] << 8);
-			break;
-		case 3:
-			value = registers[instr->rt];
-			break;
-		}
-		if (!machine->WriteMem((tmp & ~0x3), 4, value))
-			return;
-		break;
+static bool
+ExecXORI(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	m->registers[instr->rt] = m->registers[instr->rs] ^ (instr->extra & 0xffff);
+	return TRUE;
+}
 
-	case OP_SYSCALL:
-		RaiseException(SyscallException, 0);
-		return;
+static bool
+ExecUNIMP(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	printf("Error in line 559 mipssim.cc: R-type instruction not supported.\n");
+	m->RaiseException(IllegalInstrException, 0);
+	return FALSE;
+}
 
-	case OP_XOR:
-		registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
-		break;
+static bool
+ExecBad(Machine *m, Instruction *instr, OpContext *ctx)
+{
+	ASSERT(FALSE);
+	return FALSE;
+}
 
-	case OP_XORI:
-		registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
-		break;
+// Indexed by opCode; unused opcodes (and RFE, which we don't simulate)
+// map to ExecBad.
+static OpHandler opHandlers[MaxOpcode + 1] = {
+	ExecBad, ExecADD, ExecADDI, ExecADDIU, ExecADDU, ExecAND, ExecANDI,
+	ExecBEQ, ExecBGEZ, ExecBGEZAL, ExecBGTZ, ExecBLEZ, ExecBLTZ,
+	ExecBLTZAL, ExecBNE, ExecLL, ExecDIV, ExecDIVU, ExecJ, ExecJAL,
+	ExecJALR, ExecJR, ExecLB, ExecLB, ExecLH, ExecLH, ExecLUI, ExecLW,
+	ExecLWL, ExecLWR, ExecSC, ExecMFHI, ExecMFLO, ExecBad, ExecMTHI,
+	ExecMTLO, ExecMULT, ExecMULTU, ExecNOR, ExecOR, ExecORI, ExecBad,
+	ExecSB, ExecSH, ExecSLL, ExecSLLV, ExecSLT, ExecSLTI, ExecSLTIU,
+	ExecSLTU, ExecSRA, ExecSRAV, ExecSRL, ExecSRLV, ExecSUB, ExecSUBU,
+	ExecSW, ExecSWL, ExecSWR, ExecXOR, ExecXORI, ExecSYSCALL, ExecUNIMP,
+	ExecUNIMP};
 
-	case OP_RES:
-	case OP_UNIMP:
-		printf("Error in line 559 mipssim.cc: R-type instruction not supported.\n");
-		RaiseException(IllegalInstrException, 0);
-		return;
+//----------------------------------------------------------------------
+// Machine::OneInstruction
+// 	Execute one instruction from a user-level program
+//
+// 	If there is any kind of exception or interrupt, we invoke the
+//	exception handler, and when it returns, we return to Run(), which
+//	will re-invoke us in a loop.  This allows us to
+//	re-start the instruction execution from the beginning, in
+//	case any of our state has changed.  On a syscall,
+// 	the OS software must increment the PC so execution begins
+// 	at the instruction immediately after the syscall.
+//
+//	This routine is re-entrant, in that it can be called multiple
+//	times concurrently -- one for each thread executing user code.
+//	We get re-entrancy by never caching any data -- we always re-start the
+//	simulation from scratch each time we are called (or after trapping
+//	back to the Nachos kernel on an exception or interrupt), and we always
+//	store all data back to the machine registers and memory before
+//	leaving.  This allows the Nachos kernel to control our behavior
+//	by controlling the contents of memory, the translation table,
+//	and the register set.
+//----------------------------------------------------------------------
 
-	default:
-		ASSERT(FALSE);
+void Machine::OneInstruction(Instruction *instr)
+{
+	int raw;
+
+	// Fetch instruction
+	if (decodeCache != NULL)
+	{
+		instr = FetchDecoded(registers[PCReg]);
+		if (instr == NULL)
+			return; // exception occurred
+	}
+	else
+	{
+		if (!machine->ReadMem(registers[PCReg], 4, &raw))
+			return; // exception occurred
+		instr->value = raw;
+		instr->Decode();
+	}
+
+	if (DebugIsEnabled('m'))
+	{
+		struct OpString *str = &opStrings[instr->opCode];
+
+		ASSERT(instr->opCode <= MaxOpcode);
+		printf("At PC = 0x%x: ", registers[PCReg]);
+		printf(str->string, TypeToReg(str->args[0], instr),
+			   TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
+		printf("\n");
 	}
 
+	// Compute next pc, but don't install in case there's an error or branch.
+	// Also record any delayed load operation, to apply in the future.
+	OpContext ctx;
+	ctx.nextPC = registers[NextPCReg];
+	ctx.pcAfter = registers[NextPCReg] + 4;
+	ctx.loadReg = 0;
+	ctx.loadValue = 0;
+
+	// Execute the instruction
+	ASSERT(instr->opCode <= MaxOpcode);
+	if (!(*opHandlers[(int)instr->opCode])(this, instr, &ctx))
+		return; // exception occurred
+
 	// Now we have successfully executed the instruction.
 
 	// Do any delayed load operation
-	DelayedLoad(nextLoadReg, nextLoadValue);
+	DelayedLoad(ctx.loadReg, ctx.loadValue);
 
 	// Advance program counters.
 	registers[PrevPCReg] = registers[PCReg]; // for debugging, in case we
 											 // are jumping into lala-land
 	registers[PCReg] = registers[NextPCReg];
-	registers[NextPCReg] = pcAfter;
+	registers[NextPCReg] = ctx.pcAfter;
+}
+
+//----------------------------------------------------------------------
+// TranslatedBlock::TranslatedBlock, ~TranslatedBlock
+// 	Allocate and de-allocate room for a block of "length" instructions,
+//	built while its page was at "epoch".
+//----------------------------------------------------------------------
+
+TranslatedBlock::TranslatedBlock(int len, unsigned int ep)
+{
+	length = len;
+	epoch = ep;
+	ops = new BlockOp[len];
+}
+
+TranslatedBlock::~TranslatedBlock()
+{
+	delete[] ops;
+}
+
+//----------------------------------------------------------------------
+// IsControlTransfer
+// 	Is "opCode" a branch or jump, i.e. followed by a delay slot?
+//----------------------------------------------------------------------
+
+static bool
+IsControlTransfer(int opCode)
+{
+	switch (opCode)
+	{
+	case OP_BEQ:
+	case OP_BGEZ:
+	case OP_BGEZAL:
+	case OP_BGTZ:
+	case OP_BLEZ:
+	case OP_BLTZ:
+	case OP_BLTZAL:
+	case OP_BNE:
+	case OP_J:
+	case OP_JAL:
+	case OP_JALR:
+	case OP_JR:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+//----------------------------------------------------------------------
+// InitBlockOp
+// 	Fill in one entry of a translated block from its decoded
+//	instruction.
+//----------------------------------------------------------------------
+
+static void
+InitBlockOp(BlockOp *op, Instruction *instr)
+{
+	op->instr = *instr;
+	op->handler = opHandlers[(int)instr->opCode];
+	op->isStore = FALSE;
+	op->mayTrap = FALSE;
+	switch (instr->opCode)
+	{
+	case OP_SB:
+	case OP_SH:
+	case OP_SW:
+	case OP_SWL:
+	case OP_SWR:
+	case OP_SC:
+		op->isStore = TRUE;
+		op->mayTrap = TRUE;
+		break;
+	case OP_ADD:
+	case OP_ADDI:
+	case OP_SUB:
+	case OP_LB:
+	case OP_LBU:
+	case OP_LH:
+	case OP_LHU:
+	case OP_LW:
+	case OP_LWL:
+	case OP_LWR:
+	case OP_LL:
+	case OP_SYSCALL:
+	case OP_UNIMP:
+	case OP_RES:
+		op->mayTrap = TRUE;
+		break;
+	}
+}
+
+//----------------------------------------------------------------------
+// Machine::TranslateBlock
+// 	Decode the basic block starting at physical address "physAddr".
+//	The block stops at the first branch or jump (taking its delay slot
+//	along), at the first instruction that always traps, or at the end
+//	of the page, so that it can be fetched with a single translation.
+//	A syscall always starts a block of its own, so that the time seen
+//	by the kernel during the call is the same as when single-stepping.
+//
+//	A branch whose delay slot lies on the next page, or holds another
+//	branch, is left out of the block for OneInstruction to execute.
+//	Returns NULL if that leaves the block empty.
+//----------------------------------------------------------------------
+
+TranslatedBlock *
+Machine::TranslateBlock(int physAddr)
+{
+	Instruction instrs[InstrsPerPage];
+	int page = physAddr / PageSize;
+	int end = (page + 1) * PageSize;
+	int length = 0;
+
+	for (int addr = physAddr; addr < end; addr += 4)
+	{
+		Instruction *instr = &instrs[length];
+		instr->value = WordToHost(*(unsigned int *)&mainMemory[addr]);
+		instr->Decode();
+		if (instr->opCode == OP_RFE || opHandlers[(int)instr->opCode] == ExecBad)
+			break; // leave it to OneInstruction to complain
+		if (instr->opCode == OP_SYSCALL && length > 0)
+			break; // charge the clock before the kernel looks at it
+
+		if (IsControlTransfer(instr->opCode))
+		{
+			if (addr + 4 >= end)
+				break;
+			Instruction *slot = &instrs[length + 1];
+			slot->value = WordToHost(*(unsigned int *)&mainMemory[addr + 4]);
+			slot->Decode();
+			if (IsControlTransfer(slot->opCode) || slot->opCode == OP_RFE ||
+				opHandlers[(int)slot->opCode] == ExecBad)
+				break;
+			length += 2;
+			break;
+		}
+
+		length++;
+		if (instr->opCode == OP_SYSCALL || instr->opCode == OP_UNIMP ||
+			instr->opCode == OP_RES)
+			break;
+	}
+	if (length == 0)
+		return NULL;
+
+	TranslatedBlock *block = new TranslatedBlock(length, pageEpoch[page]);
+	for (int i = 0; i < length; i++)
+		InitBlockOp(&block->ops[i], &instrs[i]);
+	stats->numBlocksTranslated++;
+	return block;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Run the translated basic block at the current PC, and return the
+//	number of instructions executed, for Run to charge to the clock.
+//
+//	Registers, memory, delayed loads and branch delay slots end up
+//	exactly as if OneInstruction had run each instruction in turn;
+//	only pending interrupts are checked less often (at the end of the
+//	block instead of after every instruction).
+//
+//	Returns 0 if there is no block to run here -- the PC is in a
+//	delay slot, the fetch would fault, or no block can be built --
+//	in which case the caller falls back on OneInstruction.
+//----------------------------------------------------------------------
+
+int
+Machine::RunBlock()
+{
+	int pc = registers[PCReg];
+	int nextPC = registers[NextPCReg];
+	int prevPC = registers[PrevPCReg];
+	int physAddr;
+
+	if (nextPC != pc + 4) // in a delay slot
+		return 0;
+	if (Translate(pc, &physAddr, 4, FALSE) != NoException)
+		return 0;
+
+	int index = physAddr / 4;
+	int page = physAddr / PageSize;
+	TranslatedBlock *block = blockTable[index];
+	if (block == NULL || block->epoch != pageEpoch[page])
+	{ // never built, or the page has been written since
+		delete block;
+		block = blockTable[index] = TranslateBlock(physAddr);
+		if (block == NULL)
+			return 0;
+	}
+
+	OpContext ctx;
+	int count = 0;
+	while (count < block->length)
+	{
+		BlockOp *op = &block->ops[count++];
+
+		if (op->mayTrap)
+		{ // make the PC visible to the exception handler
+			registers[PrevPCReg] = prevPC;
+			registers[PCReg] = pc;
+			registers[NextPCReg] = nextPC;
+		}
+		ctx.nextPC = nextPC;
+		ctx.pcAfter = nextPC + 4;
+		ctx.loadReg = 0;
+		ctx.loadValue = 0;
+		if (!(*op->handler)(this, &op->instr, &ctx))
+		{ // trapped; the kernel has set up the registers, and may have
+		  // replaced this very block, so don't look at it again
+			stats->numBlockRuns++;
+			stats->numBlockInstrs += count;
+			return count;
+		}
+		DelayedLoad(ctx.loadReg, ctx.loadValue);
+		prevPC = pc;
+		pc = nextPC;
+		nextPC = ctx.pcAfter;
+
+		if (op->isStore && block->epoch != pageEpoch[page])
+			break; // self-modifying code: refetch from here
+	}
+
+	registers[PrevPCReg] = prevPC;
+	registers[PCReg] = pc;
+	registers[NextPCReg] = nextPC;
+	stats->numBlockRuns++;
+	stats->numBlockInstrs += count;
+	return count;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchDecoded
+// 	Return the decoded form of the instruction at "virtAddr".
+//
+//	Decoded instructions are kept per physical page, so a page shared
+//	by several threads is only decoded once.  An entry is decoded the
+//	first time it is fetched, and re-decoded after any store to its
+//	word (see WriteMem) or after the kernel reloads the page (see
+//	InvalidateDecoded).
+//
+//	Returns NULL if the translation failed; the exception has already
+//	been raised in that case, just as ReadMem does.
+//
+//	"virtAddr" -- the virtual address of the instruction (the PC)
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchDecoded(int virtAddr)
+{
+	int physAddr;
+	ExceptionType exception = Translate(virtAddr, &physAddr, 4, FALSE);
+
+	if (exception != NoException)
+	{
+		RaiseException(exception, virtAddr);
+		return NULL;
+	}
+
+	int index = physAddr / 4;
+	Instruction *instr = &decodeCache[index];
+	if (decodeValid[index])
+	{
+		stats->numDecodeHits++;
+		return instr;
+	}
+
+	stats->numDecodeMisses++;
+	instr->value = WordToHost(*(unsigned int *)&mainMemory[physAddr]);
+	instr->Decode();
+	decodeValid[index] = TRUE;
+	return instr;
 }
 
 //----------------------------------------------------------------------
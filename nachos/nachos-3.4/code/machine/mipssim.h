@@ -36,7 +36,7 @@
 #define OP_BLTZ		12
 #define OP_BLTZAL	13
 #define OP_BNE		14
-
+#define OP_LL		15
 #define OP_DIV		16
 #define OP_DIVU		17
 #define OP_J		18
@@ -51,7 +51,7 @@
 #define OP_LW		27
 #define OP_LWL		28
 #define OP_LWR		29
-
+#define OP_SC		30
 #define OP_MFHI		31
 #define OP_MFLO		32
 
@@ -127,9 +127,9 @@ static OpInfo opTable[] = {
     {OP_LBU, IFMT}, {OP_LHU, IFMT}, {OP_LWR, IFMT}, {OP_RES, IFMT},
     {OP_SB, IFMT}, {OP_SH, IFMT}, {OP_SWL, IFMT}, {OP_SW, IFMT},
     {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_SWR, IFMT}, {OP_RES, IFMT},
-    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_LL, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
     {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
-    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_SC, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
     {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}
 };
 
@@ -175,7 +175,7 @@ static struct OpString opStrings[] = {
 	{"BLTZ r%d,%d", {RS, EXTRA, NONE}},
 	{"BLTZAL r%d,%d", {RS, EXTRA, NONE}},
 	{"BNE r%d,r%d,%d", {RS, RT, EXTRA}},
-	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"LL r%d,%d(r%d)", {RT, EXTRA, RS}},
 	{"DIV r%d,r%d", {RS, RT, NONE}},
 	{"DIVU r%d,r%d", {RS, RT, NONE}},
 	{"J %d", {EXTRA, NONE, NONE}},
@@ -190,7 +190,7 @@ static struct OpString opStrings[] = {
 	{"LW r%d,%d(r%d)", {RT, EXTRA, RS}},
 	{"LWL r%d,%d(r%d)", {RT, EXTRA, RS}},
 	{"LWR r%d,%d(r%d)", {RT, EXTRA, RS}},
-	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"SC r%d,%d(r%d)", {RT, EXTRA, RS}},
 	{"MFHI r%d", {RD, NONE, NONE}},
 	{"MFLO r%d", {RD, NONE, NONE}},
 	{"Shouldn't happen", {NONE, NONE, NONE}},
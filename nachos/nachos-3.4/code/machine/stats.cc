@@ -20,8 +20,21 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = numCacheWritebacks = 0;
+    numReadAheads = 0;
+    numDiskRequests = diskSeekTracks = diskWaitTicks = 0;
+    diskPolicy = NULL;
+    numNameHits = numNameMisses = 0;
+    numJournalCommits = numJournalSectors = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageWritebacks = 0;
+    pagingPolicy = NULL;
+    numDecodeHits = numDecodeMisses = 0;
+    numBlocksTranslated = numBlockRuns = numBlockInstrs = 0;
+    numXlateHits = numXlateMisses = 0;
+    numTLBHits = numTLBMisses = 0;
+    hostStartTime = HostTime();
 }
 
 //----------------------------------------------------------------------
@@ -35,9 +48,53 @@ void Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks,
            idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numCacheHits + numCacheMisses > 0)
+        printf("Buffer cache: hits %d, misses %d, writebacks %d, "
+               "read-ahead %d, hit rate %.2f%%\n", numCacheHits,
+               numCacheMisses, numCacheWritebacks, numReadAheads,
+               100.0 * numCacheHits / (numCacheHits + numCacheMisses));
+    if (numNameHits + numNameMisses > 0)
+        printf("Name cache: hits %d, misses %d, hit rate %.2f%%\n",
+               numNameHits, numNameMisses,
+               100.0 * numNameHits / (numNameHits + numNameMisses));
+    if (numJournalCommits > 0)
+        printf("Journal: %d commits, %d sectors, %.2f sectors per commit\n",
+               numJournalCommits, numJournalSectors,
+               (double)numJournalSectors / numJournalCommits);
+    if (numDiskRequests > 0)
+        printf("Disk scheduling (%s): %d requests, average seek %.2f tracks, "
+               "average latency %.1f ticks\n", diskPolicy, numDiskRequests,
+               (double)diskSeekTracks / numDiskRequests,
+               (double)diskWaitTicks / numDiskRequests);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead,
            numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    if (pagingPolicy != NULL)
+        printf("Paging: faults %d, writebacks %d (%s replacement)\n",
+               numPageFaults, numPageWritebacks, pagingPolicy);
+    else
+        printf("Paging: faults %d\n", numPageFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd,
            numPacketsSent);
+    if (numDecodeHits + numDecodeMisses > 0)
+        printf("Decode cache: hits %d, misses %d, hit rate %.2f%%\n",
+               numDecodeHits, numDecodeMisses,
+               100.0 * numDecodeHits / (numDecodeHits + numDecodeMisses));
+    if (numBlockRuns > 0)
+        printf("Block engine: %d blocks translated, %d runs, "
+               "%.2f instructions/run\n", numBlocksTranslated, numBlockRuns,
+               (double)numBlockInstrs / numBlockRuns);
+    if (numXlateHits + numXlateMisses > 0)
+        printf("Translation cache: hits %d, misses %d, hit rate %.2f%%\n",
+               numXlateHits, numXlateMisses,
+               100.0 * numXlateHits / (numXlateHits + numXlateMisses));
+
+    if (numTLBHits + numTLBMisses > 0)
+        printf("TLB: hits %d, misses %d, hit rate %.2f%%\n",
+               numTLBHits, numTLBMisses,
+               100.0 * numTLBHits / (numTLBHits + numTLBMisses));
+
+    double hostSeconds = HostTime() - hostStartTime;
+    if (userTicks > 0 && hostSeconds > 0)
+        printf("Host time: %.3f seconds, %.0f user instructions/second\n",
+               hostSeconds, userTicks / UserTick / hostSeconds);
 }
@@ -30,11 +30,35 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numCacheHits;		// sectors found in the buffer cache
+    int numCacheMisses;		// sectors the buffer cache had to load
+    int numCacheWritebacks;	// dirty sectors written back to disk
+    int numReadAheads;		// sectors read ahead into the cache
+    int numDiskRequests;	// requests made of the disk scheduler
+    int diskSeekTracks;		// tracks the disk head moved, in all
+    int diskWaitTicks;		// time from request to completion, in all
+    const char *diskPolicy;	// disk scheduling policy, or NULL
+    int numNameHits;		// file names found in the name cache
+    int numNameMisses;		// file names looked up in directories
+    int numJournalCommits;	// metadata transactions committed
+    int numJournalSectors;	// sectors written into the journal
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageWritebacks;	// number of evicted pages written to swap
+    const char *pagingPolicy;	// page replacement policy, or NULL
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numDecodeHits;		// instruction fetches served predecoded
+    int numDecodeMisses;	// instruction fetches that had to decode
+    int numBlocksTranslated;	// basic blocks built by the block engine
+    int numBlockRuns;		// basic blocks executed
+    int numBlockInstrs;		// user instructions executed within blocks
+    int numXlateHits;		// translations served by the translation cache
+    int numXlateMisses;		// translations that walked the page table/TLB
+    int numTLBHits;		// translations found in the TLB
+    int numTLBMisses;		// translations the kernel had to load
+    double hostStartTime;	// host time (seconds) when Nachos started
 
     Statistics(); 		// initialize everything to zero
 
@@ -461,6 +461,21 @@ Random()
     return rand();
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the current wall-clock time of the host, in seconds.
+//	Only differences between two calls are meaningful.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // AllocBoundedArray
 // 	Return an array, with the two pages just before 
@@ -50,6 +50,10 @@ extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 extern void RandomInit(unsigned seed);
 extern int Random();
 
+// Wall-clock time of the host, in seconds, for measuring how fast
+// the simulation itself runs
+extern double HostTime();
+
 // Allocate, de-allocate an array, such that de-referencing
 // just beyond either end of the array will cause an error
 extern char *AllocBoundedArray(int size);
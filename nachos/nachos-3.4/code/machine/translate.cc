@@ -72,6 +72,99 @@ WordToMachine(unsigned int word) { return WordToHost(word); }
 unsigned short
 ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
+//----------------------------------------------------------------------
+// LoadHost, StoreHost
+// 	Read or write "size" (1, 2, or 4) bytes of simulated memory at
+//	host address "hostAddr", converting to or from the simulated
+//	machine's byte order.
+//----------------------------------------------------------------------
+
+static inline int
+LoadHost(char *hostAddr, int size)
+{
+	switch (size)
+	{
+	case 1:
+		return *hostAddr;
+
+	case 2:
+		return ShortToHost(*(unsigned short *)hostAddr);
+
+	case 4:
+		return WordToHost(*(unsigned int *)hostAddr);
+
+	default:
+		ASSERT(FALSE);
+		return 0;
+	}
+}
+
+static inline void
+StoreHost(char *hostAddr, int size, int value)
+{
+	switch (size)
+	{
+	case 1:
+		*hostAddr = (unsigned char)(value & 0xff);
+		break;
+
+	case 2:
+		*(unsigned short *)hostAddr = ShortToMachine((unsigned short)(value & 0xffff));
+		break;
+
+	case 4:
+		*(unsigned int *)hostAddr = WordToMachine((unsigned int)value);
+		break;
+
+	default:
+		ASSERT(FALSE);
+	}
+}
+
+//----------------------------------------------------------------------
+// Machine::CachedAddress
+// 	The fast path of address translation.  If the page of "virtAddr"
+//	is in the translation cache, and the access is aligned (and, when
+//	"writing", the page is already known to be writable and dirty),
+//	return the host address of the data in "mainMemory".  Otherwise
+//	return NULL, and the caller must go through Translate.
+//
+//	Hits skip setting the use and dirty bits, which is fine because
+//	Translate set them when it filled the entry, and the kernel flushes
+//	the cache whenever it changes the page table.
+//----------------------------------------------------------------------
+
+inline char *
+Machine::CachedAddress(int virtAddr, int size, bool writing)
+{
+	if (xlateCache == NULL)
+		return NULL;
+
+	unsigned int vpn = (unsigned)virtAddr / PageSize;
+	CachedTranslation *cached = &xlateCache[vpn % TranslationCacheSize];
+
+	if (cached->vpn != vpn || (virtAddr & (size - 1)) ||
+		(writing && !cached->writable))
+		return NULL;
+	stats->numXlateHits++;
+	return cached->page + (unsigned)virtAddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslationCache
+// 	Forget every cached translation.  Called whenever the page table
+//	(or TLB) changes: on a context switch, or when the kernel changes
+//	an entry or clears its use or dirty bit.
+//----------------------------------------------------------------------
+
+void Machine::FlushTranslationCache()
+{
+	if (xlateCache == NULL)
+		return;
+	for (int i = 0; i < TranslationCacheSize; i++)
+		xlateCache[i].vpn = NoCachedPage;
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into
@@ -87,9 +180,15 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
 bool Machine::ReadMem(int addr, int size, int *value)
 {
-	int data;
 	ExceptionType exception;
 	int physicalAddress;
+	char *hostAddr = CachedAddress(addr, size, FALSE);
+
+	if (hostAddr != NULL)
+	{ // no tracing here: the cache is off when debugging with 'a'
+		*value = LoadHost(hostAddr, size);
+		return TRUE;
+	}
 
 	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
 
@@ -99,26 +198,7 @@ bool Machine::ReadMem(int addr, int size, int *value)
 		machine->RaiseException(exception, addr);
 		return FALSE;
 	}
-	switch (size)
-	{
-	case 1:
-		data = machine->mainMemory[physicalAddress];
-		*value = data;
-		break;
-
-	case 2:
-		data = *(unsigned short *)&machine->mainMemory[physicalAddress];
-		*value = ShortToHost(data);
-		break;
-
-	case 4:
-		data = *(unsigned int *)&machine->mainMemory[physicalAddress];
-		*value = WordToHost(data);
-		break;
-
-	default:
-		ASSERT(FALSE);
-	}
+	*value = LoadHost(&mainMemory[physicalAddress], size);
 
 	DEBUG('a', "\tvalue read = %8.8x\n", *value);
 	return (TRUE);
@@ -141,34 +221,181 @@ bool Machine::WriteMem(int addr, int size, int value)
 {
 	ExceptionType exception;
 	int physicalAddress;
+	char *hostAddr = CachedAddress(addr, size, TRUE);
 
-	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+	if (hostAddr == NULL)
+	{
+		DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+
+		exception = Translate(addr, &physicalAddress, size, TRUE);
+		if (exception != NoException)
+		{
+			machine->RaiseException(exception, addr);
+			return FALSE;
+		}
+		hostAddr = &mainMemory[physicalAddress];
+	}
+	StoreHost(hostAddr, size, value);
+
+	physicalAddress = hostAddr - mainMemory;
+	if (decodeValid != NULL) // the word may hold a predecoded instruction
+		decodeValid[physicalAddress / 4] = FALSE;
+	if (pageEpoch != NULL) // ... or be part of a translated block
+		pageEpoch[physicalAddress / PageSize]++;
+	return TRUE;
+}
 
-	exception = Translate(addr, &physicalAddress, size, TRUE);
+//----------------------------------------------------------------------
+// Machine::UserSpan
+// 	Translate "virtAddr" on behalf of a kernel copy routine, and return
+//	the host address of its data in "mainMemory".  "*spanLen" is set to
+//	the number of bytes, at most "size", that are contiguous with it
+//	(i.e. that lie on the same page).
+//
+//	A page fault (or TLB miss) or a write to a read-only page is handed
+//	to the kernel right away, as the hardware would on a user access,
+//	and the translation retried, so that system calls work on pages
+//	that aren't in the TLB or haven't been loaded yet, or that are
+//	shared copy-on-write.  (A write to a shared page that isn't loaded
+//	yet can take a miss, a copy, and a miss again.)
+//
+//	Returns NULL if the page couldn't be translated; the exception has
+//	been raised, just as ReadMem and WriteMem do.
+//----------------------------------------------------------------------
+
+char *
+Machine::UserSpan(int virtAddr, int size, bool writing, int *spanLen)
+{
+	int physAddr;
+	ExceptionType exception = Translate(virtAddr, &physAddr, 1, writing);
+
+	for (int tries = 0; tries < 3 && (exception == PageFaultException ||
+			exception == ReadOnlyException); tries++)
+	{ // we are already in the kernel, so no need to switch modes
+		registers[BadVAddrReg] = virtAddr;
+		ExceptionHandler(exception);
+		exception = Translate(virtAddr, &physAddr, 1, writing);
+	}
 	if (exception != NoException)
 	{
-		machine->RaiseException(exception, addr);
-		return FALSE;
+		RaiseException(exception, virtAddr);
+		return NULL;
 	}
-	switch (size)
+	*spanLen = PageSize - (unsigned)virtAddr % PageSize;
+	if (*spanLen > size)
+		*spanLen = size;
+	return &mainMemory[physAddr];
+}
+
+//----------------------------------------------------------------------
+// Machine::UserWordAddress
+// 	Return the physical address of the word at "virtAddr", for
+//	kernel code that needs to know which word of memory a user
+//	address names, whatever address space it was seen through (see
+//	FutexTable).  As for the copy routines, the page is brought in
+//	if need be.
+//
+//	Returns -1 if "virtAddr" isn't word aligned, or if its page
+//	couldn't be translated (in which case the exception has been
+//	raised).
+//----------------------------------------------------------------------
+
+int Machine::UserWordAddress(int virtAddr)
+{
+	int span;
+	char *hostAddr;
+
+	if (virtAddr & 0x3)
+		return -1;
+	hostAddr = UserSpan(virtAddr, 4, FALSE, &span);
+	if (hostAddr == NULL)
+		return -1;
+	return hostAddr - mainMemory;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyIn
+// 	Copy "size" bytes of virtual memory at "virtAddr" into the kernel
+//	buffer "buffer", translating once per page rather than once per
+//	byte.  Returns the number of bytes copied, which is less than "size"
+//	only if part of the range couldn't be translated.
+//----------------------------------------------------------------------
+
+int Machine::CopyIn(int virtAddr, char *buffer, int size)
+{
+	int done = 0, span;
+	char *from;
+
+	while (done < size)
 	{
-	case 1:
-		machine->mainMemory[physicalAddress] = (unsigned char)(value & 0xff);
-		break;
+		from = UserSpan(virtAddr + done, size - done, FALSE, &span);
+		if (from == NULL)
+			break;
+		memcpy(buffer + done, from, span);
+		done += span;
+	}
+	return done;
+}
 
-	case 2:
-		*(unsigned short *)&machine->mainMemory[physicalAddress] = ShortToMachine((unsigned short)(value & 0xffff));
-		break;
+//----------------------------------------------------------------------
+// Machine::CopyOut
+// 	Copy "size" bytes of the kernel buffer "buffer" to virtual memory
+//	at "virtAddr", a page at a time.  Like WriteMem, this throws away
+//	any predecoded instructions or translated blocks it overwrites.
+//	Returns the number of bytes copied.
+//----------------------------------------------------------------------
 
-	case 4:
-		*(unsigned int *)&machine->mainMemory[physicalAddress] = WordToMachine((unsigned int)value);
-		break;
+int Machine::CopyOut(int virtAddr, char *buffer, int size)
+{
+	int done = 0, span, physAddr, i;
+	char *to;
 
-	default:
-		ASSERT(FALSE);
+	while (done < size)
+	{
+		to = UserSpan(virtAddr + done, size - done, TRUE, &span);
+		if (to == NULL)
+			break;
+		memcpy(to, buffer + done, span);
+
+		physAddr = to - mainMemory;
+		if (decodeValid != NULL)
+			for (i = physAddr / 4; i <= (physAddr + span - 1) / 4; i++)
+				decodeValid[i] = FALSE;
+		if (pageEpoch != NULL)
+			pageEpoch[physAddr / PageSize]++;
+		done += span;
 	}
+	return done;
+}
 
-	return TRUE;
+//----------------------------------------------------------------------
+// Machine::CopyInString
+// 	Copy a null-terminated string of at most "maxLen" characters from
+//	virtual memory at "virtAddr" into "buffer", which must have room for
+//	"maxLen" + 1 bytes.  The copy is always null-terminated.
+//	Returns the length of the string copied.
+//----------------------------------------------------------------------
+
+int Machine::CopyInString(int virtAddr, char *buffer, int maxLen)
+{
+	int len = 0, span;
+	char *from, *end;
+
+	while (len < maxLen)
+	{
+		from = UserSpan(virtAddr + len, maxLen - len, FALSE, &span);
+		if (from == NULL)
+			break;
+		end = (char *)memchr(from, '\0', span);
+		if (end != NULL)
+			span = end - from;
+		memcpy(buffer + len, from, span);
+		len += span;
+		if (end != NULL)
+			break;
+	}
+	buffer[len] = '\0';
+	return len;
 }
 
 //----------------------------------------------------------------------
@@ -180,6 +407,9 @@ bool Machine::WriteMem(int addr, int size, int value)
 //	address in "physAddr".  If there was an error, returns the type
 //	of the exception.
 //
+//	Pages translated recently are found in the translation cache
+//	first (see CachedAddress), skipping all of the above.
+//
 //	"virtAddr" -- the virtual address to translate
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
@@ -193,6 +423,15 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 	unsigned int vpn, offset;
 	TranslationEntry *entry;
 	unsigned int pageFrame;
+	char *hostAddr = CachedAddress(virtAddr, size, writing);
+
+	if (hostAddr != NULL)
+	{
+		*physAddr = hostAddr - mainMemory;
+		return NoException;
+	}
+	if (xlateCache != NULL)
+		stats->numXlateMisses++;
 
 	DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
 
@@ -230,19 +469,23 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 	}
 	else
 	{
-		for (entry = NULL, i = 0; i < TLBSize; i++)
-			if (tlb[i].valid && (tlb[i].virtualPage == vpn))
+		for (entry = NULL, i = 0; i < tlbSize; i++)
+			if (tlb[i].valid && (tlb[i].virtualPage == vpn) &&
+				(tlb[i].asid == tlbAsid))
 			{
 				entry = &tlb[i]; // FOUND!
+				tlbLastUse[i] = stats->totalTicks;
 				break;
 			}
 		if (entry == NULL)
 		{ // not found
 			DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+			stats->numTLBMisses++;
 			return PageFaultException; // really, this is a TLB fault,
 									   // the page may be in memory,
 									   // but not in the TLB
 		}
+		stats->numTLBHits++;
 	}
 
 	if (entry->readOnly && writing)
@@ -264,6 +507,14 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 		entry->dirty = TRUE;
 	*physAddr = pageFrame * PageSize + offset;
 	ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
+
+	if (xlateCache != NULL)
+	{ // remember it; stores may skip Translate once the page is dirty
+		CachedTranslation *cached = &xlateCache[vpn % TranslationCacheSize];
+		cached->vpn = vpn;
+		cached->page = &mainMemory[pageFrame * PageSize];
+		cached->writable = entry->dirty && !entry->readOnly;
+	}
 	DEBUG('a', "phys addr = 0x%x\n", *physAddr);
 	return NoException;
 }
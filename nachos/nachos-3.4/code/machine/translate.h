@@ -40,6 +40,9 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    int asid;		// TLB only: the address space the entry belongs
+			// to; it only matches while Machine::tlbAsid
+			// is the same.
 };
 
 #endif
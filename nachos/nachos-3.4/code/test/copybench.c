@@ -0,0 +1,67 @@
+/* copybench.c
+ *	Microbenchmark for the Read and Write system calls.
+ *
+ *	Writes, then reads back, BENCH_BYTES bytes of a file using
+ *	buffers of several sizes, and prints the throughput of each
+ *	in bytes per second of host time.  Meant to be run by the
+ *	userprog build (stub file system), since files on the Nachos
+ *	disk can't grow this large.
+ */
+
+#include "syscall.h"
+
+#define BENCH_BYTES 65536
+#define MAX_CHUNK 4096
+#define NUM_SIZES 5
+
+char buffer[MAX_CHUNK];
+int sizes[NUM_SIZES] = {1, 16, 128, 1024, 4096};
+
+/* Print one result line: "<op> <size> bytes/call: <rate> bytes/sec" */
+void Report(char *op, int size, int ms)
+{
+    if (ms <= 0) // faster than the clock can tell
+        ms = 1;
+    PrintString(op);
+    PrintInt(size);
+    PrintString(" bytes/call: ");
+    PrintInt((BENCH_BYTES / ms) * 1000);
+    PrintString(" bytes/sec\n");
+}
+
+int main()
+{
+    OpenFileId file;
+    int i, size, done, start;
+
+    for (i = 0; i < MAX_CHUNK; i++)
+        buffer[i] = 'a' + i % 26;
+
+    CreateFile("copybench.dat");
+    file = Open("copybench.dat", 0);
+    if (file < 0)
+    {
+        PrintString("copybench: can't open copybench.dat\n");
+        Halt();
+    }
+
+    for (i = 0; i < NUM_SIZES; i++)
+    {
+        size = sizes[i];
+
+        Seek(0, file);
+        start = GetTime();
+        for (done = 0; done < BENCH_BYTES; done += size)
+            Write(buffer, size, file);
+        Report("Write ", size, GetTime() - start);
+
+        Seek(0, file);
+        start = GetTime();
+        for (done = 0; done < BENCH_BYTES; done += size)
+            Read(buffer, size, file);
+        Report("Read  ", size, GetTime() - start);
+    }
+
+    Close(file);
+    Halt();
+}
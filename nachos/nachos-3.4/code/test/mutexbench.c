@@ -0,0 +1,109 @@
+/* mutexbench.c
+ *	Benchmark for locks under contention.
+ *
+ *	This process and a child (mutexworker) each take a lock
+ *	NUM_ROUNDS times, to add one to a counter they share, in a
+ *	shared memory segment.  First the lock is a user-space mutex
+ *	(umutex.c), which only makes a system call when it is taken,
+ *	then a kernel semaphore used by handle (DownH/UpH), which makes
+ *	two each time.  Prints the locks taken per second of host time
+ *	for each, and complains if the counter is wrong.
+ *
+ *	The two only contend when one is switched out holding the lock,
+ *	so run with random time slicing (-rs) to see the slow paths.
+ */
+
+#include "syscall.h"
+#include "umutex.h"
+
+#define NUM_ROUNDS 2000 /* must match mutexworker.c */
+#define CS_WORK 20      /* loop iterations inside the lock */
+
+struct Shared /* must match mutexworker.c */
+{
+    Mutex mutex;
+    int counter;
+};
+
+struct Shared *shared;
+
+/* Print one result line: "<how><rate> locks/sec", and check the count */
+void Report(char *how, int ms)
+{
+    if (ms <= 0) // faster than the clock can tell
+        ms = 1;
+    PrintString(how);
+    PrintInt((2 * NUM_ROUNDS * 1000) / ms);
+    PrintString(" locks/sec\n");
+    if (shared->counter != 2 * NUM_ROUNDS)
+        PrintString("mutexbench: lost updates to the counter\n");
+}
+
+/* One update of the counter, slow enough to be switched out in */
+void Update()
+{
+    int value = shared->counter, j;
+
+    for (j = 0; j < CS_WORK; j++)
+        ;
+    shared->counter = value + 1;
+}
+
+int main()
+{
+    SpaceId child;
+    int id, sem, i, start;
+
+    sem = CreateSemaphore("mb_lock", 1);
+    if (sem == -1 || CreateSemaphore("mb_go", 0) == -1 || CreateSemaphore("mb_done", 0) == -1)
+    {
+        PrintString("mutexbench: can't create semaphores\n");
+        Halt();
+    }
+
+    id = ShmCreate("mutexbench", sizeof(struct Shared));
+    shared = (id == -1) ? 0 : (struct Shared *)ShmAttach(id);
+    if (shared == 0)
+    {
+        PrintString("mutexbench: can't attach shared memory\n");
+        Halt();
+    }
+    MutexInit(&shared->mutex);
+    shared->counter = 0;
+
+    child = Exec("./test/mutexworker");
+    if (child == -1)
+    {
+        PrintString("mutexbench: can't run ./test/mutexworker\n");
+        Halt();
+    }
+
+    // User-space mutex
+    start = GetTime();
+    Up("mb_go");
+    for (i = 0; i < NUM_ROUNDS; i++)
+    {
+        MutexLock(&shared->mutex);
+        Update();
+        MutexUnlock(&shared->mutex);
+    }
+    Down("mb_done");
+    Report("Mutex:     ", GetTime() - start);
+
+    // Kernel semaphore
+    shared->counter = 0;
+    start = GetTime();
+    Up("mb_go");
+    for (i = 0; i < NUM_ROUNDS; i++)
+    {
+        DownH(sem);
+        Update();
+        UpH(sem);
+    }
+    Down("mb_done");
+    Report("Semaphore: ", GetTime() - start);
+
+    ShmDetach((char *)shared);
+    Join(child);
+    Halt();
+}
@@ -0,0 +1,62 @@
+/* mutexworker.c
+ *	The other half of mutexbench: takes the same locks as many
+ *	times, to update the same counter.
+ */
+
+#include "syscall.h"
+#include "umutex.h"
+
+#define NUM_ROUNDS 2000 /* must match mutexbench.c */
+#define CS_WORK 20
+
+struct Shared /* must match mutexbench.c */
+{
+    Mutex mutex;
+    int counter;
+};
+
+struct Shared *shared;
+
+void Update()
+{
+    int value = shared->counter, j;
+
+    for (j = 0; j < CS_WORK; j++)
+        ;
+    shared->counter = value + 1;
+}
+
+int main()
+{
+    int id, sem, i;
+
+    id = ShmCreate("mutexbench", sizeof(struct Shared));
+    shared = (id == -1) ? 0 : (struct Shared *)ShmAttach(id);
+    sem = OpenSemaphore("mb_lock");
+    if (shared == 0 || sem == -1)
+    {
+        PrintString("mutexworker: can't attach shared memory\n");
+        Exit(1);
+    }
+
+    Down("mb_go");
+    for (i = 0; i < NUM_ROUNDS; i++)
+    {
+        MutexLock(&shared->mutex);
+        Update();
+        MutexUnlock(&shared->mutex);
+    }
+    Up("mb_done");
+
+    Down("mb_go");
+    for (i = 0; i < NUM_ROUNDS; i++)
+    {
+        DownH(sem);
+        Update();
+        UpH(sem);
+    }
+    Up("mb_done");
+
+    ShmDetach((char *)shared);
+    Exit(0);
+}
@@ -0,0 +1,83 @@
+/* pipebench.c
+ *	Benchmark for handing data from one process to another.
+ *
+ *	Sends NUM_TOKENS tokens of TOKEN_BYTES bytes to a child process
+ *	(pipesink) twice: first through a pipe, then the way passenger
+ *	hands tokens to scan -- writing each one into a new file and
+ *	passing the file over with semaphores, for the child to open
+ *	and read back.  Prints the throughput of each in bytes per
+ *	second of host time.
+ */
+
+#include "syscall.h"
+
+#define NUM_TOKENS 256 /* must match pipesink.c */
+#define TOKEN_BYTES 64
+
+char token[TOKEN_BYTES];
+
+/* Print one result line: "<how><rate> bytes/sec" */
+void Report(char *how, int ms)
+{
+    if (ms <= 0) // faster than the clock can tell
+        ms = 1;
+    PrintString(how);
+    PrintInt(((NUM_TOKENS * TOKEN_BYTES) / ms) * 1000);
+    PrintString(" bytes/sec\n");
+}
+
+int main()
+{
+    OpenFileId fds[2], file;
+    SpaceId child;
+    int i, start;
+
+    for (i = 0; i < TOKEN_BYTES; i++)
+        token[i] = 'a' + i % 26;
+
+    if (CreateSemaphore("pb_full", 0) == -1 || CreateSemaphore("pb_empty", 0) == -1 ||
+        CreateSemaphore("pb_done", 0) == -1)
+    {
+        PrintString("pipebench: can't create semaphores\n");
+        Halt();
+    }
+
+    // The child inherits the pipe under the same descriptors (2 and 3,
+    // the first free ones of a process with only the console open)
+    if (Pipe(fds) == -1)
+    {
+        PrintString("pipebench: can't create a pipe\n");
+        Halt();
+    }
+    child = Exec("./test/pipesink");
+    if (child == -1)
+    {
+        PrintString("pipebench: can't run ./test/pipesink\n");
+        Halt();
+    }
+    Close(fds[0]); // only the child reads
+
+    // Through the pipe
+    start = GetTime();
+    for (i = 0; i < NUM_TOKENS; i++)
+        Write(token, TOKEN_BYTES, fds[1]);
+    Close(fds[1]);   // the child reads to end of file,
+    Down("pb_done"); // then says so
+    Report("Pipe: ", GetTime() - start);
+
+    // Through a file, one token at a time
+    start = GetTime();
+    for (i = 0; i < NUM_TOKENS; i++)
+    {
+        CreateFile("pipebench.txt");
+        file = Open("pipebench.txt", 0);
+        Write(token, TOKEN_BYTES, file);
+        Close(file);
+        Up("pb_full");
+        Down("pb_empty");
+    }
+    Report("File: ", GetTime() - start);
+
+    Join(child);
+    Halt();
+}
@@ -0,0 +1,44 @@
+/* pipesink.c
+ *	The receiving half of pipebench: reads the tokens pipebench
+ *	sends, first from the pipe it inherits, then from the file
+ *	pipebench hands over for each one.
+ */
+
+#include "syscall.h"
+
+#define NUM_TOKENS 256 /* must match pipebench.c */
+#define TOKEN_BYTES 64
+
+#define READ_END 2  /* the pipe, as pipebench created it */
+#define WRITE_END 3
+
+char buffer[TOKEN_BYTES];
+
+int main()
+{
+    OpenFileId file;
+    int i, n, total;
+
+    // Through the pipe: close the write end first, or the pipe would
+    // never reach end of file
+    Close(WRITE_END);
+    total = 0;
+    while ((n = Read(buffer, TOKEN_BYTES, READ_END)) > 0)
+        total += n;
+    Close(READ_END);
+    if (total != NUM_TOKENS * TOKEN_BYTES)
+        PrintString("pipesink: data lost in the pipe\n");
+    Up("pb_done");
+
+    // Through a file, one token at a time
+    for (i = 0; i < NUM_TOKENS; i++)
+    {
+        Down("pb_full");
+        file = Open("pipebench.txt", 1);
+        Read(buffer, TOKEN_BYTES, file);
+        Close(file);
+        Up("pb_empty");
+    }
+
+    Exit(0);
+}
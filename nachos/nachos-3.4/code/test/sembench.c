@@ -0,0 +1,68 @@
+/* sembench.c
+ *	Benchmark for semaphore operations.
+ *
+ *	Makes NUM_SEMS semaphores, then does NUM_ROUNDS round trips (an
+ *	Up followed by a Down, so neither ever blocks) on the last one
+ *	made: first by name, as Up and Down do, copying the name into
+ *	the kernel and looking it up each time, then by handle, with UpH
+ *	and DownH.  Prints the round trips per second of host time for
+ *	each.
+ */
+
+#include "syscall.h"
+
+#define NUM_SEMS 10
+#define NUM_ROUNDS 2000
+
+char name[] = "sb_0";
+
+/* Print one result line: "<how><rate> round trips/sec" */
+void Report(char *how, int ms)
+{
+    if (ms <= 0) // faster than the clock can tell
+        ms = 1;
+    PrintString(how);
+    PrintInt((NUM_ROUNDS * 1000) / ms);
+    PrintString(" round trips/sec\n");
+}
+
+int main()
+{
+    int i, handle, start;
+
+    for (i = 0; i < NUM_SEMS; i++)
+    {
+        name[3] = '0' + i;
+        handle = CreateSemaphore(name, 0);
+        if (handle == -1)
+        {
+            PrintString("sembench: can't create semaphores\n");
+            Halt();
+        }
+    }
+    if (OpenSemaphore(name) != handle)
+    {
+        PrintString("sembench: OpenSemaphore gave the wrong handle\n");
+        Halt();
+    }
+
+    // By name
+    start = GetTime();
+    for (i = 0; i < NUM_ROUNDS; i++)
+    {
+        Up(name);
+        Down(name);
+    }
+    Report("Name:   ", GetTime() - start);
+
+    // By handle
+    start = GetTime();
+    for (i = 0; i < NUM_ROUNDS; i++)
+    {
+        UpH(handle);
+        DownH(handle);
+    }
+    Report("Handle: ", GetTime() - start);
+
+    Halt();
+}
@@ -0,0 +1,67 @@
+/* shmbench.c
+ *	Benchmark for handing data to another process through shared
+ *	memory.
+ *
+ *	Sends the same tokens as pipebench to a child process (shmsink),
+ *	but through a shared memory segment both of them attach: each
+ *	token is written straight into the segment, and read from there
+ *	by the child, with semaphores taking turns.  Prints the
+ *	throughput in bytes per second of host time, to compare with
+ *	the pipe and the file.
+ */
+
+#include "syscall.h"
+
+#define NUM_TOKENS 256 /* must match shmsink.c */
+#define TOKEN_BYTES 64
+
+/* Print one result line: "<how><rate> bytes/sec" */
+void Report(char *how, int ms)
+{
+    if (ms <= 0) // faster than the clock can tell
+        ms = 1;
+    PrintString(how);
+    PrintInt(((NUM_TOKENS * TOKEN_BYTES) / ms) * 1000);
+    PrintString(" bytes/sec\n");
+}
+
+int main()
+{
+    SpaceId child;
+    char *buf;
+    int id, i, j, start;
+
+    if (CreateSemaphore("sb_full", 0) == -1 || CreateSemaphore("sb_empty", 0) == -1)
+    {
+        PrintString("shmbench: can't create semaphores\n");
+        Halt();
+    }
+
+    id = ShmCreate("shmbench", TOKEN_BYTES);
+    buf = (id == -1) ? 0 : ShmAttach(id);
+    if (buf == 0)
+    {
+        PrintString("shmbench: can't attach shared memory\n");
+        Halt();
+    }
+    child = Exec("./test/shmsink");
+    if (child == -1)
+    {
+        PrintString("shmbench: can't run ./test/shmsink\n");
+        Halt();
+    }
+
+    start = GetTime();
+    for (i = 0; i < NUM_TOKENS; i++)
+    {
+        for (j = 0; j < TOKEN_BYTES; j++)
+            buf[j] = 'a' + (i + j) % 26;
+        Up("sb_full");
+        Down("sb_empty");
+    }
+    Report("Shared memory: ", GetTime() - start);
+
+    ShmDetach(buf);
+    Join(child);
+    Halt();
+}
@@ -0,0 +1,38 @@
+/* shmsink.c
+ *	The receiving half of shmbench: reads each token shmbench
+ *	writes into the shared memory segment, where it was written.
+ */
+
+#include "syscall.h"
+
+#define NUM_TOKENS 256 /* must match shmbench.c */
+#define TOKEN_BYTES 64
+
+int main()
+{
+    char *buf;
+    int id, i, j, wrong;
+
+    id = ShmCreate("shmbench", TOKEN_BYTES);
+    buf = (id == -1) ? 0 : ShmAttach(id);
+    if (buf == 0)
+    {
+        PrintString("shmsink: can't attach shared memory\n");
+        Exit(1);
+    }
+
+    wrong = 0;
+    for (i = 0; i < NUM_TOKENS; i++)
+    {
+        Down("sb_full");
+        for (j = 0; j < TOKEN_BYTES; j++)
+            if (buf[j] != 'a' + (i + j) % 26)
+                wrong = 1;
+        Up("sb_empty");
+    }
+    if (wrong)
+        PrintString("shmsink: wrong data in shared memory\n");
+
+    ShmDetach(buf);
+    Exit(0);
+}
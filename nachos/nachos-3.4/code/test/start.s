@@ -253,6 +253,139 @@ Up:
 	syscall
 	j	$31
 	.end Up
+
+	.globl GetTime
+	.ent	GetTime
+GetTime:
+	addiu $2,$0,SC_GetTime
+	syscall
+	j	$31
+	.end GetTime
+
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j	$31
+	.end Pipe
+
+	.globl ShmCreate
+	.ent	ShmCreate
+ShmCreate:
+	addiu $2,$0,SC_ShmCreate
+	syscall
+	j	$31
+	.end ShmCreate
+
+	.globl ShmAttach
+	.ent	ShmAttach
+ShmAttach:
+	addiu $2,$0,SC_ShmAttach
+	syscall
+	j	$31
+	.end ShmAttach
+
+	.globl ShmDetach
+	.ent	ShmDetach
+ShmDetach:
+	addiu $2,$0,SC_ShmDetach
+	syscall
+	j	$31
+	.end ShmDetach
+
+	.globl OpenSemaphore
+	.ent	OpenSemaphore
+OpenSemaphore:
+	addiu $2,$0,SC_OpenSemaphore
+	syscall
+	j	$31
+	.end OpenSemaphore
+
+	.globl DownH
+	.ent	DownH
+DownH:
+	addiu $2,$0,SC_DownH
+	syscall
+	j	$31
+	.end DownH
+
+	.globl UpH
+	.ent	UpH
+UpH:
+	addiu $2,$0,SC_UpH
+	syscall
+	j	$31
+	.end UpH
+
+	.globl FutexWait
+	.ent	FutexWait
+FutexWait:
+	addiu $2,$0,SC_FutexWait
+	syscall
+	j	$31
+	.end FutexWait
+
+	.globl FutexWake
+	.ent	FutexWake
+FutexWake:
+	addiu $2,$0,SC_FutexWake
+	syscall
+	j	$31
+	.end FutexWake
+
+/* -------------------------------------------------------------
+ * Atomic operations:
+ *	Not system calls, but LL/SC loops (MIPS II instructions, which
+ *	the simulator supports): the SC fails, and the loop goes round
+ *	again, if any other thread ran since the LL.  Each returns the
+ *	old value of the word at arg1 in r2.
+ * -------------------------------------------------------------
+ */
+
+	.set	noreorder
+	.set	mips2
+
+	.globl CompareAndSwap
+	.ent	CompareAndSwap
+CompareAndSwap:
+	ll	$2,0($4)
+	bne	$2,$5,1f
+	addu	$8,$6,$0
+	sc	$8,0($4)
+	beq	$8,$0,CompareAndSwap
+	nop
+1:	j	$31
+	nop
+	.end CompareAndSwap
+
+	.globl Swap
+	.ent	Swap
+Swap:
+	ll	$2,0($4)
+	addu	$8,$5,$0
+	sc	$8,0($4)
+	beq	$8,$0,Swap
+	nop
+	j	$31
+	nop
+	.end Swap
+
+	.globl AtomicAdd
+	.ent	AtomicAdd
+AtomicAdd:
+	ll	$2,0($4)
+	addu	$8,$2,$5
+	sc	$8,0($4)
+	beq	$8,$0,AtomicAdd
+	nop
+	j	$31
+	nop
+	.end AtomicAdd
+
+	.set	mips0
+	.set	reorder
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,43 @@
+/* umutex.c
+ *	Mutexes for user programs, built on atomic operations and
+ *	futexes (after Drepper, "Futexes Are Tricky").
+ *
+ *	Taking a free mutex is one CompareAndSwap, and releasing one
+ *	nobody waits for is one AtomicAdd: no system call at all.  Only
+ *	when the mutex is taken does a thread mark it as waited on (2)
+ *	and sleep in FutexWait; whoever releases a mutex marked so calls
+ *	FutexWake.  FutexWait returns at once if the mark is gone, so a
+ *	release between the mark and the sleep isn't missed.
+ */
+
+#include "syscall.h"
+#include "umutex.h"
+
+void MutexInit(Mutex *m)
+{
+    m->state = 0;
+}
+
+void MutexLock(Mutex *m)
+{
+    int c = CompareAndSwap(&m->state, 0, 1);
+
+    if (c == 0) // it was free
+        return;
+    if (c != 2)
+        c = Swap(&m->state, 2);
+    while (c != 0)
+    {
+        FutexWait(&m->state, 2);
+        c = Swap(&m->state, 2); // still 2: others may be waiting too
+    }
+}
+
+void MutexUnlock(Mutex *m)
+{
+    if (AtomicAdd(&m->state, -1) != 1) // was 2: someone may be waiting
+    {
+        m->state = 0;
+        FutexWake(&m->state, 1);
+    }
+}
@@ -0,0 +1,22 @@
+/* umutex.h
+ *	Mutexes for user programs, that only enter the kernel when a
+ *	thread has to wait for one or wake a waiter (see umutex.c).
+ *
+ *	To be shared by several processes, a mutex must be in a shared
+ *	memory segment (see ShmAttach), and be initialized by one of
+ *	them before any uses it.
+ */
+
+#ifndef UMUTEX_H
+#define UMUTEX_H
+
+typedef struct
+{
+    int state; /* 0: unlocked, 1: locked, 2: locked and maybe waited on */
+} Mutex;
+
+void MutexInit(Mutex *m);
+void MutexLock(Mutex *m);
+void MutexUnlock(Mutex *m);
+
+#endif /* UMUTEX_H */
@@ -8,31 +8,72 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+// Usage: nachos -d <debugflags> -rs <random seed #> -sched <policy>
+//		-s -nd -bb -dp -rp <policy> -tlb <size> -tr <policy> -asid
+//		-tbm -x <nachos file>
+//		-c <consoleIn> <consoleOut>
+//		-f -bc <size> -cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -l -D -t -ra <size> -tra
+//		-ds <policy> -tds -tlf -fa <policy> -fr -tfa -tmd
+//		-mkdir <nachos dir> -tdir
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
-//              -z
+//              -z -q <thread test #>
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sched chooses how threads are scheduled: fifo (the default),
+//        or mlfq, a multi-level feedback queue driven by the timer
 //    -z prints the copyright message
 //
+//  THREADS
+//    -q runs the given thread test: 1 (the default) ping-pongs two
+//        threads, 2 benchmarks the pending interrupt queue
+//
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -nd turns off the predecoded instruction cache (decode every fetch)
+//    -bb runs user programs a basic block at a time (faster than
+//        one instruction at a time, but interrupts arrive later)
+//    -dp loads the pages of user programs on demand, at their first
+//        reference, instead of all at once when the program starts
+//    -rp pages user programs in and out of a swap file when memory
+//        is full (implies -dp), evicting pages by the given policy:
+//        fifo, clock or lru
+//    -tlb translates through a software-loaded TLB with the given
+//        number of entries, instead of the page table (0: page table)
+//    -tr chooses the TLB entry a miss replaces: random, fifo or lru
+//    -asid tags TLB entries with address space IDs, instead of
+//        flushing the TLB on every context switch
+//    -tbm benchmarks the bitmap that allocates pages and disk sectors
 //    -x runs a user program
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -bc sets the number of sectors the buffer cache holds (0: no cache)
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system
 //    -t tests the performance of the Nachos file system
+//    -ra sets how many sectors a file read sequentially may read ahead
+//        (0: no read-ahead)
+//    -tra times sequential reads with and without read-ahead
+//    -ds chooses the order waiting disk requests are served in: fcfs
+//        (the default), sstf, scan or clook
+//    -tds times several threads reading files scattered over the disk
+//    -tlf times writing (growing) and reading back a large file
+//    -fa chooses how file sectors are allocated: extent (the default),
+//        in contiguous runs, or sector, one at a time
+//    -fr prints how fragmented the free space and each file are
+//    -tfa compares the two allocation policies on files grown together
+//    -tmd times creating, opening and removing small files, opening
+//        a file that is already open, and the metadata journal
+//    -mkdir makes a Nachos directory (files are named by paths, a/b/c)
+//    -tdir times creating, looking up and removing many files in one
+//        directory
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -60,8 +101,11 @@ extern int testnum;
 // External functions used by this file
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
-extern void Print(char *file), PerformanceTest(void);
+extern void Print(char *file), PerformanceTest(void), ReadAheadTest(void);
+extern void DiskSchedulingTest(void), LargeFileTest(void);
+extern void AllocationTest(void), MetadataTest(void), DirectoryTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void BitMapTest(void);
 extern void MailTest(int networkID);
 
 //----------------------------------------------------------------------
@@ -131,6 +175,10 @@ int main(int argc, char **argv)
 							   // Nachos will loop forever waiting
 							   // for console input
 		}
+		else if (!strcmp(*argv, "-tbm"))
+		{ // bitmap benchmark
+			BitMapTest();
+		}
 #endif // USER_PROGRAM
 #ifdef FILESYS
 		if (!strcmp(*argv, "-cp"))
@@ -163,6 +211,40 @@ int main(int argc, char **argv)
 		{ // performance test
 			PerformanceTest();
 		}
+		else if (!strcmp(*argv, "-tra"))
+		{ // read-ahead benchmark
+			ReadAheadTest();
+		}
+		else if (!strcmp(*argv, "-tds"))
+		{ // disk scheduling benchmark
+			DiskSchedulingTest();
+		}
+		else if (!strcmp(*argv, "-tlf"))
+		{ // large file benchmark
+			LargeFileTest();
+		}
+		else if (!strcmp(*argv, "-fr"))
+		{ // print fragmentation
+			fileSystem->PrintFragmentation();
+		}
+		else if (!strcmp(*argv, "-tfa"))
+		{ // file allocation benchmark
+			AllocationTest();
+		}
+		else if (!strcmp(*argv, "-tmd"))
+		{ // metadata benchmark
+			MetadataTest();
+		}
+		else if (!strcmp(*argv, "-mkdir"))
+		{ // make a Nachos directory
+			ASSERT(argc > 1);
+			fileSystem->MakeDirectory(*(argv + 1));
+			argCount = 2;
+		}
+		else if (!strcmp(*argv, "-tdir"))
+		{ // directory benchmark
+			DirectoryTest();
+		}
 #endif // FILESYS
 #ifdef NETWORK
 		if (!strcmp(*argv, "-o"))
@@ -177,6 +259,10 @@ int main(int argc, char **argv)
 #endif // NETWORK
 	}
 
+#ifdef FILESYS
+	fileSystem->Sync(); // make the commands above stick
+#endif
+
 	currentThread->Finish(); // NOTE: if the procedure "main"
 							 // returns, then the program "nachos"
 							 // will exit (as any other normal program
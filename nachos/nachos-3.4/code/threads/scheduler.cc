@@ -11,8 +11,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Two policies: straight FIFO, with no priorities, or a multi-level
+//	feedback queue, which favors threads that block often (such as
+//	interactive ones) over those that use up their time slices.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -25,11 +26,17 @@
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads to empty.
+//
+//	"whichPolicy" is how to choose the next thread to run.  MLFQ
+//	relies on the timer to preempt threads whose time slice is over.
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulingPolicy whichPolicy)
 { 
-    readyList = new List; 
+    policy = whichPolicy;
+    for (int i = 0; i < NumPriorityLevels; i++)
+	readyList[i] = new List; 
+    lastBoost = 0;
 } 
 
 //----------------------------------------------------------------------
@@ -39,7 +46,8 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < NumPriorityLevels; i++)
+	delete readyList[i]; 
 } 
 
 //----------------------------------------------------------------------
@@ -56,7 +64,25 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    thread->readySince = stats->totalTicks;
+    readyList[thread->priority]->Append((void *)thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::WakeUp
+// 	A thread that was blocked (say, waiting for I/O) can run again.
+//	Under MLFQ, it goes back to the highest priority, since it gave
+//	up the CPU before its time slice was over.
+//
+//	"thread" is the thread to be put on the ready list.
+//----------------------------------------------------------------------
+
+void
+Scheduler::WakeUp (Thread *thread)
+{
+    if (policy == MLFQScheduling)
+	thread->priority = 0;
+    ReadyToRun(thread);
 }
 
 //----------------------------------------------------------------------
@@ -70,7 +96,66 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    for (int i = 0; i < NumPriorityLevels; i++)
+	if (!readyList[i]->IsEmpty())
+	    return (Thread *)readyList[i]->Remove();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TimeSliceOver
+// 	Called on every timer interrupt, to decide whether the running
+//	thread should yield the CPU.  Under FIFO it always does (round
+//	robin).  Under MLFQ it does if it has used up the time slice of
+//	its level, in which case it is also moved down a level, or if a
+//	thread of higher priority is waiting.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::TimeSliceOver ()
+{
+    Thread *thread = currentThread;
+
+    if (policy == FIFOScheduling)
+	return TRUE;
+
+    if (stats->totalTicks - lastBoost >= PriorityBoostTicks)
+	Boost();
+
+    if (stats->totalTicks - thread->sliceStart >=
+					Quantum(thread->priority)) {
+	if (thread->priority < NumPriorityLevels - 1)
+	    thread->priority++;
+	DEBUG('p', "Thread \"%s\" used up its time slice, now at level %d\n",
+	      thread->getName(), thread->priority);
+	thread->sliceStart = stats->totalTicks;
+	return TRUE;
+    }
+    for (int i = 0; i < thread->priority; i++)
+	if (!readyList[i]->IsEmpty())
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move every thread, running or ready, to the highest priority, so
+//	that the threads that have sunk to the bottom get to run too.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost ()
+{
+    Thread *thread;
+
+    DEBUG('p', "Boosting every thread to the top level\n");
+    for (int i = 1; i < NumPriorityLevels; i++)
+	while ((thread = (Thread *)readyList[i]->Remove()) != NULL) {
+	    thread->priority = 0;
+	    readyList[0]->Append((void *)thread);
+	}
+    currentThread->priority = 0;
+    lastBoost = stats->totalTicks;
 }
 
 //----------------------------------------------------------------------
@@ -97,11 +182,17 @@ Scheduler::Run (Thread *nextThread)
         currentThread->SaveUserState(); // save the user's CPU registers
 	currentThread->space->SaveState();
     }
+    machine->llAddress = -1;		// the next thread may store to the
+					// word an LL reserved, so its SC fails
 #endif
     
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    oldThread->runTicks += stats->totalTicks - oldThread->runSince;
+    nextThread->waitTicks += stats->totalTicks - nextThread->readySince;
+    nextThread->runSince = nextThread->sliceStart = stats->totalTicks;
+
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
     
@@ -143,5 +234,6 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i = 0; i < NumPriorityLevels; i++)
+	readyList[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
 }
@@ -13,24 +13,53 @@
 #include "list.h"
 #include "thread.h"
 
+// How the scheduler picks the next thread to run.
+
+enum SchedulingPolicy {
+    FIFOScheduling,		// one ready list, first come first served
+    MLFQScheduling		// multi-level feedback queue
+};
+
+// Under MLFQ, a thread at level "i" (0 is the highest priority) runs
+// for up to Quantum(i) ticks before it is preempted and moved down a
+// level.  A thread that blocks and is woken up goes back to the top,
+// and so does every thread every PriorityBoostTicks, so that nothing
+// starves.
+
+#define NumPriorityLevels 4
+#define Quantum(level) (TimerTicks << (level))
+#define PriorityBoostTicks 20000
+
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
 
 class Scheduler {
   public:
-    Scheduler();			// Initialize list of ready threads 
+    Scheduler(SchedulingPolicy whichPolicy = FIFOScheduling);
+					// Initialize list of ready threads 
     ~Scheduler();			// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
+    void WakeUp(Thread* thread);	// A blocked thread can be
+					// dispatched again.
     Thread* FindNextToRun();		// Dequeue first thread on the ready 
 					// list, if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
+    bool TimeSliceOver();		// On a timer interrupt: should the
+					// running thread give up the CPU?
     void Print();			// Print contents of ready list
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    SchedulingPolicy policy;		// FIFO, or MLFQ
+    List *readyList[NumPriorityLevels];	// queues of threads that are
+					// ready to run, but not running,
+					// one per priority level (FIFO
+					// only uses the first)
+    int lastBoost;			// when every thread was last moved
+					// to the top level (MLFQ)
+
+    void Boost();			// Move every thread to the top level
 };
 
 #endif // SCHEDULER_H
@@ -91,7 +91,7 @@ void Semaphore::V()
 
     thread = (Thread *)queue->Remove();
     if (thread != NULL) // make thread ready, consuming the V immediately
-        scheduler->ReadyToRun(thread);
+        scheduler->WakeUp(thread);
     value++;
     (void)interrupt->SetLevel(oldLevel);
 }
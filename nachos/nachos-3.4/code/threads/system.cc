@@ -25,6 +25,8 @@ FileSystem *fileSystem;
 
 #ifdef FILESYS
 SynchDisk *synchDisk;
+BufferCache *bufferCache; // recently used disk sectors
+bool extentAllocation;    // allocate file sectors in contiguous runs?
 #endif
 
 #ifdef USER_PROGRAM          // requires either FILESYS or FILESYS_STUB
@@ -33,6 +35,13 @@ SynchConsole *gSynchConsole; // the synchronized console
 
 Semaphore *addrLock;     // semaphore
 BitMap *gPhysPageBitMap; // manages physical frames
+bool demandPaging;       // load user pages on first reference?
+FrameTable *frameTable;  // who owns each physical frame
+SwapSpace *swap;         // backing store for evicted pages
+TextCache *textCache;    // code pages shared among processes
+ShmTable *shmTable;      // memory segments shared among processes
+FutexTable *futexTable;  // threads asleep on user-space locks
+TLBManager *tlbManager;  // loads the TLB, NULL if there is none
 PTable *pTab;            // manages processes
 STable *sTab;            // manages semaphores
 #endif
@@ -58,13 +67,16 @@ extern void Cleanup();
 //	if the interrupted thread called Yield at the point it is
 //	was interrupted.
 //
+//	Whether the thread actually yields is up to the scheduler: under
+//	MLFQ, only once its time slice is over.
+//
 //	"dummy" is because every interrupt handler takes one argument,
 //		whether it needs it or not.
 //----------------------------------------------------------------------
 static void
 TimerInterruptHandler(int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if (interrupt->getStatus() != IdleMode && scheduler->TimeSliceOver())
         interrupt->YieldOnReturn();
 }
 
@@ -83,13 +95,30 @@ void Initialize(int argc, char **argv)
     int argCount;
     char *debugArgs = "";
     bool randomYield = FALSE;
+    SchedulingPolicy schedPolicy = FIFOScheduling;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE; // single step user program
+    bool predecode = TRUE;      // cache decoded user instructions
+    bool blockEngine = FALSE;   // run user code a basic block at a time
+    ReplacementPolicy policy = NoReplacement; // page replacement, if any
+#ifdef USE_TLB
+    int tlbEntries = TLBSize; // translate through a TLB of this size
+#else
+    int tlbEntries = 0;
+#endif
+    TLBPolicy tlbPolicy = FIFOTLB; // which TLB entry a miss replaces
+    bool tlbTagged = FALSE;        // tag TLB entries with address space IDs
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE; // format disk
 #endif
+#ifdef FILESYS
+    int cacheSectors = CacheSectors; // size of the buffer cache
+    int readAhead = MaxReadAhead;    // most sectors to read ahead
+    DiskPolicy diskPolicy = FCFSDisk; // order to serve disk requests in
+    extentAllocation = TRUE;
+#endif
 #ifdef NETWORK
     double rely = 1; // network reliability
     int netname = 0; // UNIX socket name
@@ -116,14 +145,109 @@ void Initialize(int argc, char **argv)
             randomYield = TRUE;
             argCount = 2;
         }
+        else if (!strcmp(*argv, "-sched"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "fifo"))
+                schedPolicy = FIFOScheduling;
+            else if (!strcmp(*(argv + 1), "mlfq"))
+                schedPolicy = MLFQScheduling;
+            else
+                ASSERT(FALSE); // unknown scheduling policy
+            argCount = 2;
+        }
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = TRUE;
+        else if (!strcmp(*argv, "-nd"))
+            predecode = FALSE;
+        else if (!strcmp(*argv, "-bb"))
+            blockEngine = TRUE;
+        else if (!strcmp(*argv, "-dp"))
+            demandPaging = TRUE;
+        else if (!strcmp(*argv, "-rp"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "fifo"))
+                policy = FIFOReplacement;
+            else if (!strcmp(*(argv + 1), "clock"))
+                policy = ClockReplacement;
+            else if (!strcmp(*(argv + 1), "lru"))
+                policy = LRUReplacement;
+            else
+                ASSERT(FALSE); // unknown replacement policy
+            demandPaging = TRUE; // can't page out what can't page in
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlb"))
+        {
+            ASSERT(argc > 1);
+            tlbEntries = atoi(*(argv + 1));
+            ASSERT(tlbEntries >= 0);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tr"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "random"))
+                tlbPolicy = RandomTLB;
+            else if (!strcmp(*(argv + 1), "fifo"))
+                tlbPolicy = FIFOTLB;
+            else if (!strcmp(*(argv + 1), "lru"))
+                tlbPolicy = LRUTLB;
+            else
+                ASSERT(FALSE); // unknown TLB replacement policy
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-asid"))
+            tlbTagged = TRUE;
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = TRUE;
 #endif
+#ifdef FILESYS
+        if (!strcmp(*argv, "-bc"))
+        {
+            ASSERT(argc > 1);
+            cacheSectors = atoi(*(argv + 1));
+            ASSERT(cacheSectors >= 0);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-ra"))
+        {
+            ASSERT(argc > 1);
+            readAhead = atoi(*(argv + 1));
+            ASSERT(readAhead >= 0 && readAhead <= MaxReadAhead);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-ds"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "fcfs"))
+                diskPolicy = FCFSDisk;
+            else if (!strcmp(*(argv + 1), "sstf"))
+                diskPolicy = SSTFDisk;
+            else if (!strcmp(*(argv + 1), "scan"))
+                diskPolicy = SCANDisk;
+            else if (!strcmp(*(argv + 1), "clook"))
+                diskPolicy = CLOOKDisk;
+            else
+                ASSERT(FALSE); // unknown disk scheduling policy
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-fa"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "sector"))
+                extentAllocation = FALSE;
+            else if (!strcmp(*(argv + 1), "extent"))
+                extentAllocation = TRUE;
+            else
+                ASSERT(FALSE); // unknown file allocation policy
+            argCount = 2;
+        }
+#endif
 #ifdef NETWORK
         if (!strcmp(*argv, "-l"))
         {
@@ -143,9 +267,9 @@ void Initialize(int argc, char **argv)
     DebugInit(debugArgs);        // initialize DEBUG messages
     stats = new Statistics();    // collect statistics
     interrupt = new Interrupt;   // start up interrupt handling
-    scheduler = new Scheduler(); // initialize the ready queue
-    if (randomYield)             // start the timer (if needed)
-        timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    scheduler = new Scheduler(schedPolicy); // initialize the ready queue
+    if (randomYield || schedPolicy == MLFQScheduling) // start the timer
+        timer = new Timer(TimerInterruptHandler, 0, randomYield); // (if needed)
 
     threadToBeDestroyed = NULL;
 
@@ -159,17 +283,36 @@ void Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup); // if user hits ctl-C
 
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg); // this must come first
+    machine = new Machine(debugUserProg, predecode, blockEngine, tlbEntries); // this must come first
     gSynchConsole = new SynchConsole();
 
     addrLock = new Semaphore("addrLock", 1);
-    gPhysPageBitMap = new BitMap(256);
+    gPhysPageBitMap = new BitMap(NumPhysPages);
+    frameTable = new FrameTable(policy);
+    textCache = new TextCache();
+    shmTable = new ShmTable();
+    futexTable = new FutexTable();
+    if (tlbEntries > 0)
+        tlbManager = new TLBManager(tlbPolicy, tlbTagged);
+    else
+        tlbManager = NULL;
+    if (policy != NoReplacement)
+    { // only evicted pages need a swap file
+        swap = new SwapSpace("SWAP", NumSwapPages);
+        stats->pagingPolicy = FrameTable::PolicyName(policy);
+    }
+    else
+        swap = NULL;
     pTab = new PTable(10);
     sTab = new STable();
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", diskPolicy);
+    stats->diskPolicy = SynchDisk::PolicyName(diskPolicy);
+    bufferCache = new BufferCache(synchDisk, cacheSectors);
+    if (cacheSectors > 0)
+        bufferCache->SetReadAheadLimit(readAhead);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -197,7 +340,14 @@ void Cleanup()
     delete gSynchConsole;
 
     delete addrLock;
+    delete textCache; // gives its frames back to the frame table
+    delete shmTable;  // so does this
+    delete futexTable;
     delete gPhysPageBitMap;
+    delete frameTable;
+    if (swap != NULL)
+        delete swap;
+    delete tlbManager;
     delete pTab;
     delete sTab;
 #endif
@@ -207,6 +357,7 @@ void Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete bufferCache;
     delete synchDisk;
 #endif
 
@@ -36,11 +36,25 @@ extern Timer *timer;				// the hardware alarm clock
 #include "machine.h"
 #include "synchcons.h"
 #include "synch.h"
+#include "frametable.h"
+#include "swapspace.h"
+#include "textcache.h"
+#include "shm.h"
+#include "futex.h"
+#include "tlbmanager.h"
 extern Machine *machine;			// user program memory and registers
 extern SynchConsole *gSynchConsole; // synchronizes threads using console I/O
 
 extern Semaphore *addrLock;		// semaphore
 extern BitMap *gPhysPageBitMap; // manages physical frames
+extern bool demandPaging;		// load user pages on first reference?
+extern FrameTable *frameTable;	// who owns each physical frame
+extern SwapSpace *swap;			// backing store for evicted pages, NULL
+					// without a replacement policy
+extern TextCache *textCache;	// code pages shared among processes
+extern ShmTable *shmTable;		// memory segments shared among processes
+extern FutexTable *futexTable;	// threads asleep on user-space locks
+extern TLBManager *tlbManager;	// loads the TLB, NULL if there is none
 extern PTable *pTab;			// manages processes
 extern STable *sTab;			// manages semaphores
 
@@ -53,7 +67,10 @@ extern FileSystem *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "bufcache.h"
 extern SynchDisk *synchDisk;
+extern BufferCache *bufferCache; // recently used disk sectors
+extern bool extentAllocation;	 // allocate file sectors in contiguous runs?
 #endif
 
 #ifdef NETWORK
@@ -41,6 +41,10 @@ Thread::Thread(char *threadName)
 
     processID = 0;
     exitStatus = 0;
+
+    priority = 0;
+    sliceStart = runSince = readySince = stats->totalTicks;
+    runTicks = waitTicks = 0;
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -147,6 +151,8 @@ void Thread::Finish()
     ASSERT(this == currentThread);
 
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
+    DEBUG('p', "Thread \"%s\" ran %d ticks, waited %d ticks ready\n",
+          getName(), runTicks + stats->totalTicks - runSince, waitTicks);
 
     threadToBeDestroyed = currentThread;
     Sleep(); // invokes SWITCH
@@ -180,12 +186,15 @@ void Thread::Yield()
 
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
 
+    // Get in line first, so that a thread of lower priority doesn't
+    // get the CPU instead of us (with a single FIFO ready list, this
+    // picks the same thread as looking before getting in line).
+    scheduler->ReadyToRun(this);
     nextThread = scheduler->FindNextToRun();
-    if (nextThread != NULL)
-    {
-        scheduler->ReadyToRun(this);
+    if (nextThread != this)
         scheduler->Run(nextThread);
-    }
+    else
+        setStatus(RUNNING); // nobody else to run
     (void)interrupt->SetLevel(oldLevel);
 }
 
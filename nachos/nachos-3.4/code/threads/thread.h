@@ -93,6 +93,13 @@ public:
                            // is called
   int processID;           // process ID of the thread
   int exitStatus;          // exit status of the thread
+
+  int priority;   // MLFQ level, 0 is the highest (see scheduler.h)
+  int sliceStart; // when its current time slice started
+  int runSince;   // when it was last dispatched
+  int readySince; // when it was last put on the ready list
+  int runTicks;   // total time spent running
+  int waitTicks;  // total time spent ready, waiting for the CPU
   void FreeSpace()
   {
     if (space != NULL)
@@ -52,6 +52,49 @@ ThreadTest1()
     SimpleThread(0);
 }
 
+//----------------------------------------------------------------------
+// InterruptStressTest
+// 	Benchmark the pending interrupt queue: schedule StressEvents
+//	interrupts, each a random 1 to 2*StressDepth ticks away, advancing
+//	simulated time a tick per interrupt so that about StressDepth
+//	of them are pending at any time, then report how many were
+//	scheduled (and fired) per second of host time.
+//----------------------------------------------------------------------
+
+#define StressEvents 2000000
+#define StressDepth 1000
+
+static int stressFired;		// interrupts handled so far
+
+static void
+StressHandler(int arg)
+{
+    stressFired++;
+}
+
+void
+InterruptStressTest()
+{
+    int i;
+    double start, seconds;
+
+    DEBUG('t', "Entering InterruptStressTest");
+
+    stressFired = 0;
+    start = HostTime();
+    for (i = 0; i < StressEvents; i++) {
+	interrupt->Schedule(StressHandler, i,
+			    1 + Random() % (2 * StressDepth), DiskInt);
+	interrupt->OneTick();
+    }
+    seconds = HostTime() - start;
+    if (seconds <= 0)		// faster than the clock can tell
+	seconds = 1e-6;
+
+    printf("Interrupt queue: %d scheduled, %d fired, %.0f inserts/sec\n",
+	   StressEvents, stressFired, StressEvents / seconds);
+}
+
 //----------------------------------------------------------------------
 // ThreadTest
 // 	Invoke a test routine.
@@ -64,6 +107,9 @@ ThreadTest()
     case 1:
 	ThreadTest1();
 	break;
+    case 2:
+	InterruptStressTest();
+	break;
     default:
 	printf("No test specified.\n");
 	break;
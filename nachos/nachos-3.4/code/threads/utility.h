@@ -9,6 +9,8 @@
 //	'+' -- turn on all debug messages
 //   	't' -- thread system
 //   	's' -- semaphores, locks, and conditions
+//   	'p' -- scheduling: priority changes, and each thread's run
+//		and wait times when it finishes
 //   	'i' -- interrupt emulation
 //   	'm' -- machine emulation (USER_PROGRAM)
 //   	'd' -- disk emulation (FILESYS)
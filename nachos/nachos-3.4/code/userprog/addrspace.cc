@@ -53,171 +53,639 @@ static void SwapHeader(NoffHeader *noffH)
 //
 //	Assumes that the object code file is in NOFF format.
 //
-//	First, set up the translation from program memory to physical
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	The whole program is loaded right away, since the caller closes
+//	"executable" as soon as we return.
 //
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace(OpenFile *executable)
 {
-    NoffHeader noffH;
-    unsigned int i, size;
+    Setup(executable, NULL, FALSE);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create an address space to run the user program stored in the
+//	file "filename".
+//
+//	With demand paging (-dp) nothing is loaded yet: every page starts
+//	out invalid, and is brought in by PageIn on its first reference.
+//	The executable then stays open for as long as the address space
+//	exists.
+//
+//	Either way, the pages holding only code are shared with other
+//	processes running the same file (see textcache.h).
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(char *filename)
+{
+    OpenFile *file = fileSystem->Open(filename);
 
-    if (executable == NULL)
+    if (file == NULL)
     {
-        printf("Unable to open file\n");
+        printf("Unable to open file %s\n", filename);
+        numPages = tableSize = 0;
+        pageTable = NULL;
+        swapSlot = NULL;
+        pagingFile = NULL;
+        text = NULL;
+        asid = asidEpoch = 0;
+        for (int i = 0; i < ShmRegionPages; i++)
+            shmMap[i] = NULL;
+        for (int i = 0; i < MaxSharedSegments; i++)
+            shmHeld[i] = NULL;
         return;
     }
+    Setup(file, filename, demandPaging);
+    if (pagingFile == NULL)
+        delete file;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Setup
+// 	Read the NOFF header of "file", and build a page table big enough
+//	for the program plus its stack.
+//
+//	If "name" isn't NULL, the code pages are shared with every other
+//	address space set up from a file of that name.
+//
+//	If "lazy", every page is left invalid for PageIn to load on
+//	demand, and "file" is remembered (it must stay open).  Otherwise
+//	a frame is allocated and loaded for every page now; if there
+//	aren't enough free frames the address space is left empty.
+//
+//	Either way, the page table goes on past the stack for another
+//	ShmRegionPages entries, all invalid, where shared memory segments
+//	can be attached later without the table having to move.
+//----------------------------------------------------------------------
+
+void AddrSpace::Setup(OpenFile *file, char *name, bool lazy)
+{
+    unsigned int i, size;
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
+    numPages = tableSize = 0;
+    pageTable = NULL;
+    swapSlot = NULL;
+    pagingFile = NULL;
+    text = NULL;
+    asid = asidEpoch = 0; // no address space ID until first run
+    for (i = 0; i < ShmRegionPages; i++)
+        shmMap[i] = NULL;
+    for (i = 0; i < MaxSharedSegments; i++)
+        shmHeld[i] = NULL;
+
+    file->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && (WordToHost(noffH.noffMagic) == NOFFMAGIC))
         SwapHeader(&noffH);
-
     ASSERT(noffH.noffMagic == NOFFMAGIC);
 
-    addrLock->P();
     // how big is address space?
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize; // we need to increase the size
                                                                                           // to leave room for the stack
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
+    tableSize = numPages + ShmRegionPages;
+
+    DEBUG('a', "Initializing address space, num pages %d, size %d\n",
+          numPages, size);
+
+    if (name != NULL)
+    {
+        addrLock->P();
+        text = textCache->Acquire(name, &noffH.code);
+        addrLock->V();
+    }
+
+    if (lazy)
+    {
+        pagingFile = file;
+        pageTable = new TranslationEntry[tableSize];
+        swapSlot = new int[numPages];
+        for (i = 0; i < numPages; i++)
+        {
+            pageTable[i].virtualPage = i;
+            pageTable[i].physicalPage = -1; // not in memory yet
+            pageTable[i].valid = FALSE;
+            pageTable[i].use = FALSE;
+            pageTable[i].dirty = FALSE;
+            pageTable[i].readOnly = FALSE;
+            swapSlot[i] = -1; // never written out
+        }
+        InitShmRegion();
+        return;
+    }
+
+    addrLock->P();
 
     ASSERT(numPages <= NumPhysPages); // Check we're not trying to run anything too big  at least until we have virtual memory
 
+    if (numPages > gPhysPageBitMap->NumClear())
+        textCache->Reclaim(); // code of programs that have exited
     if (numPages > gPhysPageBitMap->NumClear())
     {
-        printf("Not enough memory\n");
-        numPages = 0;
-        delete executable;
+        printf("\nAddrSpace::Load : not enough memory for new process");
+        numPages = tableSize = 0;
         addrLock->V();
         return;
     }
 
-    DEBUG('a', "Initializing address space, num pages %d, size %d\n", numPages, size);
     // first, set up the translation
-    pageTable = new TranslationEntry[numPages];
+    pageTable = new TranslationEntry[tableSize];
+    swapSlot = new int[numPages];
     for (i = 0; i < numPages; i++)
     {
-        pageTable[i].virtualPage = i; // for now, virtual page # = phys page #
-
-        pageTable[i].physicalPage = gPhysPageBitMap->Find();
-
+        pageTable[i].virtualPage = i;
         pageTable[i].valid = TRUE;
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE; // if the code segment was entirely on
-                                       // a separate page, we could set its
-                                       // pages to be read-only
+        pageTable[i].readOnly = IsSharedCode(i); // shared pages are
+                                                 // copy-on-write
+        // A shared page that isn't loaded yet gets a frame now too,
+        // while we know there is room, in case no other process has
+        // loaded it by the time we get to it below.
+        if (!pageTable[i].readOnly)
+            pageTable[i].physicalPage = frameTable->Allocate(this, i, &pageTable[i]);
+        else if (text->frames[i - text->firstPage] < 0)
+            pageTable[i].physicalPage = frameTable->Allocate(NULL, i, NULL);
+        else
+            pageTable[i].physicalPage = -1; // loaded already
+        swapSlot[i] = -1;
     }
+    InitShmRegion();
 
     addrLock->V();
 
-    if (noffH.code.size > 0)
+    // then, copy in the code and data segments into memory
+    for (i = 0; i < numPages; i++)
     {
-        for (i = 0; i < numPages; i++)
-            executable->ReadAt(&(machine->mainMemory[noffH.code.virtualAddr]) + (pageTable[i].physicalPage * PageSize), PageSize, noffH.code.inFileAddr + (i * PageSize));
+        if (pageTable[i].readOnly)
+        {
+            pageTable[i].physicalPage = SharedFrame(file, i, pageTable[i].physicalPage);
+            ASSERT(pageTable[i].physicalPage >= 0); // we reserved a frame
+        }
+        else
+            LoadPage(file, i, pageTable[i].physicalPage);
     }
 
-    if (noffH.initData.size > 0)
+    addrLock->P();
+    for (i = 0; i < numPages; i++)
+        if (!pageTable[i].readOnly)
+            frameTable->Unpin(pageTable[i].physicalPage);
+    addrLock->V();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InitShmRegion
+// 	Make the page table entries past the stack, where shared memory
+//	segments are attached, invalid: nothing is attached yet.
+//----------------------------------------------------------------------
+
+void AddrSpace::InitShmRegion()
+{
+    for (unsigned int i = numPages; i < tableSize; i++)
     {
-        for (i = 0; i < numPages; i++)
-            executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]) + (pageTable[i].physicalPage * PageSize), PageSize, noffH.initData.inFileAddr + (i * PageSize));
+        pageTable[i].virtualPage = i;
+        pageTable[i].physicalPage = -1;
+        pageTable[i].valid = FALSE;
+        pageTable[i].use = FALSE;
+        pageTable[i].dirty = FALSE;
+        pageTable[i].readOnly = FALSE;
     }
 }
 
-AddrSpace::AddrSpace(char *filename)
+//----------------------------------------------------------------------
+// LoadSegment
+// 	Copy the part of segment "seg" of "file" that falls within the
+//	virtual page starting at "pageStart" into "page", the host memory
+//	of the frame holding that page.
+//----------------------------------------------------------------------
+
+static void LoadSegment(OpenFile *file, Segment *seg, int pageStart, char *page)
 {
-    NoffHeader noffH;
-    unsigned int i, size;
+    int from = seg->virtualAddr, to = seg->virtualAddr + seg->size;
+
+    if (from < pageStart)
+        from = pageStart;
+    if (to > pageStart + PageSize)
+        to = pageStart + PageSize;
+    if (from < to)
+        file->ReadAt(page + (from - pageStart), to - from,
+                     seg->inFileAddr + (from - seg->virtualAddr));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill physical frame "frame" with the initial contents of virtual
+//	page "vpn": whatever code and initialized data of "file" fall in
+//	that page, and zeroes everywhere else (uninitialized data, stack).
+//----------------------------------------------------------------------
+
+void AddrSpace::LoadPage(OpenFile *file, int vpn, int frame)
+{
+    char *page = &machine->mainMemory[frame * PageSize];
 
-    OpenFile *executable = fileSystem->Open(filename);
+    machine->InvalidateDecoded(frame); // new contents
+    memset(page, 0, PageSize);
+    LoadSegment(file, &noffH.code, vpn * PageSize, page);
+    LoadSegment(file, &noffH.initData, vpn * PageSize, page);
+}
 
-    if (executable == NULL)
+//----------------------------------------------------------------------
+// AddrSpace::IsSharedCode
+// 	Is virtual page "vpn" one of the code pages shared with other
+//	processes running the same executable?
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsSharedCode(unsigned int vpn)
+{
+    return text != NULL && vpn >= (unsigned)text->firstPage &&
+           vpn < (unsigned)(text->firstPage + text->numPages);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SharedFrame
+// 	Return the frame holding shared code page "vpn", loading it from
+//	"file" if no other process has yet.  The frame belongs to the
+//	text cache, not to this address space.
+//
+//	"frame" is a frame already allocated for the page, or -1 to
+//	allocate one if need be.  It is freed if it turns out not to be
+//	needed.
+//
+//	Returns -1 if there is no frame to load it into.
+//----------------------------------------------------------------------
+
+int AddrSpace::SharedFrame(OpenFile *file, unsigned int vpn, int frame)
+{
+    int *shared = &text->frames[vpn - text->firstPage];
+
+    if (*shared < 0)
     {
-        printf("Unable to open file %s\n", filename);
-        return;
+        if (frame < 0)
+        {
+            addrLock->P();
+            frame = frameTable->Allocate(NULL, vpn, NULL);
+            addrLock->V();
+            if (frame < 0)
+                return -1;
+        }
+        LoadPage(file, vpn, frame);
     }
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && (WordToHost(noffH.noffMagic) == NOFFMAGIC))
-        SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    if (*shared >= 0)
+    { // loaded already, or by another process while we were reading
+        if (frame >= 0)
+        {
+            addrLock->P();
+            frameTable->Free(frame);
+            addrLock->V();
+        }
+        return *shared;
+    }
+    *shared = frame;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+// 	Handle a page fault on virtual page "vpn": get a frame from the
+//	frame table (which may evict some other page to free one), fill
+//	it from the swap file if the page was ever written out, or else
+//	from the executable (or with zeroes), and make its translation
+//	valid, so that the faulting instruction can be retried.
+//
+//	Returns FALSE if "vpn" is not part of the address space, or if
+//	no frame can be found for it.
+//----------------------------------------------------------------------
+
+bool AddrSpace::PageIn(unsigned int vpn)
+{
+    int frame;
+
+    if (vpn >= tableSize)
+        return FALSE;
+    if (pageTable[vpn].valid)
+        return TRUE; // somebody beat us to it (or shared memory
+                     // whose translation isn't in the TLB)
+    if (vpn >= numPages)
+        return FALSE; // nothing attached there
+    if (swapSlot[vpn] < 0 && pagingFile == NULL)
+        return FALSE; // nowhere to get it from
+
+    if (swapSlot[vpn] < 0 && IsSharedCode(vpn))
+    { // map the copy shared with other processes
+        frame = SharedFrame(pagingFile, vpn, -1);
+        if (frame < 0)
+            return FALSE;
+        DEBUG('a', "Page fault on virtual page %d, shared in frame %d\n",
+              vpn, frame);
+        stats->numPageFaults++;
+        pageTable[vpn].physicalPage = frame;
+        pageTable[vpn].use = FALSE;
+        pageTable[vpn].dirty = FALSE;
+        pageTable[vpn].readOnly = TRUE; // copy-on-write
+        pageTable[vpn].valid = TRUE;
+        return TRUE;
+    }
 
     addrLock->P();
+    frame = frameTable->Allocate(this, vpn, &pageTable[vpn]);
+    addrLock->V();
+    if (frame < 0)
+        return FALSE;
 
-    // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize; // we need to increase the size
-                                                                                          // to leave room for the stack
+    DEBUG('a', "Page fault on virtual page %d, loading into frame %d\n",
+          vpn, frame);
+    stats->numPageFaults++;
+    if (swapSlot[vpn] >= 0)
+    {
+        machine->InvalidateDecoded(frame); // new contents
+        swap->ReadPage(swapSlot[vpn], &machine->mainMemory[frame * PageSize]);
+    }
+    else
+        LoadPage(pagingFile, vpn, frame);
 
-    // Number page process need
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
+    // An invalid entry is never in the machine's translation cache,
+    // so there is nothing to flush.
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].valid = TRUE;
+
+    addrLock->P();
+    frameTable->Unpin(frame);
+    addrLock->V();
+    return TRUE;
+}
 
-    int numclear = gPhysPageBitMap->NumClear();
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Evict virtual page "vpn" from its frame, at the frame table's
+//	request.  The page is written to the swap file if it has changed
+//	since it was last loaded (or can't be loaded again from the
+//	executable); a clean page is simply dropped.
+//
+//	Called with "addrLock" held.  Returns FALSE, leaving the page in
+//	memory, if it needs writing but the swap file is full.
+//----------------------------------------------------------------------
 
-    // printf("\n\nSize: %d | numPages: %d | PageSize: %d | Numclear: %d\n\n", size, numPages, PageSize, numclear);
+bool AddrSpace::PageOut(unsigned int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+    int frame = entry->physicalPage;
 
-    if (numPages > numclear)
+    ASSERT(vpn < numPages && entry->valid && !entry->readOnly);
+    if (tlbManager != NULL) // the TLB may hold its latest dirty bit
+        tlbManager->Forget(frame);
+    if (entry->dirty || (swapSlot[vpn] < 0 && pagingFile == NULL))
     {
-        printf("\nAddrSpace::Load : not enough memory for new process");
-        numPages = 0;
-        delete executable;
-        addrLock->V();
+        if (swapSlot[vpn] < 0)
+            swapSlot[vpn] = swap->Allocate();
+        if (swapSlot[vpn] < 0)
+        {
+            printf("\nAddrSpace::PageOut : swap space is full");
+            return FALSE;
+        }
+        swap->WritePage(swapSlot[vpn], &machine->mainMemory[frame * PageSize]);
+        stats->numPageWritebacks++;
     }
 
-    DEBUG('a', "Initializing address space, num pages %d, size %d\n",
-          numPages, size);
-    // first, set up the translation
-    pageTable = new TranslationEntry[numPages];
+    entry->valid = FALSE;
+    entry->physicalPage = -1;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    machine->FlushTranslationCache(); // the old translation may be cached
+    return TRUE;
+}
 
-    for (i = 0; i < numPages; i++)
+//----------------------------------------------------------------------
+// AddrSpace::RefillTLB
+// 	Handle a TLB miss on virtual page "vpn": page it in if need be,
+//	then load its translation into the TLB, so that the faulting
+//	instruction can be retried.
+//
+//	Returns FALSE if "vpn" can't be paged in (see PageIn).
+//----------------------------------------------------------------------
+
+bool AddrSpace::RefillTLB(unsigned int vpn)
+{
+    if (!PageIn(vpn))
+        return FALSE;
+    tlbManager->Refill(&pageTable[vpn]);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a write to virtual page "vpn", which is mapped read-only
+//	because it is shared with other processes: give this process a
+//	private, writable copy of the page, so that the faulting
+//	instruction can be retried.
+//
+//	Returns FALSE if the page isn't a shared one (so the write is
+//	really an error), or if there is no frame for the copy.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOnWrite(unsigned int vpn)
+{
+    TranslationEntry *entry;
+    int frame;
+
+    if (vpn >= numPages || !pageTable[vpn].valid || !pageTable[vpn].readOnly)
+        return FALSE;
+    entry = &pageTable[vpn];
+
+    addrLock->P();
+    frame = frameTable->Allocate(this, vpn, entry);
+    addrLock->V();
+    if (frame < 0)
+        return FALSE;
+
+    DEBUG('a', "Copying shared virtual page %d from frame %d to frame %d\n",
+          vpn, entry->physicalPage, frame);
+    machine->InvalidateDecoded(frame); // new contents
+    memcpy(&machine->mainMemory[frame * PageSize],
+           &machine->mainMemory[entry->physicalPage * PageSize], PageSize);
+    if (tlbManager != NULL) // drop the read-only mapping
+        tlbManager->Forget(entry->physicalPage);
+
+    entry->physicalPage = frame;
+    entry->readOnly = FALSE;
+    entry->use = TRUE;
+    entry->dirty = TRUE; // there's no other copy of it now
+    machine->FlushTranslationCache(); // the read-only mapping may be cached
+
+    addrLock->P();
+    frameTable->Unpin(frame);
+    addrLock->V();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::OpenSegment
+// 	Return the id of the shared memory segment called "name", making
+//	it with room for "size" bytes if there is none (see
+//	ShmTable::Create).  This address space holds the segment from now
+//	until it detaches it or goes away, so the id can't be freed, or
+//	handed to another segment, before it is attached.
+//
+//	Returns -1 if the segment can't be made.
+//----------------------------------------------------------------------
+
+int AddrSpace::OpenSegment(char *name, int size)
+{
+    int id;
+
+    addrLock->P();
+    id = shmTable->Create(name, size);
+    if (id >= 0 && shmHeld[id] == NULL)
     {
-        pageTable[i].virtualPage = i; // for now, virtual page # = phys page #
-        pageTable[i].physicalPage = gPhysPageBitMap->Find();
-        pageTable[i].valid = TRUE;
-        pageTable[i].use = FALSE;
-        pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE; // if the code segment was entirely on
-                                       // a separate page, we could set its
-                                       // pages to be read-only
-        // printf("Physic Pages %d \n", pageTable[i].physicalPage);
+        shmHeld[id] = shmTable->Get(id);
+        shmHeld[id]->refs++;
     }
-
     addrLock->V();
+    return id;
+}
 
-    // then, copy in the code and data segments into memory
-    if (noffH.code.size > 0)
+//----------------------------------------------------------------------
+// AddrSpace::Attach
+// 	Map shared memory segment "id" into the first run of free pages
+//	of the region past the stack that is big enough, so that this
+//	process reads and writes the very frames other processes that
+//	attach it do.  The pages are valid from the start: they never
+//	fault, and are never paged out.
+//
+//	Returns the virtual address of the segment, or -1 if this address
+//	space doesn't hold segment "id" (it hasn't asked for it with
+//	OpenSegment), it is attached here already, or there is no room.
+//----------------------------------------------------------------------
+
+int AddrSpace::Attach(int id)
+{
+    SharedSegment *seg;
+    int first = -1, run = 0;
+    unsigned int i;
+
+    addrLock->P();
+    seg = (pageTable != NULL && id >= 0 && id < MaxSharedSegments) ? shmHeld[id] : NULL;
+    for (i = 0; seg != NULL && i < ShmRegionPages; i++)
     {
-        for (i = 0; i < numPages; i++)
-            executable->ReadAt(&(machine->mainMemory[noffH.code.virtualAddr]) + (pageTable[i].physicalPage * PageSize), PageSize, noffH.code.inFileAddr + (i * PageSize));
+        if (shmMap[i] == seg)
+        { // attached already
+            first = -1;
+            break;
+        }
+        run = (shmMap[i] == NULL) ? run + 1 : 0;
+        if (first < 0 && run == seg->numPages)
+            first = i + 1 - run;
+    }
+    if (first < 0)
+    {
+        addrLock->V();
+        return -1;
     }
 
-    if (noffH.initData.size > 0)
+    for (i = 0; i < (unsigned)seg->numPages; i++)
     {
-        for (i = 0; i < numPages; i++)
-            executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]) + (pageTable[i].physicalPage * PageSize), PageSize, noffH.initData.inFileAddr + (i * PageSize));
+        TranslationEntry *entry = &pageTable[numPages + first + i];
+
+        frameTable->Share(seg->frames[i]);
+        entry->physicalPage = seg->frames[i];
+        entry->use = FALSE;
+        entry->dirty = FALSE;
+        entry->readOnly = FALSE;
+        entry->valid = TRUE;
+        shmMap[first + i] = seg;
     }
+    addrLock->V();
 
-    delete executable;
+    DEBUG('a', "Attached shared memory %s at virtual page %d\n",
+          seg->name, numPages + first);
+    return (numPages + first) * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Detach
+// 	Unmap the shared memory segment attached at virtual address
+//	"addr", and let go of its frames and of the segment itself.  The
+//	segment is freed if no other address space holds it.
+//
+//	Returns FALSE if no segment starts at "addr".
+//----------------------------------------------------------------------
+
+bool AddrSpace::Detach(int addr)
+{
+    SharedSegment *seg;
+    unsigned int first, i;
+
+    if (addr < 0 || addr % PageSize != 0 ||
+        (unsigned)addr / PageSize < numPages || (unsigned)addr / PageSize >= tableSize)
+        return FALSE;
+    first = addr / PageSize - numPages;
+    seg = shmMap[first];
+    if (seg == NULL || (first > 0 && shmMap[first - 1] == seg))
+        return FALSE; // not the start of a segment
+
+    addrLock->P();
+    for (i = first; i < first + seg->numPages; i++)
+    {
+        TranslationEntry *entry = &pageTable[numPages + i];
+
+        if (tlbManager != NULL) // drop the mapping from the TLB
+            tlbManager->Forget(entry->physicalPage);
+        frameTable->Free(entry->physicalPage);
+        entry->valid = FALSE;
+        entry->physicalPage = -1;
+        shmMap[i] = NULL;
+    }
+    for (i = 0; i < MaxSharedSegments; i++)
+        if (shmHeld[i] == seg)
+            shmHeld[i] = NULL;
+    shmTable->Release(seg);
+    addrLock->V();
+
+    machine->FlushTranslationCache(); // the mapping may be cached
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Deallocate an address space: release the frames and swap slots
+//	it holds, let go of the shared code, and close the executable if
+//	we kept it open for demand paging.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-    int i;
+    unsigned int i;
+
+    for (i = 0; i < ShmRegionPages; i++)
+        if (shmMap[i] != NULL && (i == 0 || shmMap[i - 1] != shmMap[i]))
+            Detach((numPages + i) * PageSize);
 
+    addrLock->P();
+    for (i = 0; i < MaxSharedSegments; i++) // held, but never attached
+        if (shmHeld[i] != NULL)
+            shmTable->Release(shmHeld[i]);
     for (i = 0; i < numPages; i++)
     {
-        gPhysPageBitMap->Clear(pageTable[i].physicalPage);
+        if (pageTable[i].valid && !pageTable[i].readOnly) // not shared
+            frameTable->Free(pageTable[i].physicalPage);
+        if (swapSlot[i] >= 0)
+            swap->Free(swapSlot[i]);
     }
+    if (text != NULL)
+        textCache->Release(text);
+    addrLock->V();
 
-    delete pageTable;
+    if (machine->pageTable == pageTable) // its translations may be cached
+        machine->FlushTranslationCache();
+    if (tlbManager != NULL) // ... or in the TLB
+        tlbManager->Forget(pageTable, tableSize);
+    delete[] pageTable;
+    delete[] swapSlot;
+    delete pagingFile;
 }
 
 //----------------------------------------------------------------------
@@ -256,11 +724,14 @@ void AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	With a TLB, flush it unless its entries are tagged with
+//	address space IDs (the use and dirty bits are saved first).
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState()
 {
+    if (tlbManager != NULL)
+        tlbManager->SaveState();
 }
 
 //----------------------------------------------------------------------
@@ -268,11 +739,20 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      Tell the machine where to find the page table, and make it
+//	forget translations cached from the previous one.  With a TLB,
+//	the machine never sees the page table; just switch to our address
+//	space ID (if IDs are in use), and let TLB misses load the rest.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState()
 {
+    if (tlbManager != NULL)
+    {
+        tlbManager->RestoreState(&asid, &asidEpoch);
+        return;
+    }
     machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
+    machine->pageTableSize = tableSize;
+    machine->FlushTranslationCache();
 }
@@ -15,6 +15,9 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "noff.h"
+#include "textcache.h"
+#include "shm.h"
 
 #define UserStackSize 1024 // increase this as necessary!
 
@@ -33,6 +36,24 @@ public:
   void SaveState();    // Save/restore address space-specific
   void RestoreState(); // info on a context switch
 
+  bool PageIn(unsigned int vpn);  // Load a page on a page fault;
+                                  // FALSE if it can't be done
+  bool PageOut(unsigned int vpn); // Evict a page, saving it to swap
+                                  // if need be; FALSE if swap is full
+  bool CopyOnWrite(unsigned int vpn); // Make a shared code page private
+                                      // on a write to it
+  bool RefillTLB(unsigned int vpn);   // Handle a TLB miss (paging in
+                                      // if need be)
+
+  int OpenSegment(char *name, int size); // Id of shared memory segment
+                                         // "name", held until detached;
+                                         // -1 if it can't be made
+  int Attach(int id);                 // Map shared memory segment "id"
+                                      // after the stack; its address,
+                                      // or -1
+  bool Detach(int addr);              // Unmap the segment attached at
+                                      // "addr", and let go of it
+
   bool usedPhyPage[NumPhysPages];
 
 private:
@@ -40,8 +61,37 @@ private:
                                // for now!
   unsigned int numPages;       // Number of pages in the virtual
                                // address space
+  unsigned int tableSize;      // Entries in the page table: numPages,
+                               // then ShmRegionPages for shared memory
+  SharedSegment *shmMap[ShmRegionPages];
+                               // segment mapped at each page of the
+                               // shared memory region, or NULL
+  SharedSegment *shmHeld[MaxSharedSegments];
+                               // segment this process holds, by id,
+                               // or NULL
   bool Load(char *fileName);   // Load the program into memory
                                // return false if not found
+
+  NoffHeader noffH;     // where the segments are in the executable
+  OpenFile *pagingFile; // executable, kept open to page from, if demand paging
+  int *swapSlot;        // where each page is in the swap file,
+                        // or -1 if it has never been written out
+  SharedText *text;     // code pages shared with other processes
+                        // running the same executable, or NULL
+  int asid;             // address space ID, if the TLB uses them,
+  int asidEpoch;        // and when it was handed out
+
+  void Setup(OpenFile *file, char *name, bool lazy);
+  // Build the page table (and load
+  // the program, unless lazy)
+  bool IsSharedCode(unsigned int vpn);
+  int SharedFrame(OpenFile *file, unsigned int vpn, int frame);
+  // Frame of a shared code page,
+  // loaded if need be
+  void LoadPage(OpenFile *file, int vpn, int frame);
+  // Fill a frame with the initial
+  // contents of a virtual page
+  void InitShmRegion(); // Leave the shared memory region unmapped
 };
 
 #endif // ADDRSPACE_H
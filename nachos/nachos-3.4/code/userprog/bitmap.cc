@@ -2,6 +2,13 @@
 //	Routines to manage a bitmap -- an array of bits each of which
 //	can be either on or off.  Represented as an array of integers.
 //
+//	Searches and counts work a word at a time: a word with every bit
+//	set is skipped in one test, the first clear bit in a word is found
+//	by counting its trailing zeros, and the number of clear bits is
+//	kept up to date as bits change, rather than counted.  The bits of
+//	the last word past the end of the bitmap are kept set, so that
+//	searches never find them.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -22,8 +29,11 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++)
-        Clear(i);
+    for (int i = 0; i < numWords; i++)
+        map[i] = 0;
+    SetPadding();
+    numClear = numBits;
+    firstFree = 0;
 }
 
 //----------------------------------------------------------------------
@@ -45,8 +55,14 @@ BitMap::~BitMap()
 
 void BitMap::Mark(int which)
 {
+    unsigned int bit = 1u << (which % BitsInWord);
+
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    if (!(map[which / BitsInWord] & bit))
+    {
+        map[which / BitsInWord] |= bit;
+        numClear--;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -58,8 +74,15 @@ void BitMap::Mark(int which)
 
 void BitMap::Clear(int which)
 {
+    unsigned int bit = 1u << (which % BitsInWord);
+
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (map[which / BitsInWord] & bit)
+    {
+        map[which / BitsInWord] &= ~bit;
+        numClear++;
+        firstFree = min(firstFree, which / BitsInWord);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -90,15 +113,72 @@ bool BitMap::Test(int which)
 
 int BitMap::Find()
 {
-    for (int i = 0; i < numBits; i++)
-        if (!Test(i))
+    int i = NextClear(0);
+
+    if (i != -1)
+        Mark(i);
+    return i;
+}
+
+//----------------------------------------------------------------------
+// BitMap::NextClear
+// 	Return the number of the first clear bit at or after "from", or
+//	-1 if there is none.  Full words are skipped a word at a time.
+//----------------------------------------------------------------------
+
+int BitMap::NextClear(int from)
+{
+    int w = from / BitsInWord;
+    unsigned int clear;
+    bool whole; // scanning every word from firstFree on?
+
+    if (from >= numBits)
+        return -1;
+    if (w < firstFree)
+    {
+        w = firstFree; // nothing clear before this word
+        from = w * BitsInWord;
+    }
+    whole = (w == firstFree && from % BitsInWord == 0);
+    for (; w < numWords; w++)
+    {
+        clear = ~map[w];
+        if (w == from / BitsInWord)
+            clear &= ~0u << (from % BitsInWord);
+        if (clear != 0)
         {
-            Mark(i);
-            return i;
+            if (whole)
+                firstFree = w; // the words skipped are full
+            return w * BitsInWord + __builtin_ctz(clear);
         }
+    }
+    if (whole)
+        firstFree = numWords;
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::NextSet
+// 	Return the number of the first set bit at or after "from" -- the
+//	end of the run of clear bits starting at "from" -- or "numBits"
+//	if there is none.
+//----------------------------------------------------------------------
+
+int BitMap::NextSet(int from)
+{
+    unsigned int set;
+
+    for (int w = from / BitsInWord; w < numWords; w++)
+    {
+        set = map[w];
+        if (w == from / BitsInWord)
+            set &= ~0u << (from % BitsInWord);
+        if (set != 0)
+            return min(w * BitsInWord + __builtin_ctz(set), numBits);
+    }
+    return numBits;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -107,11 +187,90 @@ int BitMap::Find()
 
 int BitMap::NumClear()
 {
-    int count = 0;
+    return numClear;
+}
 
-    for (int i = 0; i < numBits; i++)
-        if (!Test(i))
-            count++;
+//----------------------------------------------------------------------
+// BitMap::RunLength
+// 	Return how many bits, starting at "start", are clear in a row --
+//	but stop counting at "most".
+//----------------------------------------------------------------------
+
+int BitMap::RunLength(int start, int most)
+{
+    if (start >= numBits || Test(start))
+        return 0;
+    return min(NextSet(start) - start, most);
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Find room for "want" bits in a row, without setting them: the
+//	shortest run of clear bits that is at least "want" long (best
+//	fit), or if there is none, the longest run.  Ties go to the
+//	lowest run.
+//
+//	Within that run, start at the first multiple of "align" instead
+//	of the start of the run if that makes the "want" bits straddle
+//	fewer multiples of "align" -- for disk sectors, tracks -- and
+//	there is still room.
+//
+//	Return the number of the first bit, and the number of bits
+//	(at most "want") that are clear from there in "*length".  If no
+//	bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int BitMap::FindRun(int want, int align, int *length)
+{
+    int best = -1, bestLength = 0;
+    int start, run, aligned;
+
+    for (start = NextClear(0); start != -1; start = NextClear(start + run))
+    {
+        run = NextSet(start) - start;
+        if (best == -1 || (bestLength < want && run > bestLength)
+            || (run >= want && run < bestLength))
+        {
+            best = start;
+            bestLength = run;
+        }
+    }
+    if (best == -1)
+    {
+        *length = 0;
+        return -1;
+    }
+
+    aligned = divRoundUp(best, align) * align;
+    if (aligned + want <= best + bestLength
+        && (aligned + want - 1) / align - aligned / align
+            < (best + want - 1) / align - best / align)
+    {
+        bestLength -= aligned - best;
+        best = aligned;
+    }
+    *length = min(want, bestLength);
+    return best;
+}
+
+//----------------------------------------------------------------------
+// BitMap::NumClearRuns
+// 	Return the number of runs of clear bits in the bitmap (how
+//	fragmented the free space is), and the length of the longest
+//	in "*longest".
+//----------------------------------------------------------------------
+
+int BitMap::NumClearRuns(int *longest)
+{
+    int count = 0, start, run;
+
+    *longest = 0;
+    for (start = NextClear(0); start != -1; start = NextClear(start + run))
+    {
+        run = NextSet(start) - start;
+        count++;
+        *longest = max(*longest, run);
+    }
     return count;
 }
 
@@ -144,6 +303,23 @@ void BitMap::Print()
 void BitMap::FetchFrom(OpenFile *file)
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    SetPadding();
+    numClear = 0;
+    for (int i = 0; i < numWords; i++)
+        numClear += BitsInWord - __builtin_popcount(map[i]);
+    firstFree = 0;
+}
+
+//----------------------------------------------------------------------
+// BitMap::SetPadding
+// 	Set the bits of the last word that are past the end of the
+//	bitmap, so that no search stops at them.
+//----------------------------------------------------------------------
+
+void BitMap::SetPadding()
+{
+    if (numBits % BitsInWord != 0)
+        map[numWords - 1] |= ~0u << (numBits % BitsInWord);
 }
 
 //----------------------------------------------------------------------
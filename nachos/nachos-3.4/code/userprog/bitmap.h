@@ -45,6 +45,20 @@ public:
                          // effect, set the bit.
                          // If no bits are clear, return -1.
   int NumClear();        // Return the number of clear bits
+  int NextClear(int from); // Return the # of the first clear bit at or
+                           // after "from" (without setting it), or -1
+
+  int RunLength(int start, int most); // Number of clear bits from "start"
+                                      // on, up to "most" of them
+  int FindRun(int want, int align, int *length);
+                                      // Start of the run of clear bits
+                                      // that best fits "want" of them
+                                      // (or the longest run); its length
+                                      // from there, up to "want", goes in
+                                      // "*length".  -1 if none are clear.
+  int NumClearRuns(int *longest);     // Number of runs of clear bits;
+                                      // the longest one's length goes
+                                      // in "*longest"
 
   void Print(); // Print contents of bitmap
 
@@ -60,6 +74,12 @@ private:
                      //  multiple of the number of bits in
                      //  a word)
   unsigned int *map; // bit storage
+  int numClear;      // number of clear bits
+  int firstFree;     // words before this one have no clear bits
+
+  int NextSet(int from); // # of the first set bit at or after "from",
+                         // or numBits if none
+  void SetPadding();     // Set the unused bits of the last word
 };
 
 #endif // BITMAP_H
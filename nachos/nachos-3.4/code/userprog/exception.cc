@@ -28,6 +28,13 @@
 #define MaxFileLength 32
 #define MAX_NUM_LENGTH 11
 
+/// @brief Get the descriptor table of the current process
+/// @return The open files of the current process
+FileTable *CurrentFiles()
+{
+    return pTab->GetFiles(currentThread->processID);
+}
+
 /// @brief Print buffer to console instantly
 /// @param buffer Buffer to print
 void SynchPrint(char *buffer)
@@ -79,14 +86,12 @@ void IncreasePC()
     machine->WriteRegister(NextPCReg, counter + 4); // Write Next Program Counter + 4 to Next Program Counter
 }
 
-/// @brief Copy buffer from User memory space to System memory space
+/// @brief Copy a string from User memory space to System memory space
 /// @param virtAddr User space address
 /// @param limit Limit of buffer
-/// @return Buffer from kernel space
+/// @return Buffer from kernel space (null-terminated, limit + 1 bytes)
 char *User2System(int virtAddr, int limit)
 {
-    int i; // Index of buffer
-    int oneChar;
     char *kernelBuf = NULL;
     kernelBuf = new char[limit + 1]; // For terminal string
     if (kernelBuf == NULL)
@@ -94,17 +99,11 @@ char *User2System(int virtAddr, int limit)
 
     memset(kernelBuf, 0, limit + 1); // Fill buffer with 0
 
-    for (i = 0; i < limit; i++)
-    {
-        machine->ReadMem(virtAddr + i, 1, &oneChar); // Read 1 byte from User memory space
-        kernelBuf[i] = (char)oneChar;
-        if (oneChar == 0)
-            break;
-    }
+    machine->CopyInString(virtAddr, kernelBuf, limit); // Copy up to the end of string, a page at a time
     return kernelBuf;
 }
 
-/// @brief Copy buffer from System memory space to User memory space
+/// @brief Copy a string from System memory space to User memory space
 /// @param virtAddr User space address
 /// @param len Limit of buffer
 /// @param buffer Buffer from kernel space
@@ -116,15 +115,12 @@ int System2User(int virtAddr, int len, char *buffer)
     if (len == 0)
         return NULL;
     int i = 0;
-    int oneChar = 0;
-    // Write memory to buffer until the end of buffer or the end of string
-    do
-    {
-        oneChar = (int)buffer[i];
-        machine->WriteMem(virtAddr + i, 1, oneChar); // Write 1 byte to User memory space
+    // Copy until the end of buffer or the end of string (including the null byte)
+    while (i < len && buffer[i] != 0)
+        i++;
+    if (i < len)
         i++;
-    } while (i < len && oneChar != 0);
-    return i;
+    return machine->CopyOut(virtAddr, buffer, i); // Write to User memory space, a page at a time
 }
 
 //----------------------------------------------------------------------
@@ -155,6 +151,9 @@ void Handle_SC_Halt()
 {
     DEBUG('a', "Shutdown, initiated by user program.\n");
     printf("Shutdown, initiated by user program.\n");
+#ifdef FILESYS
+    fileSystem->Sync(); // write back what the programs wrote
+#endif
     interrupt->Halt();
 }
 
@@ -462,36 +461,28 @@ void Handle_SC_Open()
 
     filename = User2System(virtAddr, MaxFileLength); // Copy buffer from User memory space to System memory space
 
-    int allocatedSlot = fileSystem->GetAllocatedSlot(); // Find free slot in file system
-
-    if (allocatedSlot != -1) // If there is free slot
+    if (type == READ_WRITE || type == READ_ONLY) // Handle ReadOnly and ReadWrite file cases
     {
-        if (type == READ_WRITE || type == READ_ONLY) // Handle ReadOnly and ReadWrite file cases
-        {
-            fileSystem->file_table[allocatedSlot] = fileSystem->Open(filename, type); // Open file with filename and type
+        OpenFile *file = fileSystem->Open(filename, type); // Open file with filename and type
 
-            if (fileSystem->file_table[allocatedSlot] != NULL)
-            {
-                result = allocatedSlot; // Success, return free slot for normal file
-            }
-            else // Open file failed
-            {
-                result = -1; // Failed to open file, return -1
-            }
-        }
-        else if (type == STDIN) // ConsoleInput: stdin
+        if (file == NULL) // Open file failed
         {
-            result = 0; // Success, return 0 for STDIN
+            result = -1; // Failed to open file, return -1
         }
-        else // ConsoleOutput: stdout
+        else
         {
-            result = 1; // Success, return 1 for STDOUT
+            result = CurrentFiles()->Add(file, type); // Success, return a free descriptor of the process
+            if (result == -1)                        // No free descriptor (the file is closed)
+                SynchPrint("No free slot");
         }
     }
-    else // No free slot
+    else if (type == STDIN) // ConsoleInput: stdin
+    {
+        result = 0; // Success, return 0 for STDIN
+    }
+    else // ConsoleOutput: stdout
     {
-        SynchPrint("No free slot");
-        result = -1; // Failed to open file, return -1
+        result = 1; // Success, return 1 for STDOUT
     }
 
     if (filename != NULL)
@@ -507,11 +498,9 @@ void Handle_SC_Close()
     int id = machine->ReadRegister(4); // Read file descriptor (OpenFileId) PARAMETER from register 4
     int result = -2;                   // Result of the function
 
-    if (id >= 0 && id < MAX_FILE && fileSystem->file_table[id] != NULL) // If file descriptor is in range and file is exist
+    if (CurrentFiles()->Close(id)) // If file descriptor is open, drop it (the file is closed with its last descriptor)
     {
-        delete fileSystem->file_table[id]; // Delete file
-        fileSystem->file_table[id] = NULL; // Set file to NULL
-        result = 0;                        // Success, return 0
+        result = 0; // Success, return 0
     }
     else // If file descriptor is out of range or file is not exist
     {
@@ -530,45 +519,51 @@ void Handle_SC_Read()
     int id = machine->ReadRegister(6);        // Read file descriptor PARAMETER from register 6
     int OldPos;                               // Old position of file (current position of file before read)
     int NewPos;                               // New position of file (current position of file after read)
-    char *buf;                                // Kernel buffer
+    char *buf = NULL;                         // Kernel buffer
     int result = -3;                          // Value return for Read function
 
-    if (id < 0 || id >= MAX_FILE) // If file descriptor is out of range
-    {
-        SynchPrint("\nOut of range file descriptor.");
-        result = -1; // Failed to read file, return -1
-    }
+    FileHandle *handle = CurrentFiles()->Get(id); // Open file the descriptor refers to
 
-    else if (fileSystem->file_table[id] == NULL) // If file is not exist
+    if (handle == NULL) // If file descriptor is out of range or file is not exist
     {
         SynchPrint("\nCan't open file because file is not exist.");
         result = -1; // Failed to read file, return -1
     }
 
-    else if (fileSystem->file_table[id]->type == STDOUT) // If file is stdout
+    else if (handle->type == STDOUT || handle->type == PIPE_WRITE) // If file is stdout or the write end of a pipe
     {
         SynchPrint("\nCan't open console output to read.");
         result = -1; // Failed to read file, return -1
     }
     else // If file is exist
     {
-        OldPos = fileSystem->file_table[id]->GetCurrentPos(); // Get current position of file
-        buf = User2System(virtAddr, charcount);               // Convert buffer to system space
-        if (fileSystem->file_table[id]->type == STDIN)        // If file is stdin
+        buf = new char[charcount + 1]; // Kernel buffer for the data read
+        memset(buf, 0, charcount + 1);
+        if (handle->type == STDIN) // If file is stdin
         {
             int size = gSynchConsole->Read(buf, charcount); // Read from console
-            System2User(virtAddr, size, buf);               // Copy buffer to user space
+            machine->CopyOut(virtAddr, buf, size);          // Copy buffer to user space
             result = size;                                  // Write size to register 2, Success
         }
-        else if ((fileSystem->file_table[id]->Read(buf, charcount)) > 0) // If file is normal file
+        else if (handle->type == PIPE_READ) // If file is the read end of a pipe
         {
-            NewPos = fileSystem->file_table[id]->GetCurrentPos(); // Actual number of bytes read
-            System2User(virtAddr, NewPos - OldPos, buf);          // Copy buffer to user space
-            result = NewPos - OldPos;                             // Write number of bytes read to register 2, Success
+            int size = handle->pipe->Read(buf, charcount); // Wait for data from the pipe
+            machine->CopyOut(virtAddr, buf, size);         // Copy buffer to user space
+            result = (size > 0) ? size : -2;               // -2 once the write end is closed and the pipe empty (EOF)
         }
-        else // If file is empty
+        else // If file is normal file
         {
-            result = -2; // Write -2 to register 2, Success
+            OldPos = handle->file->GetCurrentPos(); // Get current position of file
+            if (handle->file->Read(buf, charcount) > 0)
+            {
+                NewPos = handle->file->GetCurrentPos();           // Actual number of bytes read
+                machine->CopyOut(virtAddr, buf, NewPos - OldPos); // Copy buffer to user space
+                result = NewPos - OldPos;                         // Write number of bytes read to register 2, Success
+            }
+            else // If file is empty
+            {
+                result = -2; // Write -2 to register 2, Success
+            }
         }
     }
     if (result != -1 && result != -3) // If read file successfully
@@ -588,37 +583,40 @@ void Handle_SC_Write()
     int id = machine->ReadRegister(6);        // Read file descriptor PARAMETER from register 6
     int OldPos;                               // Old position of file (current position of file before write)
     int NewPos;                               // New position of file (current position of file after write)
-    char *buf;                                // Kernel buffer
+    char *buf = NULL;                         // Kernel buffer
     int result = -3;                          // Value return for Write function
 
-    if (id < 0 || id > MAX_FILE) // If file descriptor is out of range
-    {
-        SynchPrint("\nOut of range file descriptor.");
-        result = -1; // Failed to write file, return -1
-    }
-    else if (fileSystem->file_table[id] == NULL) // If file is not exist
+    FileHandle *handle = CurrentFiles()->Get(id); // Open file the descriptor refers to
+
+    if (handle == NULL) // If file descriptor is out of range or file is not exist
     {
         SynchPrint("\nCan't open file because file is not exist.");
         result = -1; // Failed to write file, return -1
     }
-    else if (fileSystem->file_table[id]->type == READ_ONLY || fileSystem->file_table[id]->type == STDIN) // If file is read only or stdin
+    else if (handle->type == READ_ONLY || handle->type == STDIN || handle->type == PIPE_READ) // If file is read only, stdin or the read end of a pipe
     {
         SynchPrint("\nCan't write file because file is only read or stdin.");
         result = -1; // Failed to write file, return -1
     }
     else // If file is exist
     {
-        OldPos = fileSystem->file_table[id]->GetCurrentPos(); // Get current position of file
-        buf = User2System(virtAddr, charcount);               // Convert buffer to system space
-        if (fileSystem->file_table[id]->type == READ_WRITE)   // If file is read and write file
+        buf = new char[charcount + 1]; // Kernel copy of the data (null-terminated)
+        memset(buf, 0, charcount + 1);
+        machine->CopyIn(virtAddr, buf, charcount); // Copy buffer to system space, a page at a time
+        if (handle->type == READ_WRITE)            // If file is read and write file
         {
-            if ((fileSystem->file_table[id]->Write(buf, charcount)) > 0) // Write to file
+            OldPos = handle->file->GetCurrentPos();       // Get current position of file
+            if ((handle->file->Write(buf, charcount)) > 0) // Write to file
             {
-                NewPos = fileSystem->file_table[id]->GetCurrentPos();
+                NewPos = handle->file->GetCurrentPos();
                 result = NewPos - OldPos;
             }
         }
-        else if (fileSystem->file_table[id]->type == STDOUT) // If file is stdout
+        else if (handle->type == PIPE_WRITE) // If file is the write end of a pipe
+        {
+            result = handle->pipe->Write(buf, charcount); // Wait for room in the pipe; -1 if nobody reads it
+        }
+        else if (handle->type == STDOUT) // If file is stdout
         {
             int i = 0;
             while (buf[i] != 0 && buf[i] != '\n') // Write buffer to console until the end of buffer or the end of line
@@ -702,6 +700,11 @@ void Handle_SC_Exit()
     // Write result to register 2
     machine->WriteRegister(2, res);
 
+#ifdef FILESYS
+    // What the process wrote reaches the disk once it exits
+    fileSystem->Sync();
+#endif
+
     // Free space and finish current thread
     currentThread->FreeSpace(); // Free space for current thread
     currentThread->Finish();    // Finish current thread
@@ -812,6 +815,80 @@ void Handle_SC_Up()
     return IncreasePC();
 }
 
+/// @brief Handle system call SC_OpenSemaphore from user program (Get the handle of a semaphore by name)
+void Handle_SC_OpenSemaphore()
+{
+    int result = -1;
+    // Read system call parameters
+    int virtAddr = machine->ReadRegister(4); // Read virtual address of semaphore name PARAM
+
+    // Copy buffer from User memory space to System memory space
+    char *name = User2System(virtAddr, MaxFileLength);
+
+    if (name == NULL) // If name is NULL (not enough memory in system)
+    {
+        SynchPrint("Not enough memory in system\n");
+    }
+    else
+    {
+        // Look the name up in the hash chains of STable
+        result = sTab->Open(name);
+
+        // Check if semaphore is not exist
+        if (result == -1)
+        {
+            SynchPrint("Can't open semaphore because semaphore is not exist\n");
+        }
+    }
+    delete[] name;
+
+    // Write result to register 2
+    machine->WriteRegister(2, result);
+
+    // Increase Program Counter
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_DownH from user program (Down by handle: no name to copy in or look up)
+void Handle_SC_DownH()
+{
+    int handle = machine->ReadRegister(4); // Read semaphore handle PARAM
+
+    int result = sTab->Wait(handle); // Down semaphore with handle
+
+    // Check if semaphore is not exist
+    if (result == -1)
+    {
+        SynchPrint("Can't down semaphore because semaphore is not exist\n");
+    }
+
+    // Write result to register 2
+    machine->WriteRegister(2, result);
+
+    // Increase Program Counter
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_UpH from user program (Up by handle: no name to copy in or look up)
+void Handle_SC_UpH()
+{
+    int handle = machine->ReadRegister(4); // Read semaphore handle PARAM
+
+    int result = sTab->Signal(handle); // Up semaphore with handle
+
+    // Check if semaphore is not exist
+    if (result == -1)
+    {
+        SynchPrint("Can't up semaphore because semaphore is not exist\n");
+    }
+
+    // Write result to register 2
+    machine->WriteRegister(2, result);
+
+    // Increase Program Counter
+    return IncreasePC();
+}
+
 /// @brief Handle system call SC_Seek from user program
 void Handle_SC_Seek()
 {
@@ -819,39 +896,191 @@ void Handle_SC_Seek()
     int id = machine->ReadRegister(5);  // Read file descriptor PARAMETER from register 5
     int result = -1;                    // Result of the function
 
-    if (id < 0 || id >= MAX_FILE) // If file descriptor is out of range
+    FileHandle *handle = CurrentFiles()->Get(id); // Open file the descriptor refers to
+
+    if (handle == NULL) // If file descriptor is out of range or file is not exist
     {
-        SynchPrint("\nOut of range file descriptor.");
+        SynchPrint("\nCan't open file because file is not exist.");
     }
 
-    if (fileSystem->file_table[id] == NULL) // If file is not exist
+    else if (handle->file == NULL) // If file is stdin, stdout or a pipe
     {
-        SynchPrint("\nCan't open file because file is not exist.");
+        SynchPrint("\nCan't seek console input or output, or a pipe.");
     }
 
-    else if (fileSystem->file_table[id]->type == STDIN || fileSystem->file_table[id]->type == STDOUT) // If file is stdin or stdout
+    else
     {
-        SynchPrint("\nCan't seek console input or output.");
+        pos = (pos == -1) ? handle->file->Length() : pos; // If position is -1, set position to the end of file
+
+        if (pos > handle->file->Length() || pos < 0) // If position is out of range
+        {
+            SynchPrint("\nOut of range position.");
+        }
+
+        else // If position is in range
+        {
+            handle->file->Seek(pos); // Set position of file to pos (shared by every descriptor of the file)
+            result = pos;            // Success, return pos
+        }
     }
 
-    pos = (pos == -1) ? fileSystem->file_table[id]->Length() : pos; // If position is -1, set position to the end of file
+    // Write result to register 2
+    machine->WriteRegister(2, result);
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_Pipe from user program (Create a pipe)
+void Handle_SC_Pipe()
+{
+    int virtAddr = machine->ReadRegister(4); // Virtual address of the descriptor pair PARAMETER from register 4
+    FileTable *files = CurrentFiles();       // Descriptor table of the process
+    PipeBuffer *pipe = new PipeBuffer();     // Deleted by the handles of its ends, once both are closed
+    int result = -1;                         // Result of the function
+
+    int readEnd = files->AddPipe(pipe, PIPE_READ);
+    int writeEnd = (readEnd == -1) ? -1 : files->AddPipe(pipe, PIPE_WRITE);
 
-    if (pos > fileSystem->file_table[id]->Length() || pos < 0) // If position is out of range
+    if (readEnd == -1 || writeEnd == -1) // No free descriptor
     {
-        SynchPrint("\nOut of range position.");
+        SynchPrint("No free slot\n");
+        if (readEnd != -1)
+            files->Close(readEnd); // Last end closed, this deletes the pipe
+        else
+            delete pipe; // No end was ever opened
     }
+    else
+    {
+        int fds[2];
+        fds[0] = WordToMachine(readEnd);
+        fds[1] = WordToMachine(writeEnd);
+        if (machine->CopyOut(virtAddr, (char *)fds, sizeof(fds)) == sizeof(fds)) // Copy the descriptors to user space
+        {
+            result = 0; // Success, return 0
+        }
+        else // Bad address
+        {
+            files->Close(readEnd);
+            files->Close(writeEnd);
+        }
+    }
+
+    machine->WriteRegister(2, result); // Write result to register 2
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_GetTime from user program
+void Handle_SC_GetTime()
+{
+    int elapsed = (int)((HostTime() - stats->hostStartTime) * 1000); // Host milliseconds since Nachos started
+
+    machine->WriteRegister(2, elapsed); // Write result to register 2
+    return IncreasePC();
+}
 
-    else // If position is in range
+/// @brief Handle system call SC_ShmCreate from user program (Get or make a shared memory segment)
+void Handle_SC_ShmCreate()
+{
+    int virtAddr = machine->ReadRegister(4); // Virtual address of the name PARAMETER from register 4
+    int size = machine->ReadRegister(5);     // Size in bytes PARAMETER from register 5
+    int result = -1;                         // Result of the function
+
+    char *name = User2System(virtAddr, MaxFileLength); // Copy buffer from User memory space to System memory space
+
+    if (name != NULL)
     {
-        fileSystem->file_table[id]->Seek(pos); // Set position of file to pos
-        result = pos;                          // Success, return pos
+        if (currentThread->space != NULL)
+            result = currentThread->space->OpenSegment(name, size); // Id of the segment, made if need be
+        delete[] name;
     }
 
-    // Write result to register 2
-    machine->WriteRegister(2, result);
+    machine->WriteRegister(2, result); // Write result to register 2
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_ShmAttach from user program (Map a shared memory segment)
+void Handle_SC_ShmAttach()
+{
+    int id = machine->ReadRegister(4); // Id of the segment PARAMETER from register 4
+    int result = -1;                   // Result of the function
+
+    if (currentThread->space != NULL)
+        result = currentThread->space->Attach(id); // Virtual address of the segment
+
+    machine->WriteRegister(2, (result == -1) ? 0 : result); // Write result to register 2 (a NULL pointer on failure)
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_ShmDetach from user program (Unmap a shared memory segment)
+void Handle_SC_ShmDetach()
+{
+    int addr = machine->ReadRegister(4); // Address of the segment PARAMETER from register 4
+    int result = -1;                     // Result of the function
+
+    if (currentThread->space != NULL && currentThread->space->Detach(addr))
+        result = 0; // Success, return 0
+
+    machine->WriteRegister(2, result); // Write result to register 2
+    return IncreasePC();
+}
+
+/// @brief Handle system call SC_FutexWait from user program (Sleep on a word of memory, if it still holds a value)
+void Handle_SC_FutexWait()
+{
+    int virtAddr = machine->ReadRegister(4); // Address of the word PARAMETER from register 4
+    int expected = machine->ReadRegister(5); // Value the caller saw PARAMETER from register 5
+
+    int result = futexTable->Wait(virtAddr, expected); // 0 once woken up
+
+    machine->WriteRegister(2, result); // Write result to register 2
     return IncreasePC();
 }
 
+/// @brief Handle system call SC_FutexWake from user program (Wake threads sleeping on a word of memory)
+void Handle_SC_FutexWake()
+{
+    int virtAddr = machine->ReadRegister(4); // Address of the word PARAMETER from register 4
+    int count = machine->ReadRegister(5);    // Most threads to wake PARAMETER from register 5
+
+    int result = futexTable->Wake(virtAddr, count); // Number of threads woken up
+
+    machine->WriteRegister(2, result); // Write result to register 2
+    return IncreasePC();
+}
+
+/// @brief Handle a page fault (or TLB miss): bring the missing page of the current process into memory (and the TLB)
+void Handle_PageFault()
+{
+    int virtAddr = machine->ReadRegister(BadVAddrReg); // Faulting virtual address
+
+    unsigned vpn = (unsigned)virtAddr / PageSize;
+    bool handled = FALSE;
+
+    // With a TLB, this is a TLB miss, which may also be a page fault
+    if (currentThread->space != NULL)
+        handled = (machine->tlb != NULL) ? currentThread->space->RefillTLB(vpn)
+                                         : currentThread->space->PageIn(vpn);
+
+    // The faulting instruction is retried on return, so don't increase PC
+    if (handled)
+        return;
+
+    printf("PageFaultException: No valid translation found\n");
+    interrupt->Halt();
+}
+
+/// @brief Handle a write to a read-only page: give the current process its own copy if the page is shared code
+void Handle_ReadOnly()
+{
+    int virtAddr = machine->ReadRegister(BadVAddrReg); // Faulting virtual address
+
+    // The faulting instruction is retried on return, so don't increase PC
+    if (currentThread->space != NULL && currentThread->space->CopyOnWrite((unsigned)virtAddr / PageSize))
+        return;
+
+    printf("ReadOnlyException: Write attempted to page marked \"read-only\"\n");
+    interrupt->Halt();
+}
+
 /// @brief Exception handler for user program system calls
 /// @param which Type of exception
 void ExceptionHandler(ExceptionType which)
@@ -911,6 +1140,26 @@ void ExceptionHandler(ExceptionType which)
             return Handle_SC_Up();
         case SC_Seek:
             return Handle_SC_Seek();
+        case SC_GetTime:
+            return Handle_SC_GetTime();
+        case SC_Pipe:
+            return Handle_SC_Pipe();
+        case SC_ShmCreate:
+            return Handle_SC_ShmCreate();
+        case SC_ShmAttach:
+            return Handle_SC_ShmAttach();
+        case SC_ShmDetach:
+            return Handle_SC_ShmDetach();
+        case SC_OpenSemaphore:
+            return Handle_SC_OpenSemaphore();
+        case SC_DownH:
+            return Handle_SC_DownH();
+        case SC_UpH:
+            return Handle_SC_UpH();
+        case SC_FutexWait:
+            return Handle_SC_FutexWait();
+        case SC_FutexWake:
+            return Handle_SC_FutexWake();
         default:
             interrupt->Halt();
             break;
@@ -918,13 +1167,9 @@ void ExceptionHandler(ExceptionType which)
     case NoException:
         return;
     case PageFaultException:
-        printf("PageFaultException: No valid translation found\n");
-        interrupt->Halt();
-        break;
+        return Handle_PageFault();
     case ReadOnlyException:
-        printf("ReadOnlyException: Write attempted to page marked \"read-only\"\n");
-        interrupt->Halt();
-        break;
+        return Handle_ReadOnly();
     case BusErrorException:
         printf("BusErrorException: Translation resulted in an invalid physical address\n");
         interrupt->Halt();
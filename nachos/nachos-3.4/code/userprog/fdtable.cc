@@ -0,0 +1,198 @@
+#include "fdtable.h"
+
+//************************************************************************************************
+//************************************** FILE HANDLE *********************************************
+//************************************************************************************************
+
+/// @brief Constructor
+/// @param openFile The open file (NULL for the console)
+/// @param mode Open mode of the file
+FileHandle::FileHandle(OpenFile *openFile, int mode)
+{
+    file = openFile;
+    pipe = NULL;
+    type = mode;
+    refCount = 1;
+}
+
+/// @brief Constructor for one end of a pipe
+/// @param pipeBuffer The pipe
+/// @param mode PIPE_READ or PIPE_WRITE
+FileHandle::FileHandle(PipeBuffer *pipeBuffer, int mode)
+{
+    file = NULL;
+    pipe = pipeBuffer;
+    type = mode;
+    refCount = 1;
+    pipe->Open(type == PIPE_WRITE);
+}
+
+/// @brief Destructor: close the file, or the end of the pipe (and the pipe
+/// itself, once both of its ends are closed)
+FileHandle::~FileHandle()
+{
+    if (file != NULL)
+        delete file;
+    if (pipe != NULL && pipe->Close(type == PIPE_WRITE))
+        delete pipe;
+}
+
+//************************************************************************************************
+//*************************** CONSTRUCTOR AND DESTRUCTOR *****************************************
+//************************************************************************************************
+
+/// @brief Constructor: descriptors 0 and 1 are the console, the rest are unused
+FileTable::FileTable()
+{
+    size = FileTableSize;
+    slots = new FileHandle *[size];
+    nextFree = new int[size];
+    for (int i = 0; i < size; i++)
+    {
+        slots[i] = NULL;
+        nextFree[i] = (i + 1 < size) ? i + 1 : -1;
+    }
+    freeList = 0;
+
+    Add(NULL, STDIN);  // 0
+    Add(NULL, STDOUT); // 1
+}
+
+/// @brief Destructor
+FileTable::~FileTable()
+{
+    CloseAll();
+    delete[] slots;
+    delete[] nextFree;
+}
+
+//************************************************************************************************
+//************************************ METHODS ***************************************************
+//************************************************************************************************
+
+/// @brief Double the number of descriptors, putting the new ones on the free list
+void FileTable::Grow()
+{
+    int newSize = size * 2;
+    FileHandle **newSlots = new FileHandle *[newSize];
+    int *newNext = new int[newSize];
+
+    for (int i = 0; i < size; i++)
+    {
+        newSlots[i] = slots[i];
+        newNext[i] = nextFree[i];
+    }
+    for (int i = size; i < newSize; i++)
+    {
+        newSlots[i] = NULL;
+        newNext[i] = (i + 1 < newSize) ? i + 1 : freeList;
+    }
+    freeList = size;
+
+    delete[] slots;
+    delete[] nextFree;
+    slots = newSlots;
+    nextFree = newNext;
+    size = newSize;
+}
+
+/// @brief Give a new handle the first descriptor on the free list
+/// @param handle The handle, which the table takes over
+/// @return The descriptor, or -1 (deleting the handle) if the process has too many files open
+int FileTable::Install(FileHandle *handle)
+{
+    if (freeList == -1)
+    {
+        if (size >= MaxFileTableSize)
+        {
+            delete handle;
+            return -1;
+        }
+        Grow();
+    }
+
+    int fd = freeList;
+    freeList = nextFree[fd];
+    slots[fd] = handle;
+    return fd;
+}
+
+/// @brief Give a newly opened file a descriptor; the table takes the file over
+/// @param file The open file (NULL for the console)
+/// @param type Open mode of the file
+/// @return The descriptor, or -1 (closing the file) if the process has too many files open
+int FileTable::Add(OpenFile *file, int type)
+{
+    return Install(new FileHandle(file, type));
+}
+
+/// @brief Give one end of a pipe a descriptor
+/// @param pipe The pipe
+/// @param type PIPE_READ or PIPE_WRITE
+/// @return The descriptor, or -1 (leaving the pipe untouched) if the process has too many files open
+int FileTable::AddPipe(PipeBuffer *pipe, int type)
+{
+    if (freeList == -1 && size >= MaxFileTableSize)
+        return -1;
+    return Install(new FileHandle(pipe, type));
+}
+
+/// @brief Get the handle a descriptor refers to
+/// @param fd The descriptor
+/// @return The handle, or NULL if the descriptor is out of range or unused
+FileHandle *FileTable::Get(int fd)
+{
+    if (fd < 0 || fd >= size)
+        return NULL;
+    return slots[fd];
+}
+
+/// @brief Drop a descriptor; the file is closed if no other descriptor refers to it
+/// @param fd The descriptor
+/// @return True if the descriptor was open, otherwise false
+bool FileTable::Close(int fd)
+{
+    FileHandle *handle = Get(fd);
+
+    if (handle == NULL)
+        return FALSE;
+
+    slots[fd] = NULL;
+    nextFree[fd] = freeList;
+    freeList = fd;
+
+    if (--handle->refCount == 0)
+        delete handle;
+    return TRUE;
+}
+
+/// @brief Drop every descriptor still open
+void FileTable::CloseAll()
+{
+    for (int i = 0; i < size; i++)
+        if (slots[i] != NULL)
+            Close(i);
+}
+
+/// @brief Make this table refer to the same open files as "parent", under the
+/// same descriptors; the files are shared, seek position and all
+/// @param parent The table to copy
+void FileTable::Inherit(FileTable *parent)
+{
+    CloseAll();
+    while (size < parent->size)
+        Grow();
+
+    freeList = -1;
+    for (int i = size - 1; i >= 0; i--)
+    {
+        slots[i] = (i < parent->size) ? parent->slots[i] : NULL;
+        if (slots[i] != NULL)
+            slots[i]->refCount++;
+        else
+        {
+            nextFree[i] = freeList;
+            freeList = i;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "openfile.h"
+#include "pipe.h"
+
+#define FileTableSize 16       // Descriptors a process starts with
+#define MaxFileTableSize 1024  // Most descriptors a process may have open
+
+#define PIPE_READ 4  // Open modes of the two ends of a pipe, after those
+#define PIPE_WRITE 5 // of files (cf. openfile.h)
+
+/// @brief An open file, shared by every descriptor that refers to it (in one
+/// process, or in a parent and the children that inherited it), so they all
+/// see the same seek position. It is closed when the last one is.
+/// A handle may also be one end of a pipe.
+class FileHandle
+{
+public:
+    OpenFile *file;   // The file (NULL for the console or a pipe)
+    PipeBuffer *pipe; // The pipe (NULL unless type is PIPE_READ or PIPE_WRITE)
+    int type;         // Open mode (READ_WRITE, READ_ONLY, STDIN, STDOUT, PIPE_READ or PIPE_WRITE)
+    int refCount;     // Descriptors referring to it
+
+public:
+    FileHandle(OpenFile *openFile, int mode);
+    FileHandle(PipeBuffer *pipeBuffer, int mode);
+    ~FileHandle();
+};
+
+/// @brief The descriptor table of a process: descriptor i refers to slots[i].
+/// Unused descriptors are kept on a free list, so opening a file takes the
+/// same time however many are open; the table doubles when it is full.
+/// Descriptors 0 and 1 start out as the console input and output.
+///
+/// Only the thread of the process uses its table. Handles are shared, but
+/// their reference counts change without an interrupt in between.
+class FileTable
+{
+private:
+    FileHandle **slots; // Handle of each descriptor, or NULL
+    int *nextFree;      // Next unused descriptor after each unused one
+    int freeList;       // First descriptor on the free list, or -1
+    int size;           // Number of descriptors
+
+    void Grow();                     // Double the number of descriptors
+    int Install(FileHandle *handle); // Give a new handle a descriptor
+
+public: // Constructor and Destructor
+    FileTable();
+    ~FileTable(); // Closes every descriptor still open
+
+public: // Methods
+    int Add(OpenFile *file, int type);       // Give a newly opened file a descriptor
+    int AddPipe(PipeBuffer *pipe, int type); // Give one end of a pipe a descriptor
+    FileHandle *Get(int fd);                 // Handle of a descriptor, or NULL
+    bool Close(int fd);                      // Drop a descriptor
+    void CloseAll();                         // Drop every descriptor (at exit)
+    void Inherit(FileTable *parent);         // Share the open files of "parent"
+};
+
+#endif // FDTABLE_H
@@ -0,0 +1,260 @@
+// frametable.cc
+//	Routines to allocate physical page frames to user pages, and
+//	to choose which page to evict when there are none left.
+//
+//	All of these are called with "addrLock" held.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "frametable.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table; every frame starts out free.
+//
+//	"whichPolicy" -- how to choose the page to evict when memory is full
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(ReplacementPolicy whichPolicy)
+{
+    policy = whichPolicy;
+    for (int i = 0; i < NumPhysPages; i++)
+    {
+        frames[i].space = NULL;
+        frames[i].vpn = -1;
+        frames[i].entry = NULL;
+        frames[i].pinned = FALSE;
+        frames[i].loadTime = 0;
+        frames[i].age = 0;
+        frames[i].refs = 0;
+    }
+    loads = 0;
+    clockHand = 0;
+}
+
+FrameTable::~FrameTable()
+{
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PolicyName
+// 	The name of a replacement policy, as given on the command line.
+//----------------------------------------------------------------------
+
+const char *
+FrameTable::PolicyName(ReplacementPolicy policy)
+{
+    switch (policy)
+    {
+    case FIFOReplacement:
+        return "fifo";
+    case ClockReplacement:
+        return "clock";
+    case LRUReplacement:
+        return "lru";
+    default:
+        return "none";
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Allocate
+// 	Find a frame to hold virtual page "vpn" of "space", whose page
+//	table entry is "entry".  Take a free frame if there is one, or
+//	one freed by dropping the cached code of programs that have
+//	exited; otherwise evict the page the replacement policy picks.
+//
+//	If "space" is NULL, the frame is for a code page shared by
+//	several address spaces (see textcache.h).  It stays pinned until
+//	the text cache frees it, since there is no single page table
+//	entry to invalidate.
+//
+//	The frame is returned pinned, so that it can't be chosen as a
+//	victim while the caller fills it (which may block); the caller
+//	must Unpin it once the page is loaded.
+//
+//	Returns -1 if there is no free frame and nothing can be evicted.
+//----------------------------------------------------------------------
+
+int FrameTable::Allocate(AddrSpace *space, int vpn, TranslationEntry *entry)
+{
+    int frame = gPhysPageBitMap->Find();
+
+    if (frame < 0 && textCache->Reclaim())
+        frame = gPhysPageBitMap->Find();
+    if (frame < 0 && policy != NoReplacement)
+    {
+        frame = ChooseVictim();
+        if (frame >= 0)
+        {
+            DEBUG('a', "Evicting virtual page %d from frame %d\n",
+                  frames[frame].vpn, frame);
+            if (!frames[frame].space->PageOut(frames[frame].vpn))
+                return -1; // out of swap
+        }
+    }
+    if (frame < 0)
+        return -1;
+
+    frames[frame].space = space;
+    frames[frame].vpn = vpn;
+    frames[frame].entry = entry;
+    frames[frame].pinned = TRUE;
+    frames[frame].loadTime = loads++;
+    frames[frame].age = 1u << 31; // count the load as a use
+    frames[frame].refs = 1;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Unpin
+// 	The page in "frame" has been loaded and its translation is
+//	valid; from now on it may be evicted.
+//----------------------------------------------------------------------
+
+void FrameTable::Unpin(int frame)
+{
+    ASSERT(frames[frame].space != NULL);
+    frames[frame].pinned = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share
+// 	Someone else holds "frame" too -- another address space mapping
+//	a shared memory segment.  It won't be freed until they let go.
+//----------------------------------------------------------------------
+
+void FrameTable::Share(int frame)
+{
+    ASSERT(frames[frame].refs > 0);
+    frames[frame].refs++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Free
+// 	The page in "frame" is no longer needed by one of its holders;
+//	once none is left, make the frame free.
+//----------------------------------------------------------------------
+
+void FrameTable::Free(int frame)
+{
+    ASSERT(frames[frame].refs > 0);
+    if (--frames[frame].refs > 0)
+        return;
+    frames[frame].space = NULL;
+    frames[frame].vpn = -1;
+    frames[frame].entry = NULL;
+    frames[frame].pinned = FALSE;
+    gPhysPageBitMap->Clear(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ChooseVictim
+// 	Pick a frame to evict, according to the replacement policy.
+//	Returns -1 if every frame is pinned.
+//----------------------------------------------------------------------
+
+int FrameTable::ChooseVictim()
+{
+    if (tlbManager != NULL) // the TLB has the latest use bits
+        tlbManager->Sync();
+    switch (policy)
+    {
+    case FIFOReplacement:
+        return OldestFrame();
+    case ClockReplacement:
+        return ClockFrame();
+    case LRUReplacement:
+        return AgedFrame();
+    default:
+        return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::OldestFrame
+// 	FIFO: the page that has been in memory the longest, regardless
+//	of how it has been used since.
+//----------------------------------------------------------------------
+
+int FrameTable::OldestFrame()
+{
+    int victim = -1;
+
+    for (int i = 0; i < NumPhysPages; i++)
+        if (frames[i].space != NULL && !frames[i].pinned &&
+            (victim < 0 || frames[i].loadTime < frames[victim].loadTime))
+            victim = i;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ClockFrame
+// 	Clock: sweep the frames in order, giving every page whose "use"
+//	bit is set a second chance (clearing the bit), and evict the
+//	first page found with the bit clear.  Two sweeps are always
+//	enough, since the first clears every bit.
+//
+//	Clearing a use bit must flush the machine's translation cache,
+//	or hits there would never set it again.
+//----------------------------------------------------------------------
+
+int FrameTable::ClockFrame()
+{
+    int victim = -1;
+    bool cleared = FALSE;
+
+    for (int n = 0; n < 2 * NumPhysPages && victim < 0; n++)
+    {
+        FrameInfo *f = &frames[clockHand];
+
+        if (f->space != NULL && !f->pinned)
+        {
+            if (f->entry->use)
+            {
+                f->entry->use = FALSE;
+                cleared = TRUE;
+            }
+            else
+                victim = clockHand;
+        }
+        clockHand = (clockHand + 1) % NumPhysPages;
+    }
+    if (cleared)
+        machine->FlushTranslationCache();
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::AgedFrame
+// 	LRU approximation by aging: at every eviction, shift each
+//	page's age right and put its "use" bit in at the top, then clear
+//	the use bits.  The page with the smallest age has gone longest
+//	without being used (to the resolution of one eviction).
+//----------------------------------------------------------------------
+
+int FrameTable::AgedFrame()
+{
+    int victim = -1;
+
+    for (int i = 0; i < NumPhysPages; i++)
+    {
+        FrameInfo *f = &frames[i];
+
+        if (f->space == NULL)
+            continue;
+        f->age >>= 1;
+        if (f->entry->use)
+            f->age |= 1u << 31;
+        f->entry->use = FALSE;
+        if (!f->pinned && (victim < 0 || f->age < frames[victim].age))
+            victim = i;
+    }
+    machine->FlushTranslationCache(); // we cleared the use bits
+    return victim;
+}
@@ -0,0 +1,80 @@
+// frametable.h
+//	Data structures to keep track of physical page frames: which
+//	frames are free, and for every frame in use, the address space
+//	and virtual page it holds (the reverse of the page tables).
+//
+//	When memory runs out, the frame table picks a victim frame to
+//	evict, according to the replacement policy chosen at startup.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class AddrSpace;
+
+// Ways of choosing the frame to evict when memory is full.
+
+enum ReplacementPolicy
+{
+  NoReplacement,    // never evict; allocation fails when memory is full
+  FIFOReplacement,  // evict the page that was loaded longest ago
+  ClockReplacement, // second chance, using the "use" bits
+  LRUReplacement    // least recently used, approximated by aging
+};
+
+// What the frame table knows about one physical frame.
+
+class FrameInfo
+{
+public:
+  AddrSpace *space;        // owner of the page in this frame; NULL if
+                           // free, or shared code (see textcache.h)
+  int vpn;                 // which of its virtual pages is here
+  TranslationEntry *entry; // its page table entry
+  bool pinned;             // being loaded; can't be evicted yet
+  int loadTime;            // when it was loaded, for FIFO
+  unsigned int age;        // recent "use" history, for LRU; the
+                           // most recent period is the top bit
+  int refs;                // holders of the frame; it is only freed
+                           // when the last one lets go (see shm.h)
+};
+
+class FrameTable
+{
+public:
+  FrameTable(ReplacementPolicy whichPolicy); // Initialize, all frames free
+  ~FrameTable();
+
+  int Allocate(AddrSpace *space, int vpn, TranslationEntry *entry);
+  // Find a frame for a page, evicting
+  // another page if need be.  The frame
+  // stays pinned until Unpin.  -1 if
+  // no frame can be had.  A NULL
+  // "space" means shared code, which
+  // is never evicted.
+  void Unpin(int frame); // The page is loaded; it can be evicted
+  void Share(int frame); // One more holder of the (shared) frame
+  void Free(int frame);  // A holder is done with the page; the
+                         // frame is free once they all are
+
+  static const char *PolicyName(ReplacementPolicy policy);
+
+private:
+  ReplacementPolicy policy; // how to choose a victim
+  FrameInfo frames[NumPhysPages];
+  int loads;     // pages loaded so far, for FIFO
+  int clockHand; // next frame the clock looks at
+
+  int ChooseVictim(); // Pick an unpinned frame to evict, per "policy"
+  int OldestFrame();  // FIFO
+  int ClockFrame();   // Clock
+  int AgedFrame();    // LRU approximation
+};
+
+#endif // FRAMETABLE_H
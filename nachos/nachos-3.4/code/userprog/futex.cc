@@ -0,0 +1,92 @@
+#include "futex.h"
+#include "system.h"
+
+//************************************************************************************************
+//*************************** CONSTRUCTOR AND DESTRUCTOR *****************************************
+//************************************************************************************************
+
+/// @brief Constructor: nobody is waiting
+FutexTable::FutexTable()
+{
+    for (int i = 0; i < FutexBuckets; i++)
+        buckets[i] = NULL;
+}
+
+/// @brief Destructor (the waiters live on the stacks of their threads)
+FutexTable::~FutexTable()
+{
+}
+
+//************************************************************************************************
+//************************************ METHODS ***************************************************
+//************************************************************************************************
+
+/// @brief Put the current thread to sleep on a word of user memory, unless the
+/// word has changed since the caller looked at it: checking the word and going
+/// to sleep happen with interrupts off, so a FutexWake in between can't be lost
+/// @param virtAddr Virtual address of the word, in the current address space
+/// @param expected The value the caller saw in the word
+/// @return 0 once woken up, -1 if the word didn't hold expected or the address is bad
+int FutexTable::Wait(int virtAddr, int expected)
+{
+    int key = machine->UserWordAddress(virtAddr); // Pages the word in if need be
+    if (key == -1)
+    {
+        return -1;
+    }
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int value = WordToHost(*(unsigned int *)&machine->mainMemory[key]);
+    if (value != expected)
+    {
+        (void)interrupt->SetLevel(oldLevel);
+        return -1;
+    }
+
+    FutexWaiter waiter;
+    waiter.key = key;
+    waiter.thread = currentThread;
+    waiter.next = NULL;
+
+    FutexWaiter **tail = &buckets[(key / 4) % FutexBuckets];
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+    *tail = &waiter;
+
+    currentThread->Sleep(); // Wake takes us off the chain
+    (void)interrupt->SetLevel(oldLevel);
+    return 0;
+}
+
+/// @brief Wake the threads that have waited longest on a word of user memory
+/// @param virtAddr Virtual address of the word, in the current address space
+/// @param count Most threads to wake
+/// @return Number of threads woken up, -1 if the address is bad
+int FutexTable::Wake(int virtAddr, int count)
+{
+    int key = machine->UserWordAddress(virtAddr);
+    if (key == -1)
+    {
+        return -1;
+    }
+
+    int woken = 0;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    FutexWaiter **link = &buckets[(key / 4) % FutexBuckets];
+    while (*link != NULL && woken < count)
+    {
+        FutexWaiter *waiter = *link;
+        if (waiter->key == key)
+        {
+            *link = waiter->next;
+            scheduler->WakeUp(waiter->thread);
+            woken++;
+        }
+        else
+        {
+            link = &waiter->next;
+        }
+    }
+    (void)interrupt->SetLevel(oldLevel);
+    return woken;
+}
@@ -0,0 +1,41 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "thread.h"
+
+#define FutexBuckets 64 // Hash chains of waiting threads
+
+/// @brief A thread asleep in FutexWait, on the kernel stack of that thread
+class FutexWaiter
+{
+public:
+    int key;            // Physical address of the word it waits on
+    Thread *thread;     // The thread
+    FutexWaiter *next;  // Next waiter in the same hash chain
+};
+
+/// @brief The kernel half of user-space locks (cf. test/umutex.c). A lock is a
+/// word of memory that user programs change with LL/SC, and only call the
+/// kernel to sleep when it is taken (FutexWait) or to wake a sleeper when
+/// they release it (FutexWake).
+///
+/// Waiters are known by the physical address of their word, so that processes
+/// that map a shared memory segment at different addresses still meet. Frames
+/// of shared segments are never paged out, so the address stays the same
+/// while anyone waits on it; words in private memory can only be waited on
+/// by the one thread of their process, which nobody would wake.
+class FutexTable
+{
+private:
+    FutexWaiter *buckets[FutexBuckets]; // Waiters, oldest first, by hash of key
+
+public: // Constructor and Destructor
+    FutexTable();
+    ~FutexTable();
+
+public: // Methods
+    int Wait(int virtAddr, int expected); // Sleep if the word still holds expected
+    int Wake(int virtAddr, int count);    // Wake up to count waiters on the word
+};
+
+#endif // FUTEX_H
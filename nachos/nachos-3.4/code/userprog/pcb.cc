@@ -27,6 +27,7 @@ PCB::PCB(int id)
         parentID = 0;
 
     thread = NULL;
+    files = new FileTable();
 }
 
 /// @brief Destructor
@@ -38,6 +39,8 @@ PCB::~PCB()
         delete exitsem;
     if (mutex != NULL)
         delete mutex;
+    if (files != NULL)
+        delete files;
     if (thread != NULL)
     {
         thread->FreeSpace();
@@ -69,6 +72,11 @@ char *PCB::GetFileName()
     return filename;
 }
 
+FileTable *PCB::GetFiles()
+{
+    return files;
+}
+
 char *PCB::GetNameThread()
 {
     return thread->getName();
@@ -3,6 +3,7 @@
 
 #include "thread.h"
 #include "synch.h"
+#include "fdtable.h"
 
 /// @brief Process Control Block
 class PCB
@@ -18,6 +19,8 @@ private:
     Thread *thread; // Thread of the program
     char filename[32];
 
+    FileTable *files; // Open files of the process
+
 public:
     int parentID; // ID of the parent process
 
@@ -31,6 +34,7 @@ public: // Getters and Setters
     int GetExitCode();
     char *GetNameThread();
     char *GetFileName();
+    FileTable *GetFiles();
 
     void SetExitCode(int ec);
     void SetFileName(char *name);
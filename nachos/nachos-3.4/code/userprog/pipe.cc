@@ -0,0 +1,150 @@
+#include "pipe.h"
+
+//************************************************************************************************
+//*************************** CONSTRUCTOR AND DESTRUCTOR *****************************************
+//************************************************************************************************
+
+/// @brief Constructor: an empty pipe with neither end open
+PipeBuffer::PipeBuffer()
+{
+    buffer = new char[PipeSize];
+    head = 0;
+    count = 0;
+
+    readers = 0;
+    writers = 0;
+
+    mutex = new Semaphore("PipeMutex", 1);
+    canRead = new Semaphore("PipeRead", 0);
+    canWrite = new Semaphore("PipeWrite", 0);
+    waitingReaders = 0;
+    waitingWriters = 0;
+}
+
+/// @brief Destructor
+PipeBuffer::~PipeBuffer()
+{
+    delete[] buffer;
+    delete mutex;
+    delete canRead;
+    delete canWrite;
+}
+
+//************************************************************************************************
+//************************************ METHODS ***************************************************
+//************************************************************************************************
+
+/// @brief Wake every reader waiting for data (called with the mutex held)
+void PipeBuffer::WakeReaders()
+{
+    for (; waitingReaders > 0; waitingReaders--)
+        canRead->V();
+}
+
+/// @brief Wake every writer waiting for space (called with the mutex held)
+void PipeBuffer::WakeWriters()
+{
+    for (; waitingWriters > 0; waitingWriters--)
+        canWrite->V();
+}
+
+/// @brief Note that a handle on one end of the pipe has been opened
+/// @param writeEnd True for the write end, false for the read end
+void PipeBuffer::Open(bool writeEnd)
+{
+    mutex->P();
+    if (writeEnd)
+        writers++;
+    else
+        readers++;
+    mutex->V();
+}
+
+/// @brief Note that a handle on one end has been closed, waking whoever was
+/// waiting on the other end if it was the last one
+/// @param writeEnd True for the write end, false for the read end
+/// @return True if neither end is open any more, so the pipe can be deleted
+bool PipeBuffer::Close(bool writeEnd)
+{
+    mutex->P();
+    if (writeEnd)
+    {
+        if (--writers == 0)
+            WakeReaders(); // to see end of file
+    }
+    else
+    {
+        if (--readers == 0)
+            WakeWriters(); // to see that nobody will read
+    }
+    bool unused = (readers == 0 && writers == 0);
+    mutex->V();
+    return unused;
+}
+
+/// @brief Read from the pipe, waiting until there is something to read
+/// @param into Kernel buffer for the data
+/// @param numBytes Most bytes to read
+/// @return Number of bytes read; 0 at end of file (pipe empty, write end closed)
+int PipeBuffer::Read(char *into, int numBytes)
+{
+    mutex->P();
+    while (count == 0 && writers > 0)
+    {
+        waitingReaders++;
+        mutex->V();
+        canRead->P();
+        mutex->P();
+    }
+
+    if (numBytes > count)
+        numBytes = count;
+    for (int i = 0; i < numBytes; i++)
+        into[i] = buffer[(head + i) % PipeSize];
+    head = (head + numBytes) % PipeSize;
+    count -= numBytes;
+
+    if (numBytes > 0)
+        WakeWriters();
+    mutex->V();
+    return numBytes;
+}
+
+/// @brief Write all of the data into the pipe, waiting for space whenever it
+/// is full; readers are woken as each piece goes in
+/// @param from Kernel buffer holding the data
+/// @param numBytes Number of bytes to write
+/// @return Number of bytes written, or -1 if the read end is closed
+int PipeBuffer::Write(char *from, int numBytes)
+{
+    int done = 0;
+
+    mutex->P();
+    while (done < numBytes)
+    {
+        if (readers == 0)
+        {
+            mutex->V();
+            return -1;
+        }
+        if (count == PipeSize)
+        {
+            waitingWriters++;
+            mutex->V();
+            canWrite->P();
+            mutex->P();
+            continue;
+        }
+
+        int n = numBytes - done;
+        if (n > PipeSize - count)
+            n = PipeSize - count;
+        for (int i = 0; i < n; i++)
+            buffer[(head + count + i) % PipeSize] = from[done + i];
+        count += n;
+        done += n;
+        WakeReaders();
+    }
+    mutex->V();
+    return done;
+}
@@ -0,0 +1,48 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "synch.h"
+
+#define PipeSize 4096 // Bytes a pipe holds before writers block
+
+/// @brief A one-way channel between processes: a bounded ring buffer in the
+/// kernel, read through one descriptor and written through another (cf.
+/// Handle_SC_Pipe). A reader blocks while the pipe is empty, and a writer
+/// while it is full, so data goes from one process to the next without
+/// touching the disk.
+///
+/// The pipe counts the handles open on each end: once every write end is
+/// closed, readers get what is left and then end of file; once every read
+/// end is closed, writes fail.
+class PipeBuffer
+{
+private:
+    char *buffer; // PipeSize bytes, used as a ring
+    int head;     // Index of the oldest byte in the buffer
+    int count;    // Number of bytes in the buffer
+
+    int readers; // Handles open on the read end
+    int writers; // Handles open on the write end
+
+    Semaphore *mutex;    // Mutual exclusion on all of the above
+    Semaphore *canRead;  // Wakes readers waiting for data
+    Semaphore *canWrite; // Wakes writers waiting for space
+    int waitingReaders;  // Readers asleep on canRead
+    int waitingWriters;  // Writers asleep on canWrite
+
+    void WakeReaders();
+    void WakeWriters();
+
+public: // Constructor and Destructor
+    PipeBuffer();
+    ~PipeBuffer();
+
+public: // Methods
+    void Open(bool writeEnd);  // A handle on one end has been opened
+    bool Close(bool writeEnd); // One has been closed; true once no end is left
+
+    int Read(char *into, int numBytes);  // Wait for data, then read up to numBytes
+    int Write(char *from, int numBytes); // Write numBytes, waiting for space
+};
+
+#endif // PIPE_H
@@ -50,10 +50,11 @@ void StartProcess(char *filename)
         printf("Unable to open file %s\n", filename);
         return;
     }
-    space = new AddrSpace(executable);
-    currentThread->space = space;
+    delete executable; // close file; the address space opens its own,
+                       // and keeps it open if it is demand paged
 
-    delete executable; // close file
+    space = new AddrSpace(filename);
+    currentThread->space = space;
 
     space->InitRegisters(); // set the initial register values
     space->RestoreState();  // load page table register
@@ -103,3 +104,88 @@ void ConsoleTest(char *in, char *out)
             return; // if q, quit
     }
 }
+
+//----------------------------------------------------------------------
+// BitMapTest
+// 	Benchmark the bitmap operations that allocate physical pages and
+//	disk sectors: on a bitmap that is nearly full, repeatedly count
+//	the clear bits, allocate the first clear one, and free a random
+//	bit.  Do it with the bitmap's word-at-a-time Find and NumClear,
+//	and with the bit-at-a-time versions they replaced, for bitmaps
+//	of 128, 1024 and 1M bits, and report the host time per round.
+//----------------------------------------------------------------------
+
+#define BitMapWork 20000000 // about this many bits tested, per size
+
+// The bit-at-a-time versions, for comparison.
+
+static int SlowNumClear(BitMap *map, int numBits)
+{
+    int count = 0;
+
+    for (int i = 0; i < numBits; i++)
+        if (!map->Test(i))
+            count++;
+    return count;
+}
+
+static int SlowFind(BitMap *map, int numBits)
+{
+    for (int i = 0; i < numBits; i++)
+        if (!map->Test(i))
+        {
+            map->Mark(i);
+            return i;
+        }
+    return -1;
+}
+
+static double TimeBitMap(int numBits, int rounds, bool slow)
+{
+    BitMap *map = new BitMap(numBits);
+    int i, clear = 0;
+    double start;
+
+    RandomInit(numBits);
+    for (i = 0; i < numBits; i++) // about 1 in 64 bits clear
+        if (Random() % 64 != 0)
+            map->Mark(i);
+
+    start = HostTime();
+    for (i = 0; i < rounds; i++)
+    {
+        if (slow)
+        {
+            clear += SlowNumClear(map, numBits);
+            SlowFind(map, numBits);
+        }
+        else
+        {
+            clear += map->NumClear();
+            map->Find();
+        }
+        map->Clear(Random() % numBits);
+    }
+    start = HostTime() - start;
+    delete map;
+    return (clear >= 0) ? start : 0; // use "clear", so it is computed
+}
+
+void BitMapTest()
+{
+    int sizes[3] = {128, 1024, 1024 * 1024};
+    int rounds;
+    double slow, fast;
+
+    printf("Bitmap Find + NumClear + Clear, host time per round:\n");
+    for (int i = 0; i < 3; i++)
+    {
+        rounds = max(BitMapWork / sizes[i], 10);
+        slow = TimeBitMap(sizes[i], rounds, TRUE);
+        fast = TimeBitMap(sizes[i], rounds, FALSE);
+        printf("  %7d bits: bit at a time %10.1f ns, word at a time "
+               "%8.1f ns (%.0fx)\n",
+               sizes[i], 1e9 * slow / rounds, 1e9 * fast / rounds,
+               slow / max(fast, 1e-9));
+    }
+}
@@ -87,6 +87,14 @@ char *PTable::GetFileName(int pID)
     return pcb[pID]->GetFileName();
 }
 
+/// @brief Get the descriptor table of the process
+/// @param pID Process ID
+/// @return The open files of the process
+FileTable *PTable::GetFiles(int pID)
+{
+    return pcb[pID]->GetFiles();
+}
+
 //************************************************************************************************
 //********************************* SYSTEM CALL HANDLERS *****************************************
 //************************************************************************************************
@@ -129,6 +137,7 @@ int PTable::ExecUpdate(char *name)
     pcb[ID] = new PCB(ID);
     pcb[ID]->SetFileName(name);
     pcb[ID]->parentID = currentThread->processID;
+    pcb[ID]->GetFiles()->Inherit(pcb[currentThread->processID]->GetFiles()); // The child shares the files its parent has open
 
     int pID = pcb[ID]->Exec(name, ID);
 
@@ -183,6 +192,7 @@ int PTable::ExitUpdate(int exitcode)
     // If the process is the main process, call Halt().
     if (pID == 0)
     {
+        pcb[0]->GetFiles()->CloseAll();
         currentThread->FreeSpace();
         interrupt->Halt();
         return 0;
@@ -195,6 +205,9 @@ int PTable::ExitUpdate(int exitcode)
         return -1;
     }
 
+    // Close the files the process left open.
+    pcb[pID]->GetFiles()->CloseAll();
+
     // Set the exit code for the process.
     pcb[pID]->SetExitCode(exitcode);
     pcb[pcb[pID]->parentID]->DecNumWait();
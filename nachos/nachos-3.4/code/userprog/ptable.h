@@ -32,6 +32,7 @@ public:
     void Remove(int pid); // When the process ends, delete the processID from the array that manages it
 
     char *GetFileName(int id); // Return the name of the process
+    FileTable *GetFiles(int id); // Return the open files of the process
 };
 
 #endif // PTABLE_H
\ No newline at end of file
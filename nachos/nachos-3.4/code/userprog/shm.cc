@@ -0,0 +1,164 @@
+// shm.cc
+//	Routines to make, find and free the memory segments that user
+//	processes share.
+//
+//	All of these are called with "addrLock" held.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "shm.h"
+
+//----------------------------------------------------------------------
+// SharedSegment::SharedSegment
+// 	Set up a segment called "segName", of "size" pages.  It has no
+//	frames until Fill.
+//----------------------------------------------------------------------
+
+SharedSegment::SharedSegment(char *segName, int size)
+{
+    name = new char[strlen(segName) + 1];
+    strcpy(name, segName);
+    numPages = size;
+    frames = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+        frames[i] = -1;
+    refs = 0;
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::~SharedSegment
+// 	Give back the segment's references to its frames.  A frame is
+//	only freed once no address space maps it either.
+//----------------------------------------------------------------------
+
+SharedSegment::~SharedSegment()
+{
+    for (int i = 0; i < numPages; i++)
+        if (frames[i] >= 0)
+            frameTable->Free(frames[i]);
+    delete[] frames;
+    delete[] name;
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::Fill
+// 	Get a frame for every page of the segment, evicting other pages
+//	if need be, and zero it.  The frames belong to no address space,
+//	so they stay pinned: the replacement policy never picks them.
+//
+//	Returns FALSE if there aren't enough frames.
+//----------------------------------------------------------------------
+
+bool SharedSegment::Fill()
+{
+    for (int i = 0; i < numPages; i++)
+    {
+        frames[i] = frameTable->Allocate(NULL, i, NULL);
+        if (frames[i] < 0)
+            return FALSE;
+        machine->InvalidateDecoded(frames[i]); // new contents
+        memset(&machine->mainMemory[frames[i] * PageSize], 0, PageSize);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::ShmTable/~ShmTable
+// 	Start out with no segments; free them all at the end.
+//----------------------------------------------------------------------
+
+ShmTable::ShmTable()
+{
+    for (int i = 0; i < MaxSharedSegments; i++)
+        segments[i] = NULL;
+    pinned = 0;
+}
+
+ShmTable::~ShmTable()
+{
+    for (int i = 0; i < MaxSharedSegments; i++)
+        if (segments[i] != NULL)
+            delete segments[i];
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Create
+// 	Return the id of the segment called "name", making it with room
+//	for "size" bytes if there is none, so that every process sharing
+//	it can simply ask for it by name.
+//
+//	The segment is not held for the caller: AddrSpace::OpenSegment
+//	does that, with "addrLock" still held, so that a new segment
+//	can't be freed before anyone has it.
+//
+//	Returns -1 if an existing segment is smaller than "size", if
+//	"size" doesn't fit in the region address spaces keep for shared
+//	memory, if segments would pin more than MaxSharedFrames frames,
+//	or if there is no room in the table or in memory.
+//----------------------------------------------------------------------
+
+int ShmTable::Create(char *name, int size)
+{
+    int i, slot = -1;
+    int numPages = divRoundUp(size, PageSize);
+
+    for (i = 0; i < MaxSharedSegments; i++)
+    {
+        if (segments[i] == NULL)
+        {
+            if (slot < 0)
+                slot = i;
+        }
+        else if (!strcmp(segments[i]->name, name))
+            return (segments[i]->numPages >= numPages) ? i : -1;
+    }
+    if (slot < 0 || size <= 0 || numPages > ShmRegionPages ||
+        pinned + numPages > MaxSharedFrames)
+        return -1;
+
+    SharedSegment *seg = new SharedSegment(name, numPages);
+    if (!seg->Fill())
+    {
+        delete seg;
+        return -1;
+    }
+    DEBUG('a', "Shared memory segment %s: %d pages\n", name, numPages);
+    segments[slot] = seg;
+    pinned += numPages;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Get
+// 	The segment with id "id", or NULL if there is none.
+//----------------------------------------------------------------------
+
+SharedSegment *
+ShmTable::Get(int id)
+{
+    if (id < 0 || id >= MaxSharedSegments)
+        return NULL;
+    return segments[id];
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Release
+// 	An address space has let go of "seg".  If no other holds it,
+//	free it: its name can then be used for a new one.
+//----------------------------------------------------------------------
+
+void ShmTable::Release(SharedSegment *seg)
+{
+    ASSERT(seg->refs > 0);
+    if (--seg->refs > 0)
+        return;
+    for (int i = 0; i < MaxSharedSegments; i++)
+        if (segments[i] == seg)
+            segments[i] = NULL;
+    pinned -= seg->numPages;
+    delete seg;
+}
@@ -0,0 +1,73 @@
+// shm.h
+//	Data structures for segments of memory shared among processes.
+//
+//	A segment is a run of physical frames, zeroed when it is made,
+//	that any process can map into its address space, in a region
+//	just past its stack (see AddrSpace::Attach).  Every process that
+//	attaches it sees the same frames, so what one writes the others
+//	read, without any copying through the kernel.  Segments are known
+//	by name, like semaphores.
+//
+//	The frames are never paged out, since that would mean finding
+//	every page table that maps them.  The segment holds a reference
+//	to each in the frame table, and so does every address space it
+//	is attached to.  To keep user programs from pinning all of
+//	memory, segments together may hold only MaxSharedFrames frames.
+//
+//	Each address space that has asked for a segment by name holds a
+//	reference to it, from ShmCreate until it detaches it (or exits),
+//	so an id stays good until then.  The segment goes away when the
+//	last of those references is let go.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "copyright.h"
+
+#define MaxSharedSegments 10 // segments that can exist at once
+#define ShmRegionPages 32    // virtual pages each address space keeps,
+                             // after its stack, for attaching segments
+#define MaxSharedFrames (NumPhysPages / 4) // frames all segments
+                                           // together can pin
+
+// One shared memory segment.
+
+class SharedSegment
+{
+public:
+  SharedSegment(char *segName, int size); // A segment of "size"
+                                          // pages, with no frames yet
+  ~SharedSegment(); // Let go of its frames
+
+  bool Fill(); // Get zeroed frames for every page;
+               // FALSE if there aren't enough
+
+  char *name;   // what processes call it
+  int numPages; // how many pages it has
+  int *frames;  // frame holding each page, -1 if none yet
+  int refs;     // address spaces holding it (see AddrSpace::OpenSegment)
+};
+
+class ShmTable
+{
+public:
+  ShmTable();  // Start with no segments
+  ~ShmTable(); // Free them all
+
+  int Create(char *name, int size); // Id of segment "name", made with
+                                    // "size" bytes if there isn't one;
+                                    // -1 if it can't be
+  SharedSegment *Get(int id);       // The segment, or NULL
+  void Release(SharedSegment *seg); // An address space let go of it;
+                                    // the last one frees it
+
+private:
+  SharedSegment *segments[MaxSharedSegments]; // NULL where unused
+  int pinned;                                 // frames they hold in all
+};
+
+#endif // SHM_H
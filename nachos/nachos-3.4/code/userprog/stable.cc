@@ -7,22 +7,23 @@
 /// @brief Default constructor
 STable::STable()
 {
-    this->bm = new BitMap(MAX_SEMAPHORE);
-    for (int i = 0; i < MAX_SEMAPHORE; i++)
+    this->size = SemTableSize;
+    this->count = 0;
+    this->semTab = new Sem *[size];
+    this->chain = new int[size];
+    this->buckets = new int[size];
+    for (int i = 0; i < size; i++)
     {
         this->semTab[i] = NULL;
+        this->chain[i] = -1;
+        this->buckets[i] = -1;
     }
 }
 
 /// @brief Destructor
 STable::~STable()
 {
-    if (this->bm)
-    {
-        delete this->bm;
-        this->bm = NULL;
-    }
-    for (int i = 0; i < MAX_SEMAPHORE; i++)
+    for (int i = 0; i < count; i++)
     {
         if (this->semTab[i])
         {
@@ -30,41 +31,93 @@ STable::~STable()
             this->semTab[i] = NULL;
         }
     }
+    delete[] this->semTab;
+    delete[] this->chain;
+    delete[] this->buckets;
 }
 
 //************************************************************************************
 //************************************ METHODS ***************************************
 //************************************************************************************
 
+/// @brief Hash of a semaphore name (FNV-1a)
+/// @param name Name of semaphore
+/// @return Hash value
+unsigned int STable::Hash(char *name)
+{
+    unsigned int h = 2166136261u;
+
+    for (int i = 0; name[i] != '\0'; i++)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+/// @brief Double the room in the table, and rebuild the hash chains for the new number of buckets
+void STable::Grow()
+{
+    int newSize = size * 2;
+    Sem **newTab = new Sem *[newSize];
+
+    for (int i = 0; i < newSize; i++)
+        newTab[i] = (i < count) ? semTab[i] : NULL;
+    delete[] semTab;
+    delete[] chain;
+    delete[] buckets;
+    semTab = newTab;
+    chain = new int[newSize];
+    buckets = new int[newSize];
+    size = newSize;
+
+    for (int i = 0; i < size; i++)
+        buckets[i] = -1;
+    for (int i = 0; i < count; i++)
+    {
+        int b = Hash(semTab[i]->GetName()) % size;
+        chain[i] = buckets[b];
+        buckets[b] = i;
+    }
+}
+
 /// @brief Create a new semaphore in semaphores table
 /// @param name Name of semaphore
 /// @param init Initial value of semaphore
-/// @return 0 if success, -1 if fail
+/// @return Handle of the new semaphore, -1 if fail (a semaphore with that name exists)
 int STable::Create(char *name, int init)
 {
     // Check if semaphore already exists
-    for (int i = 0; i < MAX_SEMAPHORE; i++)
+    if (GetSemaphore(name) != NULL)
     {
-        if (bm->Test(i))
-        {
-            if (strcmp(name, semTab[i]->GetName()) == 0)
-            {
-                return -1;
-            }
-        }
+        return -1;
     }
-    // Find free slot in semTab
-    int id = this->FindFreeSlot();
 
-    // If not found, return -1
-    if (id < 0)
+    // Make room for it if the table is full
+    if (count == size)
     {
-        return -1;
+        Grow();
     }
 
-    // If found, create new semaphore in semTab[id]
+    // Create new semaphore at the next handle, and put it on its hash chain
+    int id = count++;
+    int b = Hash(name) % size;
     this->semTab[id] = new Sem(name, init);
-    return 0;
+    this->chain[id] = buckets[b];
+    this->buckets[b] = id;
+    return id;
+}
+
+/// @brief Find the handle of an existing semaphore
+/// @param name Name of semaphore
+/// @return Handle of the semaphore, -1 if not found
+int STable::Open(char *name)
+{
+    for (int i = buckets[Hash(name) % size]; i != -1; i = chain[i])
+    {
+        if (strcmp(name, semTab[i]->GetName()) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
 }
 
 /// @brief Down operation on semaphore with name
@@ -72,26 +125,40 @@ int STable::Create(char *name, int init)
 /// @return 0 if success, -1 if fail
 int STable::Wait(char *name)
 {
-    Sem *sem = GetSemaphore(name);
+    return Wait(Open(name));
+}
+
+/// @brief Up operation on semaphore with name
+/// @param name Name of semaphore
+/// @return 0 if success, -1 if fail
+int STable::Signal(char *name)
+{
+    return Signal(Open(name));
+}
+
+/// @brief Down operation on semaphore with handle
+/// @param handle Handle of semaphore
+/// @return 0 if success, -1 if fail
+int STable::Wait(int handle)
+{
+    Sem *sem = GetSemaphore(handle);
     if (sem == NULL)
     {
         return -1;
-        printf("Semaphore not found\n");
     }
     sem->Wait();
     return 0;
 }
 
-/// @brief Up operation on semaphore with name
-/// @param name Name of semaphore
+/// @brief Up operation on semaphore with handle
+/// @param handle Handle of semaphore
 /// @return 0 if success, -1 if fail
-int STable::Signal(char *name)
+int STable::Signal(int handle)
 {
-    Sem *sem = GetSemaphore(name);
+    Sem *sem = GetSemaphore(handle);
     if (sem == NULL)
     {
         return -1;
-        printf("Semaphore not found\n");
     }
     sem->Signal();
     return 0;
@@ -102,22 +169,17 @@ int STable::Signal(char *name)
 /// @return Pointer to semaphore if found, NULL if not found
 Sem *STable::GetSemaphore(char *name)
 {
-    for (int i = 0; i < MAX_SEMAPHORE; i++)
-    {
-        if (bm->Test(i))
-        {
-            if (strcmp(name, semTab[i]->GetName()) == 0)
-            {
-                return semTab[i];
-            }
-        }
-    }
-    return NULL;
+    return GetSemaphore(Open(name));
 }
 
-/// @brief Find free slot in semTab
-/// @return Index of free slot if found, -1 if not found
-int STable::FindFreeSlot()
+/// @brief Get semaphore with handle
+/// @param handle Handle of semaphore
+/// @return Pointer to semaphore if found, NULL if not found
+Sem *STable::GetSemaphore(int handle)
 {
-    return bm->Find();
+    if (handle < 0 || handle >= count)
+    {
+        return NULL;
+    }
+    return semTab[handle];
 }
@@ -2,9 +2,8 @@
 #define STABLE_H
 
 #include "synch.h"
-#include "bitmap.h"
 
-#define MAX_SEMAPHORE 10
+#define SemTableSize 16 // Semaphores the table has room for at first (it doubles when full)
 
 /// @brief Sem class to manage semaphore with name and Semaphore object
 class Sem
@@ -42,12 +41,20 @@ public:
     }
 };
 
-/// @brief STable class to manage semaphore table
+/// @brief STable class to manage semaphore table. A semaphore is known by
+/// its handle, its index in the table, which is what the fast DownH/UpH
+/// system calls take; names are looked up through hash chains.
 class STable
 {
 private:
-    BitMap *bm;
-    Sem *semTab[MAX_SEMAPHORE];
+    Sem **semTab; // Semaphore of each handle (handles are given out in order)
+    int *chain;   // Next handle in the same hash chain, or -1
+    int *buckets; // First handle in each hash chain (one per slot), or -1
+    int size;     // Room in the table
+    int count;    // Semaphores in it: handles 0 to count - 1
+
+    static unsigned int Hash(char *name);
+    void Grow();
 
 public: // Constructor & Destructor
     STable();
@@ -55,11 +62,14 @@ public: // Constructor & Destructor
 
 public: // Methods
     int Create(char *name, int init);
+    int Open(char *name);
     int Wait(char *name);
     int Signal(char *name);
+    int Wait(int handle);
+    int Signal(int handle);
 
-    int FindFreeSlot();
     Sem *GetSemaphore(char *name);
+    Sem *GetSemaphore(int handle);
 };
 
 #endif
\ No newline at end of file
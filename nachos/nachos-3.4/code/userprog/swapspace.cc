@@ -0,0 +1,76 @@
+// swapspace.cc
+//	Routines to manage the swap file that backs user virtual memory.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swapspace.h"
+#include "machine.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Create (or truncate) the host file "fileName" to hold swapped out
+//	pages.  Slots are written before they are ever read, so the
+//	file just grows as they are used.
+//
+//	"fileName" -- name of the host file to use
+//	"numSlots" -- the number of pages the swap file can hold
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(char *fileName, int numSlots)
+{
+    name = fileName;
+    fileno = OpenForWrite(name);
+    slots = new BitMap(numSlots);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Close the swap file and remove it; its contents are meaningless
+//	once Nachos stops.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    Close(fileno);
+    Unlink(name);
+    delete slots;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate/Free
+// 	Reserve a slot for a page, or give it back.  Allocate returns -1
+//	if every slot is taken.
+//----------------------------------------------------------------------
+
+int SwapSpace::Allocate()
+{
+    return slots->Find();
+}
+
+void SwapSpace::Free(int slot)
+{
+    slots->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage/WritePage
+// 	Copy one page between memory and slot "slot" of the swap file.
+//----------------------------------------------------------------------
+
+void SwapSpace::ReadPage(int slot, char *into)
+{
+    ASSERT(slots->Test(slot));
+    Lseek(fileno, slot * PageSize, 0);
+    Read(fileno, into, PageSize);
+}
+
+void SwapSpace::WritePage(int slot, char *from)
+{
+    ASSERT(slots->Test(slot));
+    Lseek(fileno, slot * PageSize, 0);
+    WriteFile(fileno, from, PageSize);
+}
@@ -0,0 +1,42 @@
+// swapspace.h
+//	Data structures for the backing store of virtual memory: a
+//	host file divided into page-sized slots, which hold the contents
+//	of user pages that have been evicted from physical memory.
+//
+//	The swap file lives on the host, not on the simulated disk,
+//	so that it works the same with the stub and the real file
+//	system (whose files are far too small to hold it).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPSPACE_H
+#define SWAPSPACE_H
+
+#include "copyright.h"
+#include "bitmap.h"
+
+#define NumSwapPages 1024 // slots in the swap file
+
+class SwapSpace
+{
+public:
+  SwapSpace(char *fileName, int numSlots); // Create the swap file
+                                           // "fileName", with room
+                                           // for "numSlots" pages
+  ~SwapSpace();                            // Close and remove it
+
+  int Allocate();        // Reserve a slot; -1 if swap is full
+  void Free(int slot);   // Release a slot
+
+  void ReadPage(int slot, char *into);  // Copy a page out of / into
+  void WritePage(int slot, char *from); // a slot of the swap file
+
+private:
+  char *name;     // name of the host file
+  int fileno;     // UNIX file descriptor of the swap file
+  BitMap *slots;  // which slots are in use
+};
+
+#endif // SWAPSPACE_H
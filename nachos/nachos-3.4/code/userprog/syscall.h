@@ -47,6 +47,21 @@
 #define SC_Down 53
 #define SC_Up 54
 
+#define SC_GetTime 55
+
+#define SC_Pipe 56
+
+#define SC_ShmCreate 57
+#define SC_ShmAttach 58
+#define SC_ShmDetach 59
+
+#define SC_OpenSemaphore 60
+#define SC_DownH 61
+#define SC_UpH 62
+
+#define SC_FutexWait 63
+#define SC_FutexWake 64
+
 #ifndef IN_ASM
 
 /* The system call interface.  These are the operations the Nachos
@@ -167,6 +182,14 @@ int Read(char *buffer, int size, OpenFileId id);
 /// @note + Return -3 if unknown error occurs
 int Write(char *buffer, int size, OpenFileId id);
 
+/// @brief Create a pipe: what is written to one descriptor can be read from the other,
+/// by this process or by the children it starts with Exec (which inherit both)
+/// @param fds Array of two OpenFileIds (Stored in register 4): fds[0] is set to the read end, fds[1] to the write end
+/// @return 0 if the pipe is created successfully, -1 otherwise
+/// @note + Read waits until there is data, and returns -2 (EOF) once every write end is closed
+/// @note + Write waits until all of the data fits, and returns -1 once every read end is closed
+int Pipe(OpenFileId *fds);
+
 /// @brief Move the file pointer to the given position
 /// @param pos Position to move the file pointer to (Stored in register 4)
 /// @param id OpenFileId of the file to be seeked (Stored in register 5)
@@ -209,12 +232,88 @@ void Fork(void (*func)());
  */
 void Yield();
 
+/// @brief Create a semaphore with the given name and initial value
+/// @param name Name of the semaphore (Stored in register 4)
+/// @param semval Initial value (Stored in register 5)
+/// @return Handle of the semaphore, for DownH and UpH; -1 if a semaphore with that name exists
 int CreateSemaphore(char *name, int semval);
 
+/// @brief Get the handle of the semaphore with the given name
+/// @param name Name of the semaphore (Stored in register 4)
+/// @return Handle of the semaphore, -1 if there is none
+int OpenSemaphore(char *name);
+
+/// @brief Down (P) the semaphore with the given name
+/// @return 0 if successful, -1 if there is no such semaphore
 int Down(char *name);
 
+/// @brief Up (V) the semaphore with the given name
+/// @return 0 if successful, -1 if there is no such semaphore
 int Up(char *name);
 
+/// @brief Down (P) a semaphore by handle; cheaper than Down, which copies in and looks up the name every time
+/// @param handle Handle from CreateSemaphore or OpenSemaphore (Stored in register 4)
+/// @return 0 if successful, -1 if there is no such semaphore
+int DownH(int handle);
+
+/// @brief Up (V) a semaphore by handle; cheaper than Up
+/// @param handle Handle from CreateSemaphore or OpenSemaphore (Stored in register 4)
+/// @return 0 if successful, -1 if there is no such semaphore
+int UpH(int handle);
+
+/// @brief Get the time elapsed on the host since Nachos started, for benchmarks
+/// @return Host time in milliseconds
+int GetTime();
+
+/* Shared memory: segments of memory several processes map, to exchange
+ * data without copying it through the kernel.
+ */
+
+/// @brief Get the shared memory segment with the given name, making it if there is none; the process holds it until it detaches it or exits
+/// @param name Name of the segment (Stored in register 4)
+/// @param size Bytes it must hold; a new segment is this big, rounded up to pages, and zeroed (Stored in register 5)
+/// @return Id of the segment, or -1 if it can't be made (too many segments or shared pages) or an existing one is smaller
+int ShmCreate(char *name, int size);
+
+/// @brief Map a shared memory segment into the address space, past the stack
+/// @param id Id ShmCreate returned to this process (Stored in register 4)
+/// @return Address of the segment, or 0 if the process doesn't hold such a segment, there is no room for it, or it is attached already
+char *ShmAttach(int id);
+
+/// @brief Unmap a shared memory segment and let go of it; the last process holding it frees it
+/// @param addr Address ShmAttach returned (Stored in register 4)
+/// @return 0 if the segment is unmapped successfully, -1 otherwise
+int ShmDetach(char *addr);
+
+/* Atomic operations and futexes, to build locks that only enter the kernel
+ * when a thread has to wait (see test/umutex.c).  The atomic operations are
+ * not system calls: they are LL/SC loops in start.s.
+ */
+
+/// @brief Store newValue in *addr if it holds oldValue, atomically
+/// @return The value *addr held
+int CompareAndSwap(int *addr, int oldValue, int newValue);
+
+/// @brief Store newValue in *addr, atomically
+/// @return The value *addr held
+int Swap(int *addr, int newValue);
+
+/// @brief Add delta to *addr, atomically
+/// @return The value *addr held
+int AtomicAdd(int *addr, int delta);
+
+/// @brief Sleep until FutexWake on the word, unless it no longer holds expected
+/// @param addr Address of the word (Stored in register 4)
+/// @param expected Value the caller saw in the word (Stored in register 5)
+/// @return 0 when woken up, -1 at once if *addr != expected or addr is bad
+int FutexWait(int *addr, int expected);
+
+/// @brief Wake threads sleeping in FutexWait on the word, oldest first
+/// @param addr Address of the word (Stored in register 4); waiters in other processes are found if it is in shared memory
+/// @param count Most threads to wake (Stored in register 5)
+/// @return Number of threads woken up, -1 if addr is bad
+int FutexWake(int *addr, int count);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -0,0 +1,172 @@
+// textcache.cc
+//	Routines to keep track of the code pages shared among processes
+//	running the same executable.
+//
+//	All of these are called with "addrLock" held.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "textcache.h"
+
+//----------------------------------------------------------------------
+// SharedText::SharedText
+// 	Set up the shared code of executable "fileName", whose code
+//	segment is "codeSeg".  Only the pages that lie wholly inside the segment
+//	are shared: a page that also holds initialized data must be
+//	private to each process.  None of them is loaded yet.
+//----------------------------------------------------------------------
+
+SharedText::SharedText(char *fileName, Segment *codeSeg)
+{
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    code = *codeSeg;
+
+    firstPage = divRoundUp(code.virtualAddr, PageSize);
+    numPages = (code.virtualAddr + code.size) / PageSize - firstPage;
+    if (numPages < 0)
+        numPages = 0;
+    frames = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+        frames[i] = -1;
+    refs = 0;
+}
+
+//----------------------------------------------------------------------
+// SharedText::~SharedText
+// 	Nobody is running the executable any more; give back the frames
+//	that hold its code.
+//----------------------------------------------------------------------
+
+SharedText::~SharedText()
+{
+    for (int i = 0; i < numPages; i++)
+        if (frames[i] >= 0)
+            frameTable->Free(frames[i]);
+    delete[] frames;
+    delete[] name;
+}
+
+//----------------------------------------------------------------------
+// SharedText::Matches
+// 	Is this the code of executable "fileName"?  The code segment
+//	"codeSeg" must match too, in case the file has been replaced
+//	since it was loaded.
+//----------------------------------------------------------------------
+
+bool SharedText::Matches(char *fileName, Segment *codeSeg)
+{
+    return !strcmp(name, fileName) &&
+           code.virtualAddr == codeSeg->virtualAddr &&
+           code.inFileAddr == codeSeg->inFileAddr &&
+           code.size == codeSeg->size;
+}
+
+//----------------------------------------------------------------------
+// TextCache::TextCache/~TextCache
+// 	Start out sharing nothing; forget everything at the end.
+//----------------------------------------------------------------------
+
+TextCache::TextCache()
+{
+    for (int i = 0; i < MaxSharedTexts; i++)
+        texts[i] = NULL;
+}
+
+TextCache::~TextCache()
+{
+    for (int i = 0; i < MaxSharedTexts; i++)
+        if (texts[i] != NULL)
+            delete texts[i];
+}
+
+//----------------------------------------------------------------------
+// TextCache::Acquire
+// 	Return the shared code of executable "name", with code segment
+//	"code", adding it to the cache if no other process is running
+//	it.  The caller must Release it when its address space goes away.
+//
+//	If the cache is full, the code of some program nobody is running
+//	any more makes room.  Returns NULL if there is nothing to share
+//	(the code doesn't fill a single page), or no room can be made.
+//----------------------------------------------------------------------
+
+SharedText *
+TextCache::Acquire(char *name, Segment *code)
+{
+    int i, slot = -1, unused = -1;
+
+    for (i = 0; i < MaxSharedTexts; i++)
+    {
+        if (texts[i] == NULL)
+        {
+            if (slot < 0)
+                slot = i;
+        }
+        else if (texts[i]->Matches(name, code))
+        {
+            texts[i]->refs++;
+            return texts[i];
+        }
+        else if (texts[i]->refs == 0 && unused < 0)
+            unused = i;
+    }
+    if (slot < 0 && unused >= 0)
+    {
+        delete texts[unused];
+        texts[unused] = NULL;
+        slot = unused;
+    }
+    if (slot < 0)
+        return NULL;
+
+    SharedText *text = new SharedText(name, code);
+    if (text->numPages == 0)
+    {
+        delete text;
+        return NULL;
+    }
+    DEBUG('a', "Sharing %d code pages of %s\n", text->numPages, name);
+    text->refs = 1;
+    texts[slot] = text;
+    return text;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Release
+// 	An address space using "text" is going away.  The code stays in
+//	memory even if it was the last one, until Reclaim or Acquire
+//	needs the room.
+//----------------------------------------------------------------------
+
+void TextCache::Release(SharedText *text)
+{
+    ASSERT(text->refs > 0);
+    text->refs--;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Reclaim
+// 	Memory is short: free the code pages of every program that
+//	nobody is running.  Returns TRUE if any frames were freed.
+//----------------------------------------------------------------------
+
+bool TextCache::Reclaim()
+{
+    bool freed = FALSE;
+
+    for (int i = 0; i < MaxSharedTexts; i++)
+        if (texts[i] != NULL && texts[i]->refs == 0)
+        {
+            for (int j = 0; j < texts[i]->numPages; j++)
+                if (texts[i]->frames[j] >= 0)
+                    freed = TRUE;
+            delete texts[i];
+            texts[i] = NULL;
+        }
+    return freed;
+}
@@ -0,0 +1,66 @@
+// textcache.h
+//	Data structures to share the code pages of an executable among
+//	all the processes running it.
+//
+//	The pages that hold nothing but code are loaded once, into
+//	frames owned by the text cache, and mapped read-only into every
+//	address space running the same executable.  A process that
+//	writes to one gets a private copy (copy-on-write).
+//
+//	The code stays cached after the last process running it exits,
+//	so that launching the program again is cheap, until its frames
+//	or its slot in the cache are needed for something else.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include "noff.h"
+
+#define MaxSharedTexts 10 // executables that can be shared at once
+
+// The shared code of one executable.
+
+class SharedText
+{
+public:
+  SharedText(char *fileName, Segment *codeSeg);
+  ~SharedText(); // Free the frames holding the code
+
+  bool Matches(char *fileName, Segment *codeSeg); // Is this that executable?
+
+  int firstPage; // first virtual page holding only code
+  int numPages;  // how many such pages there are
+  int *frames;   // frame holding each of them, -1 if not loaded yet
+  int refs;      // address spaces using this text; if none, it is
+                 // only kept in case the program is run again
+
+private:
+  char *name;   // name of the executable
+  Segment code; // its code segment, to tell a changed file apart
+};
+
+class TextCache
+{
+public:
+  TextCache();  // Initialize an empty cache
+  ~TextCache(); // De-allocate it
+
+  SharedText *Acquire(char *name, Segment *code);
+  // Find (or add) the shared code of
+  // executable "name"; NULL if it has
+  // no whole code pages or the cache
+  // is full
+  void Release(SharedText *text); // An address space is done with it
+  bool Reclaim(); // Free the code nobody is running;
+                  // FALSE if there was none
+
+private:
+  SharedText *texts[MaxSharedTexts]; // NULL where unused
+};
+
+#endif // TEXTCACHE_H
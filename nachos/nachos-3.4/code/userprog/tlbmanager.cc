@@ -0,0 +1,211 @@
+// tlbmanager.cc
+//	Routines to load and flush the software-managed TLB.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "tlbmanager.h"
+
+//----------------------------------------------------------------------
+// TLBManager::TLBManager
+// 	Initialize the kernel's view of the TLB (the machine starts out
+//	with every entry invalid).
+//
+//	"whichPolicy" -- how to choose the entry to replace on a miss
+//	"useAsids" -- if TRUE, tag entries with address space IDs rather
+//		than flushing the TLB on every context switch
+//----------------------------------------------------------------------
+
+TLBManager::TLBManager(TLBPolicy whichPolicy, bool useAsids)
+{
+    ASSERT(machine->tlb != NULL);
+    policy = whichPolicy;
+    tagged = useAsids;
+    source = new TranslationEntry *[machine->tlbSize];
+    for (int i = 0; i < machine->tlbSize; i++)
+        source[i] = NULL;
+    nextVictim = 0;
+    nextAsid = 1;
+    asidEpoch = 1;
+}
+
+TLBManager::~TLBManager()
+{
+    delete[] source;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::WriteBack
+// 	Copy the use and dirty bits the hardware set in TLB entry "i"
+//	back to the page table entry it was loaded from, and clear the
+//	use bit, so that later uses are noticed too (the page replacement
+//	policy clears the use bits in the page table).
+//----------------------------------------------------------------------
+
+void TLBManager::WriteBack(int i)
+{
+    TranslationEntry *entry = &machine->tlb[i];
+
+    if (!entry->valid)
+        return;
+    if (entry->use)
+        source[i]->use = TRUE;
+    if (entry->dirty)
+        source[i]->dirty = TRUE;
+    entry->use = FALSE;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::ChooseEntry
+// 	Pick the TLB entry to load a translation into: an invalid one if
+//	there is one, otherwise whichever the policy says.
+//----------------------------------------------------------------------
+
+int TLBManager::ChooseEntry()
+{
+    int i, victim;
+
+    for (i = 0; i < machine->tlbSize; i++)
+        if (!machine->tlb[i].valid)
+            return i;
+
+    switch (policy)
+    {
+    case RandomTLB:
+        return Random() % machine->tlbSize;
+    case FIFOTLB:
+        victim = nextVictim;
+        nextVictim = (nextVictim + 1) % machine->tlbSize;
+        return victim;
+    default: // LRUTLB
+        victim = 0;
+        for (i = 1; i < machine->tlbSize; i++)
+            if (machine->tlbLastUse[i] < machine->tlbLastUse[victim])
+                victim = i;
+        return victim;
+    }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Refill
+// 	Handle a TLB miss: load page table entry "entry" of the running
+//	address space, which must be valid, into the TLB.
+//----------------------------------------------------------------------
+
+void TLBManager::Refill(TranslationEntry *entry)
+{
+    int i = ChooseEntry();
+
+    ASSERT(entry->valid);
+    DEBUG('a', "Loading virtual page %d into TLB entry %d\n",
+          entry->virtualPage, i);
+    WriteBack(i); // the entry being replaced
+    machine->tlb[i] = *entry;
+    machine->tlb[i].asid = machine->tlbAsid;
+    machine->tlbLastUse[i] = stats->totalTicks;
+    source[i] = entry;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Sync
+// 	Bring the use and dirty bits of every page table entry in the TLB
+//	up to date.  Called before the page replacement policy looks at
+//	them.
+//----------------------------------------------------------------------
+
+void TLBManager::Sync()
+{
+    for (int i = 0; i < machine->tlbSize; i++)
+        WriteBack(i);
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Flush
+// 	Empty the TLB, saving the use and dirty bits first.
+//----------------------------------------------------------------------
+
+void TLBManager::Flush()
+{
+    for (int i = 0; i < machine->tlbSize; i++)
+    {
+        WriteBack(i);
+        machine->tlb[i].valid = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Forget
+// 	Drop the TLB entries that map physical frame "frame" (in any
+//	address space), because the page in it is being evicted or
+//	copied, after saving their use and dirty bits.
+//----------------------------------------------------------------------
+
+void TLBManager::Forget(int frame)
+{
+    for (int i = 0; i < machine->tlbSize; i++)
+        if (machine->tlb[i].valid && machine->tlb[i].physicalPage == frame)
+        {
+            WriteBack(i);
+            machine->tlb[i].valid = FALSE;
+        }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Forget
+// 	Drop the TLB entries loaded from page table "table" (of "size"
+//	entries), which is about to be deleted.  Nothing is written back.
+//----------------------------------------------------------------------
+
+void TLBManager::Forget(TranslationEntry *table, int size)
+{
+    for (int i = 0; i < machine->tlbSize; i++)
+        if (machine->tlb[i].valid && source[i] >= table &&
+            source[i] < table + size)
+            machine->tlb[i].valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::SaveState
+// 	The running address space is being switched out.  Without
+//	address space IDs, its entries must go.
+//----------------------------------------------------------------------
+
+void TLBManager::SaveState()
+{
+    if (!tagged)
+        Flush();
+}
+
+//----------------------------------------------------------------------
+// TLBManager::RestoreState
+// 	An address space is being switched in.  With tagged entries, make
+//	its ID the running one, handing it a new ID if it has none yet, or
+//	if its ID is from before the IDs last ran out ("*asid" and
+//	"*epoch" are the address space's ID and when it got it).  Running
+//	out flushes the whole TLB, so that no stale entry matches a
+//	reused ID.
+//----------------------------------------------------------------------
+
+void TLBManager::RestoreState(int *asid, int *epoch)
+{
+    if (!tagged)
+    {
+        machine->tlbAsid = 0;
+        return;
+    }
+    if (*epoch != asidEpoch)
+    {
+        if (nextAsid == NumAsids)
+        { // all used up: start over
+            Flush();
+            asidEpoch++;
+            nextAsid = 1;
+        }
+        *asid = nextAsid++;
+        *epoch = asidEpoch;
+    }
+    machine->tlbAsid = *asid;
+}
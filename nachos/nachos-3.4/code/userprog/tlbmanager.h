@@ -0,0 +1,74 @@
+// tlbmanager.h
+//	Data structures for managing the software-loaded TLB, when the
+//	machine translates through one instead of a linear page table.
+//
+//	Every TLB miss traps to the kernel, which loads the missing
+//	translation from the page table of the running address space,
+//	replacing some other entry if the TLB is full.
+//
+//	The hardware sets the use and dirty bits in the TLB entry, not in
+//	the page table; they are written back to the page table entry an
+//	entry was loaded from whenever the kernel needs them (see Sync).
+//
+//	On a context switch, either the whole TLB is flushed, or, if
+//	entries are tagged with address space IDs, the running ID is just
+//	changed and the entries of other address spaces stay put.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "translate.h"
+
+#define NumAsids 64 // address space IDs the TLB can tell apart
+
+// Ways of choosing the TLB entry to replace on a miss.
+
+enum TLBPolicy
+{
+  RandomTLB, // any entry, as the MIPS "Random" register does
+  FIFOTLB,   // the entries in turn
+  LRUTLB     // the entry that has gone unused the longest
+};
+
+class TLBManager
+{
+public:
+  TLBManager(TLBPolicy whichPolicy, bool useAsids); // Start with an empty TLB
+  ~TLBManager();
+
+  void Refill(TranslationEntry *entry); // Load a page table entry of
+                                        // the running address space
+  void Sync();                          // Write use/dirty bits back to
+                                        // the page tables
+  void Flush();                         // Sync, then empty the TLB
+  void Forget(int frame);               // Sync, then drop the entries
+                                        // that map "frame"
+  void Forget(TranslationEntry *table, int size);
+  // Drop the entries loaded from a page
+  // table that is going away (no sync)
+
+  void SaveState();                          // Context switch away from,
+  void RestoreState(int *asid, int *epoch);  // and back to, an address
+                                             // space with this ID
+
+private:
+  TLBPolicy policy;           // how to choose an entry to replace
+  bool tagged;                // are entries tagged with address space
+                              // IDs, instead of flushed on a switch?
+  TranslationEntry **source;  // page table entry each TLB entry
+                              // was loaded from
+  int nextVictim;             // next entry to replace, for FIFO
+  int nextAsid;               // next address space ID to hand out
+  int asidEpoch;              // bumped whenever the IDs run out and
+                              // are all handed out again
+
+  int ChooseEntry();          // Pick the entry to replace
+  void WriteBack(int i);      // Copy entry i's use/dirty bits back
+};
+
+#endif // TLBMANAGER_H